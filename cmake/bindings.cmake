@@ -1,16 +1,20 @@
 # Compile static lib to be used in the pybind11 module
 # Math module
+add_library(bindTextIO STATIC ${CMAKE_SOURCE_DIR}/src/srcMath/TextIO.cpp)
+
 add_library(bindMatrix INTERFACE ${CMAKE_SOURCE_DIR}/src/srcMath/Matrix.hpp)
 set_property(TARGET bindMatrix PROPERTY LINKER_LANGUAGE CXX)
 
 add_library(bindImageIO STATIC ${CMAKE_SOURCE_DIR}/src/srcMath/ImageIO.cpp)
 add_subdirectory("${CMAKE_HOME_DIRECTORY}/inc/libtiff")
-target_link_libraries(bindImageIO PUBLIC tiff)
+target_link_libraries(bindImageIO PUBLIC tiff Threads::Threads)
 # target_link_libraries(bindImageIO PUBLIC bindMatrix tiff)
 
 add_library(bindmyMath STATIC ${CMAKE_SOURCE_DIR}/src/srcMath/myMATH.cpp)
 # target_link_libraries(bindmyMath PUBLIC bindMatrix)
 
+add_library(bindPointGrid STATIC ${CMAKE_SOURCE_DIR}/src/srcMath/PointGrid.cpp)
+
 add_library(bindCamera STATIC ${CMAKE_SOURCE_DIR}/src/srcMath/Camera.cpp)
 # target_link_libraries(bindCamera PUBLIC bindMatrix bindmyMath)
 
@@ -39,8 +43,13 @@ set_property(TARGET bindIPR PROPERTY LINKER_LANGUAGE CXX)
 add_library(bindPredField INTERFACE ${CMAKE_SOURCE_DIR}/src/srcSTB/PredField.hpp)
 set_property(TARGET bindPredField PROPERTY LINKER_LANGUAGE CXX)
 
+add_library(bindTrackFile STATIC ${CMAKE_SOURCE_DIR}/src/srcSTB/TrackFile.cpp)
+
 add_library(bindTrack INTERFACE ${CMAKE_SOURCE_DIR}/src/srcSTB/Track.hpp)
 set_property(TARGET bindTrack PROPERTY LINKER_LANGUAGE CXX)
+target_link_libraries(bindTrack INTERFACE Threads::Threads)
+
+add_library(bindCheckpoint STATIC ${CMAKE_SOURCE_DIR}/src/srcSTB/Checkpoint.cpp)
 
 add_library(bindSTB INTERFACE ${CMAKE_SOURCE_DIR}/src/srcSTB/STB.hpp)
 set_property(TARGET bindSTB PROPERTY LINKER_LANGUAGE CXX)
@@ -54,9 +63,11 @@ set(BINDINGS_SRC
     ${CMAKE_SOURCE_DIR}/src/pybind_OpenLPT/pyInterface.cpp
 )
 set(BINDINGS_LIB
+    bindTextIO
     bindMatrix
     bindImageIO
     bindmyMath
+    bindPointGrid
     bindCamera
     bindObjectInfo
     bindObjectFinder
@@ -65,7 +76,9 @@ set(BINDINGS_LIB
     bindShake
     bindIPR
     bindPredField
+    bindTrackFile
     bindTrack
+    bindCheckpoint
     bindSTB
 )
 pybind11_add_module(pyOpenLPT ${BINDINGS_SRC})
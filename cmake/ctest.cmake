@@ -7,6 +7,17 @@ set(TESTHEADERFILES
 )
 
 
+# test TextIO
+add_executable(test_TextIO 
+    ${CMAKE_HOME_DIRECTORY}/test/test_TextIO.cpp
+    ${TESTHEADERFILES}
+)
+target_link_libraries(test_TextIO PRIVATE TextIO)
+add_test(test_TextIO test_TextIO)
+set_tests_properties(test_TextIO
+                     PROPERTIES FAIL_REGULAR_EXPRESSION "failed on line")
+
+
 # test Matrix
 add_executable(test_Matrix 
     ${CMAKE_HOME_DIRECTORY}/test/test_Matrix.cpp
@@ -29,6 +40,17 @@ set_tests_properties(test_myMATH
                      PROPERTIES FAIL_REGULAR_EXPRESSION "failed on line")
 
 
+# test PointGrid
+add_executable(test_PointGrid 
+    ${CMAKE_HOME_DIRECTORY}/test/test_PointGrid.cpp
+    ${TESTHEADERFILES}
+)
+target_link_libraries(test_PointGrid PRIVATE PointGrid myMath Matrix)
+add_test(test_PointGrid test_PointGrid)
+set_tests_properties(test_PointGrid
+                     PROPERTIES FAIL_REGULAR_EXPRESSION "failed on line")
+
+
 # test ImageIO
 add_executable(test_ImageIO 
     ${CMAKE_HOME_DIRECTORY}/test/test_ImageIO.cpp
@@ -155,6 +177,28 @@ target_link_libraries(test_Track PRIVATE Track Matrix ObjectInfo)
 add_test(test_Track test_Track)
 
 
+# test TrackFile
+add_executable(test_TrackFile 
+    ${CMAKE_HOME_DIRECTORY}/test/test_TrackFile.cpp
+    ${TESTHEADERFILES}
+)
+target_link_libraries(test_TrackFile PRIVATE TrackFile Track Matrix ObjectInfo)
+add_test(test_TrackFile test_TrackFile)
+set_tests_properties(test_TrackFile
+                     PROPERTIES FAIL_REGULAR_EXPRESSION "failed on line")
+
+
+# test Checkpoint
+add_executable(test_Checkpoint 
+    ${CMAKE_HOME_DIRECTORY}/test/test_Checkpoint.cpp
+    ${TESTHEADERFILES}
+)
+target_link_libraries(test_Checkpoint PRIVATE ImageIO STB Matrix ObjectInfo ObjectFinder StereoMatch OTF Shake IPR PredField Track Checkpoint)
+add_test(test_Checkpoint test_Checkpoint)
+set_tests_properties(test_Checkpoint
+                     PROPERTIES FAIL_REGULAR_EXPRESSION "failed on line")
+
+
 # test STB
 add_executable(test_STB 
     ${CMAKE_HOME_DIRECTORY}/test/test_STB.cpp
@@ -1,13 +1,19 @@
 # Build libraries
+add_library(TextIO SHARED ${CMAKE_HOME_DIRECTORY}/src/srcMath/TextIO.cpp)
+
 add_library(Matrix SHARED ${CMAKE_HOME_DIRECTORY}/src/srcMath/Matrix.hpp)
 set_target_properties(Matrix PROPERTIES LINKER_LANGUAGE CXX)
+target_link_libraries(Matrix PUBLIC TextIO)
 
 add_library(myMath SHARED ${CMAKE_HOME_DIRECTORY}/src/srcMath/myMATH.cpp)
 target_link_libraries(myMath PUBLIC Matrix)
 
+add_library(PointGrid SHARED ${CMAKE_HOME_DIRECTORY}/src/srcMath/PointGrid.cpp)
+target_link_libraries(PointGrid PUBLIC Matrix)
+
 add_library(ImageIO SHARED ${CMAKE_HOME_DIRECTORY}/src/srcMath/ImageIO.cpp)
 add_subdirectory("${CMAKE_HOME_DIRECTORY}/inc/libtiff")
-target_link_libraries(ImageIO PUBLIC Matrix tiff)
+target_link_libraries(ImageIO PUBLIC Matrix tiff Threads::Threads)
 
 add_library(Camera SHARED ${CMAKE_HOME_DIRECTORY}/src/srcMath/Camera.cpp)
 target_link_libraries(Camera PUBLIC Matrix myMath)
@@ -31,7 +37,7 @@ add_library(OTF SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/OTF.cpp)
 target_link_libraries(OTF PUBLIC Matrix myMath)
 
 add_library(Shake SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/Shake.cpp)
-target_link_libraries(Shake PUBLIC Matrix myMath ObjectInfo Camera OTF)
+target_link_libraries(Shake PUBLIC Matrix myMath PointGrid ObjectInfo Camera OTF)
 
 add_library(IPR SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/IPR.hpp)
 set_target_properties(IPR PROPERTIES LINKER_LANGUAGE CXX)
@@ -41,15 +47,21 @@ add_library(PredField SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/PredField.hpp)
 set_target_properties(PredField PROPERTIES LINKER_LANGUAGE CXX)
 target_link_libraries(PredField PUBLIC Matrix myMath ObjectInfo)
 
+add_library(TrackFile SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/TrackFile.cpp)
+target_link_libraries(TrackFile PUBLIC TextIO)
+
 add_library(Track SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/Track.hpp)
 set_target_properties(Track PROPERTIES LINKER_LANGUAGE CXX)
-target_link_libraries(Track PUBLIC Matrix myMath ObjectInfo)
+target_link_libraries(Track PUBLIC Matrix myMath ObjectInfo TrackFile Threads::Threads)
+
+add_library(Checkpoint SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/Checkpoint.cpp)
+target_link_libraries(Checkpoint PUBLIC Matrix ObjectInfo OTF Track)
 
 add_library(STB SHARED ${CMAKE_HOME_DIRECTORY}/src/srcSTB/STB.hpp)
 set_target_properties(STB PROPERTIES LINKER_LANGUAGE CXX)
-target_link_libraries(STB PUBLIC Matrix myMath ObjectInfo ObjectFinder StereoMatch OTF Shake IPR PredField Track)
+target_link_libraries(STB PUBLIC Matrix myMath PointGrid ObjectInfo ObjectFinder StereoMatch OTF Shake IPR PredField TrackFile Track Checkpoint)
 
 # exe
 add_executable(OpenLPT src/main.cpp)
-target_link_libraries(OpenLPT PRIVATE ImageIO STB Matrix ObjectInfo ObjectFinder StereoMatch OTF Shake IPR PredField Track)
+target_link_libraries(OpenLPT PRIVATE ImageIO STB Matrix ObjectInfo ObjectFinder StereoMatch OTF Shake IPR PredField TrackFile Track Checkpoint)
 
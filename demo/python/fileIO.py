@@ -28,14 +28,11 @@ def load_csv(directory, keywords):
 def load_tracks(folder, load_previous=False, keywords=['ExitTrack', 'LongTrackActive', 'LongTrackInactive']):
     tracks = pd.DataFrame()
     
-    # load latest tracks 
+    # load latest tracks (TrackID is global across these files)
     df_list = load_csv(folder, keywords)
     
     for key in df_list:
-        df = df_list[key]
-        if not tracks.empty:
-            df['TrackID'] += tracks['TrackID'].unique().shape[0]
-        tracks = pd.concat([tracks, df], axis=0, ignore_index=True)
+        tracks = pd.concat([tracks, df_list[key]], axis=0, ignore_index=True)
         
     if load_previous:
         # load previous converge tracks
@@ -51,6 +48,22 @@ def load_tracks(folder, load_previous=False, keywords=['ExitTrack', 'LongTrackAc
     return tracks
 
 
+def load_tracks_bin(file):
+    # load a binary track file (.lpt) as the same table as load_tracks
+    reader = lpt.stb.TrackFileReader(file)
+    data = reader.readPoints()
+    
+    tracks = pd.DataFrame({
+        'TrackID': data['track_id'],
+        'FrameID': data['frame'] / reader.getFPS(),
+        'WorldX': data['xyz'][:,0],
+        'WorldY': data['xyz'][:,1],
+        'WorldZ': data['xyz'][:,2],
+        'Error': data['error']
+    })
+    return tracks
+
+
 def load_txt(directory, keywords):
     # Get list of files in the directory
     files = os.listdir(directory)
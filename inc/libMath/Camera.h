@@ -93,6 +93,10 @@ public:
     int getNRow () const; // get number of rows of the image
     int getNCol () const; // get number of columns of the image
 
+    // Region of the image covered by the projection of a volume
+    //  sample points on the bounding box are projected, the region is enlarged by margin_px and clipped to the image
+    PixelRange projectROI (AxisLimit const& axis_limit, int margin_px = 0) const;
+
 
     //            //
     // Projection //
@@ -155,6 +159,20 @@ struct CamList
     std::vector<Camera> cam_list; // cam_id: 0,1,2,3,..
     std::vector<int> intensity_max; // default: 8 digit (255), save size as cam_list
     std::vector<int> useid_list; // cam_id to be used
+    std::vector<PixelRange> roi_list; // image region seen by each camera, empty: whole image
+    std::vector<PixelMask> mask_list; // static pixel mask of each camera, empty: no mask
+
+    // compute roi_list from the measurement volume
+    void setROI (AxisLimit const& axis_limit, int margin_px);
+
+    // roi of one camera, the whole image if roi_list is empty
+    PixelRange getROI (int cam_id) const;
+
+    // mask the pixels of cam_id where img is not 0
+    void setMask (int cam_id, Image const& img);
+
+    // mask of one camera, nullptr if the camera has no mask
+    PixelMask const* getMask (int cam_id) const;
 };
 
 #endif
\ No newline at end of file
@@ -6,6 +6,25 @@
 //
 //	Created by Shijie Zhong 07/06/2022 
 //
+//  Image input of one camera (detected from the file given to loadImgPath):
+//      path list       text file with one tiff path per frame
+//      multi-page tiff all frames in one tiff file, one page per frame
+//      raw stack       all frames in one binary file with the header below
+//  stacks are memory mapped, uncompressed frames are served without copy
+//
+//  Raw stack layout (native little endian):
+//  Header (64 bytes)
+//      char[8]   magic            "OLPTSTK"
+//      uint32    version          IMGSTACK_VERSION
+//      uint32    bits_per_sample  8, 16, 32 or 64 (unsigned integer)
+//      uint32    n_row
+//      uint32    n_col
+//      uint64    n_frame
+//      uint64    frame_offset     file offset of frame 0
+//      uint64    frame_stride     bytes from one frame to the next, >= n_row*n_col*bits_per_sample/8
+//      uint64    reserved[2]
+//  Frames: row-major pixels, top-left origin
+//
 
 #ifndef IMAGEIO_H
 #define IMAGEIO_H
@@ -17,13 +36,26 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <map>
+#include <set>
+#include <list>
+#include <algorithm>
 #include <cstring> 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <limits>
 
 #include <tiff.h>
 #include <tiffio.h>
 
 #include "Matrix.h"
 #include "STBCommons.h"
+#include "TextIO.h"
 
 
 #define IMAGEIO_CHECK_CALL(call) \
@@ -36,6 +68,11 @@
 #define MAX_TILE_SIZE   (1 << 30)
 #define BITS_PER_BYTE    8
 
+#define IMGSTACK_MAGIC "OLPTSTK"
+#define IMGSTACK_VERSION 1
+
+#define IMG_PREPROC_MAX_WINDOW 256 // max frames in the background window
+
 #ifndef __IPL_H__
    typedef unsigned char uchar;
    typedef unsigned short ushort;
@@ -49,6 +86,60 @@ struct ImageParam
     int n_channel;
 };
 
+enum ImageSourceID
+{
+    IMG_PATH_LIST = 0,
+    IMG_TIFF_STACK,
+    IMG_RAW_STACK
+};
+
+struct ImageStackHeader
+{
+    char magic[8] = IMGSTACK_MAGIC;
+    uint32_t version = IMGSTACK_VERSION;
+    uint32_t bits_per_sample = 0;
+    uint32_t n_row = 0;
+    uint32_t n_col = 0;
+    uint64_t n_frame = 0;
+    uint64_t frame_offset = sizeof(ImageStackHeader);
+    uint64_t frame_stride = 0;
+    uint64_t reserved[2] = {0, 0};
+};
+
+// one page of a multi-page tiff
+struct ImageStackFrame
+{
+    uint64_t dir_offset = 0;  // tiff directory offset
+    int64_t data_offset = -1; // file offset of contiguous uncompressed pixels, -1: decoded by libtiff
+    int n_row = 0;
+    int n_col = 0;
+    int bits_per_sample = 0;
+    bool is_vert_flip = false; // rows are stored bottom-up
+};
+
+// Raw pixels of one image in the sample type of the file
+//  rows are stored in file order, row(i) uses a signed stride so flipped images are not copied
+//  the storage is kept across frames, loading images of the same size does not allocate
+//  frames of an uncompressed stack are a view into the mapped file, valid while the ImageIO keeps the file
+struct ImageBuffer
+{
+    int n_row = 0;
+    int n_col = 0;
+    int bits_per_sample = 0;
+    std::ptrdiff_t row_stride = 0; // bytes from row i to row i+1, negative for vertically flipped images
+    size_t row0_offset = 0;        // bytes from data to row 0
+    std::vector<uchar> data;
+    std::vector<uchar> tile;       // one decoded tile for tiled files
+    uchar const* view = nullptr;   // pixels in a mapped stack, data is not used if set
+    PixelRange roi;                // region that is loaded, the other pixels are not valid
+
+    uchar const* row (int i) const { return (view ? view : data.data()) + row0_offset + i * row_stride; };
+
+    // convert to intensity image, the storage of image is reused if the size matches
+    //  pixels outside roi are 0
+    void toImage (Image& image) const;
+};
+
 class ImageIO
 {
 private:
@@ -65,9 +156,28 @@ private:
 
     int _img_id = -1;          // current image index
     std::vector<std::string> _img_path; // path to all images of one camera
+    ImageBuffer _buffer;       // reused by loadImg
+
+    // image stack
+    ImageSourceID _source = IMG_PATH_LIST;
+    std::shared_ptr<MappedFile> _stack_map;    // shared by copies, read only
+    ImageStackHeader _stack_header;            // raw stack
+    std::vector<ImageStackFrame> _stack_frame; // multi-page tiff
+    std::shared_ptr<TIFF> _stack_tif;          // opened on the first compressed page, not shared by copies
+
+    // only the roi is decoded
+    PixelRange _roi;
+    bool _is_roi = false;
+    PixelRange getDecodeRegion () const; // roi clipped to the current image, or the whole image
 
     void init ();
 
+    // read the current directory of an open tiff into buffer
+    void readTiff (TIFF* tif, ImageBuffer& buffer);
+
+    void loadRawStack (std::string const& file);
+    void loadTiffStack (std::string const& file);
+
 public:
     ImageIO () {};
     ImageIO (std::string folder_path, std::string file_img_path);
@@ -77,6 +187,7 @@ public:
     // Load path
     //  every filename should end with ';'
     // input: a main folder path, a file storing all the img paths 
+    //  or a multi-page tiff / raw stack with all frames
     void loadImgPath (std::string folder_path, std::string file_img_path);
 
     // Load Image
@@ -84,7 +195,13 @@ public:
     // output: intensity matrix
     Image loadImg (int img_id);
 
-    // Save Image
+    // Load image into a reused buffer, whole strips/tiles are decoded into buffer without conversion
+    void loadImgInto (int img_id, ImageBuffer& buffer);
+
+    // Load image into a reused intensity matrix, no allocation if the size matches
+    void loadImgInto (int img_id, Image& image);
+
+    // Save Image, the rows are written top-down (ORIENTATION_TOPLEFT)
     void saveImg (std::string save_path, Image const& image);
 
     // Set image info 
@@ -98,6 +215,130 @@ public:
 
     // Get image path
     std::vector<std::string> getImgPath () const {return _img_path;};
+
+    // Get number of images
+    int getNumOfImg () const;
+
+    // Only load the region seen by the camera (e.g. CamList::getROI)
+    //  the image keeps its full size, pixels outside the roi are 0
+    void setROI (PixelRange const& roi);
+    PixelRange getROI () const {return getDecodeRegion();};
+
+    ImageSourceID getSource () const {return _source;};
+};
+
+
+// Preprocessing applied when an image is loaded
+//  out = raw - background, values below threshold are 0, values above clip_max are clip_max
+struct PreprocParam
+{
+    BackgroundTypeID bg_type = BG_NONE;
+    int n_window = 1;      // frames in the background window, centered on the frame (shifted at the ends of the sequence)
+    double threshold = 0;  // intensity below is set to 0 after subtraction
+    double clip_max = -1;  // intensity above is clipped, < 0: no clip
+};
+
+
+// Streaming background subtraction of one camera
+//  the raw samples of the frames in the window are kept, frames processed in order
+//  are decoded once: each new frame only loads the frame entering the window
+//  background, subtraction, threshold and clip are computed from the raw samples
+//  in one pass per row (typed kernels), no intermediate intensity image is made
+//  min and median are taken over the kept frames, the mean is updated with a running sum
+class Preprocessor
+{
+public:
+    Preprocessor () {};
+    Preprocessor (PreprocParam const& param) : _param(param) {};
+    ~Preprocessor () {};
+
+    void setParam (PreprocParam const& param) { _param = param; reset(); };
+    PreprocParam getParam () const { return _param; };
+
+    // load frame img_id of imgio and its background window, write the preprocessed image
+    //  the storage of image is reused if the size matches, pixels outside the roi of imgio are 0
+    void process (ImageIO& imgio, int img_id, Image& image);
+
+    // drop the kept frames, e.g. after the images or roi of imgio are changed
+    void reset ();
+
+    // number of frames decoded since the last reset
+    int getNumOfDecode () const { return _n_decode; };
+
+private:
+    PreprocParam _param;
+    std::vector<ImageBuffer> _frame; // raw frames of the window, slots are reused
+    std::vector<int> _frame_id;      // img_id in each slot, -1: empty
+    std::vector<double> _sum;        // running sum of the window for BG_MEAN
+    bool _is_sum = false;
+    std::vector<uint64_t> _work;     // one row of the typed background
+    int _n_decode = 0;
+
+    void addSum (ImageBuffer const& buffer, double sign);
+};
+
+
+// Prefetch the images of all cameras on a background thread
+//  the frames after the last requested one are loaded ahead, cameras are decoded in parallel,
+//  so disk and decode of the next frames overlap with the processing of the current frame
+//  with setPreproc the background is removed in the same pass (see Preprocessor)
+//  decoded frames are kept in an LRU cache, a frame requested again (e.g. after OTF calibration) is not reloaded
+//  the ImageIO objects are used by the loader thread and must not be used until stop()
+class FrameLoader
+{
+public:
+    FrameLoader () {};
+    ~FrameLoader () { stop(); };
+
+    FrameLoader (FrameLoader const&) = delete;
+    FrameLoader& operator= (FrameLoader const&) = delete;
+
+    // start prefetching from frame_start, frames are limited to [frame_start, frame_end]
+    //  n_frame_ahead: number of frames loaded after the last requested frame
+    //  n_frame_cache: max number of decoded frames kept, at least n_frame_ahead+1
+    void start (std::vector<ImageIO>& imgio_list, int frame_start, int frame_end, int n_frame_ahead = 2, int n_frame_cache = 8);
+
+    // preprocess the images of each camera when they are loaded, call before start
+    //  param_list: one per camera, empty: no preprocessing
+    void setPreproc (std::vector<PreprocParam> const& param_list);
+
+    // get the images of all cameras of one frame, wait if it is not loaded yet
+    //  a failed load is rethrown here
+    //  several threads may wait at once, the prefetch window starts at the smallest waiting frame
+    void getFrame (int frame_id, std::vector<Image>& img_list);
+
+    // change the prefetch window while the loader is running, e.g. for frames processed in parallel
+    void setFrameAhead (int n_frame_ahead, int n_frame_cache);
+
+    // stop the loader thread and clear the cache
+    void stop ();
+
+    // number of frames decoded since start, for checking cache hits
+    int getNumOfLoad () const { return _n_load; };
+
+private:
+    std::vector<ImageIO>* _imgio_list = nullptr;
+    int _frame_start = 0;
+    int _frame_end = -1;
+    int _n_frame_ahead = 2;
+    int _n_frame_cache = 8;
+    int _frame_req = 0; // smallest waiting (or last requested) frame, frames [_frame_req, _frame_req+_n_frame_ahead] are prefetched
+    std::multiset<int> _wait_list; // frames requested by the waiting getFrame calls
+    std::atomic<int> _n_load = 0;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::map<int, std::vector<Image>> _cache;
+    std::list<int> _lru; // cached frame ids, most recently used first
+    std::map<int, std::exception_ptr> _error; // failed frames
+    std::vector<std::vector<Image>> _free; // images of an evicted frame, reused by the next load
+    std::vector<Preprocessor> _preproc_list; // one per camera, used by the loader thread
+    bool _is_stop = false;
+
+    bool isInWindow (int frame_id) const { return frame_id >= _frame_req && frame_id <= _frame_req + _n_frame_ahead; };
+    void touch (int frame_id);
+    void run ();
 };
 
 #endif
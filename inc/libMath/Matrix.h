@@ -24,6 +24,7 @@
 #include <initializer_list>
 
 #include "STBCommons.h"
+#include "TextIO.h"
 
 template <class T>
 class Matrix
@@ -44,6 +45,7 @@ public:
     // Constructor
     Matrix () {};
     Matrix (Matrix<T> const& mtx); // deep copy
+    Matrix (Matrix<T>&& mtx) noexcept; // take over the storage, mtx is left empty
     Matrix (int dim_row, int dim_col, T val);
 
     // dim_row, dim_col must be compatible with mtx
@@ -92,6 +94,7 @@ public:
 
     // Matrix calculation
     Matrix<T>& operator=  (Matrix<T> const& mtx);
+    Matrix<T>& operator=  (Matrix<T>&& mtx) noexcept;
     bool       operator== (Matrix<T> const& mtx);
     bool       operator!= (Matrix<T> const& mtx);
     Matrix<T>  operator+  (Matrix<T> const& mtx) const;
@@ -160,8 +163,13 @@ public:
     Image (int dim_row, int dim_col, double val) : Matrix<double>(dim_row, dim_col, val) {};
     Image (std::initializer_list<std::initializer_list<double>> mtx) : Matrix<double>(mtx) {};
     Image (const Image& mtx) : Matrix<double>(mtx) {};
+    Image (Image&& mtx) noexcept : Matrix<double>(std::move(mtx)) {};
     Image (const Matrix<double>& mtx) : Matrix<double>(mtx) {};
     explicit Image (std::string file_name) : Matrix<double>(file_name) {};
+
+    // moving an image hands over its pixels without copying them
+    Image& operator= (const Image& mtx) { Matrix<double>::operator=(mtx); return *this; };
+    Image& operator= (Image&& mtx) noexcept { Matrix<double>::operator=(std::move(mtx)); return *this; };
 };
 
 #include "Matrix.hpp"
@@ -0,0 +1,137 @@
+//
+//  PointGrid.h
+//
+//  header file of class PointGrid
+//  uniform 3D grid over point centers for radius bounded neighbor search
+//
+
+#ifndef POINTGRID_H
+#define POINTGRID_H
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
+
+#include "STBCommons.h"
+#include "Matrix.h"
+
+// Cells are stored in CSR layout: the point ids of cell c are
+//  _id_list[_cell_start[c]] ... _id_list[_cell_start[c+1]-1], in ascending order.
+// The number of cells is capped to O(n_pt), the cell size is enlarged if needed.
+class PointGrid
+{
+public:
+    PointGrid () {};
+    PointGrid (std::vector<Pt3D> const& pt_list, double cell_size) { build(pt_list, cell_size); };
+    template<class T>
+    PointGrid (std::vector<T> const& obj_list, double cell_size) { build(obj_list, cell_size); };
+    ~PointGrid () {};
+
+    // build grid, cell_size [mm] is usually the search radius
+    void build (std::vector<Pt3D> const& pt_list, double cell_size);
+
+    // build grid from any object list with _pt_center
+    template<class T>
+    void build (std::vector<T> const& obj_list, double cell_size)
+    {
+        int n_pt = obj_list.size();
+        std::vector<double> xyz(3*n_pt);
+        for (int i = 0; i < n_pt; i ++)
+        {
+            xyz[3*i]   = obj_list[i]._pt_center[0];
+            xyz[3*i+1] = obj_list[i]._pt_center[1];
+            xyz[3*i+2] = obj_list[i]._pt_center[2];
+        }
+        buildXYZ(xyz, cell_size);
+    };
+
+    int getNumOfPt () const { return _n_pt; };
+
+    // find ids of points with dist < radius, ids are in ascending order
+    void findNeighbor (std::vector<int>& id_list, Pt3D const& pt, double radius) const;
+
+    // find the nearest point with dist < radius, return -1 if not found
+    //  is_skip(id) = true: the point is ignored
+    //  ties are resolved to the smallest id (same as a linear scan)
+    template<class Skip>
+    int findNearest (Pt3D const& pt, double radius, Skip is_skip) const
+    {
+        int cell_min[3], cell_max[3];
+        if (!getCellRange(cell_min, cell_max, pt, radius))
+        {
+            return -1;
+        }
+
+        double min_dist2 = radius * radius;
+        int min_id = -1;
+        for (int iz = cell_min[2]; iz <= cell_max[2]; iz ++)
+        {
+            for (int iy = cell_min[1]; iy <= cell_max[1]; iy ++)
+            {
+                for (int ix = cell_min[0]; ix <= cell_max[0]; ix ++)
+                {
+                    int cell = cellIndex(ix, iy, iz);
+                    for (int k = _cell_start[cell]; k < _cell_start[cell+1]; k ++)
+                    {
+                        int id = _id_list[k];
+                        if (is_skip(id))
+                        {
+                            continue;
+                        }
+
+                        double dist2 = calDist2(id, pt);
+                        if (dist2 < min_dist2 || (dist2 == min_dist2 && min_id >= 0 && id < min_id))
+                        {
+                            min_dist2 = dist2;
+                            min_id = id;
+                        }
+                    }
+                }
+            }
+        }
+        return min_id;
+    };
+
+    int findNearest (Pt3D const& pt, double radius) const
+    {
+        return findNearest(pt, radius, [](int){ return false; });
+    };
+
+    // mark repeated points: is_repeat[j] = 1 if a non-repeated point i < j has dist < tol_3d
+    //  ("first index wins", same result as the sequential O(N^2) check)
+    // return number of repeated points
+    int findRepeat (std::vector<int>& is_repeat, double tol_3d) const;
+
+private:
+    int _n_pt = 0;
+    int _n_cell[3] = {0, 0, 0};
+    double _cell_size = 0;
+    double _origin[3] = {0, 0, 0};
+    std::vector<double> _xyz; // point centers, size = 3*n_pt
+    std::vector<int> _cell_start; // size = n_cell+1
+    std::vector<int> _id_list; // size = n_pt
+
+    void buildXYZ (std::vector<double> const& xyz, double cell_size);
+
+    int cellIndex (int ix, int iy, int iz) const
+    {
+        return (iz * _n_cell[1] + iy) * _n_cell[0] + ix;
+    };
+
+    int cellCoord (double x, int axis) const;
+
+    // cells overlapping [pt-radius, pt+radius], false if no cell
+    bool getCellRange (int* cell_min, int* cell_max, Pt3D const& pt, double radius) const;
+
+    double calDist2 (int id, Pt3D const& pt) const
+    {
+        double dx = _xyz[3*id] - pt[0];
+        double dy = _xyz[3*id+1] - pt[1];
+        double dz = _xyz[3*id+2] - pt[2];
+        return dx*dx + dy*dy + dz*dz;
+    };
+};
+
+#endif // !POINTGRID_H
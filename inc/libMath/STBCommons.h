@@ -3,6 +3,11 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 #define SAVEPRECISION 8
 
@@ -28,6 +33,7 @@
 #define UNLINKED -1
 #define MAX_ERR_LINEARFIT 5e-2
 #define LEN_LONG_TRACK 7
+#define LEN_TRACK_LIVE 8 // number of full objects kept in a track
 
 struct PixelRange 
 {
@@ -120,6 +126,92 @@ struct AxisLimit
     }
 };
 
+// Static pixel mask of one camera (reflections, dead pixels, frame edges)
+//  one byte per pixel: 1 = masked, 0 = used
+//  no object is detected on a masked pixel and the stereo match skips it
+struct PixelMask
+{
+    int n_row = 0;
+    int n_col = 0;
+    std::vector<uint8_t> data; // data[row*n_col+col]
+
+    void config (int row, int col)
+    {
+        n_row = row;
+        n_col = col;
+        data.assign(size_t(n_row) * n_col, 0);
+    };
+
+    bool isEmpty () const
+    {
+        return data.empty();
+    };
+
+    bool operator() (int row, int col) const
+    {
+        return data[size_t(row) * n_col + col];
+    };
+
+    void set (int row, int col, bool is_masked = true)
+    {
+        data[size_t(row) * n_col + col] = is_masked;
+    };
+
+    uint8_t const* row (int row_id) const
+    {
+        return data.data() + size_t(row_id) * n_col;
+    };
+
+    // first column >= col in [col, col_end) that is not masked, col_end if none
+    //  masked runs are skipped 8 pixels per compare
+    int nextUnmasked (int row_id, int col, int col_end) const
+    {
+        uint8_t const* ptr = row(row_id);
+        uint64_t word = 0;
+        while (col + 8 <= col_end)
+        {
+            std::memcpy(&word, ptr + col, 8);
+            if (word != 0x0101010101010101ULL)
+            {
+                break;
+            }
+            col += 8;
+        }
+        while (col < col_end && ptr[col])
+        {
+            col ++;
+        }
+        return col;
+    };
+
+    int getNumOfMasked () const
+    {
+        return int(std::count(data.begin(), data.end(), uint8_t(1)));
+    };
+};
+
+// Remove all elements with is_remove[i] != 0 in one pass (stable compaction)
+//  the kept elements are moved forward in order, the tail is erased once,
+//  so removing any number of elements is O(n) instead of O(n) per erase
+//  list: std::vector or std::deque, is_remove.size() == list.size()
+template<class Container, class Flag>
+void removeFlagged (Container& list, std::vector<Flag> const& is_remove)
+{
+    size_t n_keep = 0;
+    for (size_t i = 0; i < list.size(); i ++)
+    {
+        if (!is_remove[i])
+        {
+            if (n_keep != i)
+            {
+                list[n_keep] = std::move(list[i]);
+            }
+            n_keep ++;
+        }
+    }
+    list.erase(list.begin() + n_keep, list.end());
+}
+
 enum ErrorTypeID
 {
     error_size = 1,
@@ -144,6 +236,27 @@ enum FrameTypeID
     CURR_FRAME
 };
 
+enum PredTypeID
+{
+    PRED_WIENER, // closed-form Wiener (minimum norm AR) filter
+    PRED_POLY,   // least-squares polynomial extrapolation
+    PRED_KALMAN  // constant-acceleration Kalman filter
+};
+
+enum BackgroundTypeID
+{
+    BG_NONE,   // no background subtraction
+    BG_MIN,    // minimum over the sliding window
+    BG_MEDIAN, // median over the sliding window
+    BG_MEAN    // mean over the sliding window
+};
+
+enum TrackFormatID
+{
+    TRACK_CSV, // text, one row per point
+    TRACK_BIN  // binary columnar track file (.lpt), see TrackFile.h
+};
+
 enum TrackStatusID
 {
     LONG_ACTIVE,
@@ -0,0 +1,145 @@
+//
+//  TextIO.h
+//
+//  fast text (csv) output and input
+//  numbers are formatted with std::to_chars and parsed with std::from_chars,
+//  the output text is the same as std::ostream with the same precision and float format
+//  read-only memory map of binary files
+//
+
+#ifndef TEXTIO_H
+#define TEXTIO_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <charconv>
+#include <type_traits>
+#include <algorithm>
+#include <omp.h>
+
+#include "STBCommons.h"
+
+#define TEXTIO_BLOCK_SIZE 1024 // number of items formatted by one task
+
+// Text buffer with stream-like output
+class TextBuffer
+{
+public:
+    std::string _str;
+
+    TextBuffer (int precision = 6, std::chars_format fmt = std::chars_format::general)
+        : _precision(precision), _fmt(fmt) {};
+    // same precision and float format (default, fixed, scientific) as a stream
+    explicit TextBuffer (std::ios_base const& os);
+    ~TextBuffer () {};
+
+    TextBuffer& operator<< (double x);
+    TextBuffer& operator<< (float x) { return *this << double(x); };
+    TextBuffer& operator<< (char c) { _str.push_back(c); return *this; };
+    TextBuffer& operator<< (char const* s) { _str.append(s); return *this; };
+    TextBuffer& operator<< (std::string const& s) { _str.append(s); return *this; };
+
+    template<class T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    TextBuffer& operator<< (T x)
+    {
+        char buf[24];
+        std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), x);
+        _str.append(buf, res.ptr);
+        return *this;
+    };
+
+    void clear () { _str.clear(); };
+    size_t size () const { return _str.size(); };
+
+private:
+    int _precision = 6;
+    std::chars_format _fmt = std::chars_format::general;
+};
+
+
+// write n_item items to os in order, items are formatted in parallel blocks
+//  format(TextBuffer& buffer, int i): append item i to buffer
+//  numbers use the precision and float format of os
+template<class Format>
+void writeTextParallel (std::ostream& os, int n_item, Format const& format, int block_size = TEXTIO_BLOCK_SIZE)
+{
+    int n_block = (n_item + block_size - 1) / block_size;
+    if (n_block == 0)
+    {
+        return;
+    }
+
+    // format a limited number of blocks per round to bound the memory
+    int n_block_round = std::min(4 * omp_get_max_threads(), n_block);
+    std::vector<TextBuffer> buffer_list(n_block_round, TextBuffer(os));
+
+    for (int b_start = 0; b_start < n_block; b_start += n_block_round)
+    {
+        int b_end = std::min(b_start + n_block_round, n_block);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int b = b_start; b < b_end; b ++)
+        {
+            TextBuffer& buffer = buffer_list[b - b_start];
+            buffer.clear();
+
+            int i_end = std::min((b+1) * block_size, n_item);
+            for (int i = b * block_size; i < i_end; i ++)
+            {
+                format(buffer, i);
+            }
+        }
+
+        for (int b = b_start; b < b_end; b ++)
+        {
+            os.write(buffer_list[b - b_start]._str.data(), buffer_list[b - b_start].size());
+        }
+    }
+}
+
+
+// read a whole file into text
+void readTextFile (std::string& text, std::string const& file);
+
+// parse csv rows in parallel (rows are split on '\n', blank rows are skipped)
+//  n_skip_row: number of header rows to skip
+//  n_col: number of values kept per row, <= 0: number of values in the first row
+//  a row is parsed up to n_col values or the first non-number, missing values are 0
+//  data: row-major, size = n_row * n_col
+//  return n_row
+int parseCSV (std::vector<double>& data, int& n_col, std::string const& text, int n_skip_row = 0);
+
+// parseCSV on the memory map of file (see MappedFile), the text is not copied
+int readCSV (std::vector<double>& data, int& n_col, std::string const& file, int n_skip_row = 0);
+
+
+// Read-only memory map of a whole file
+//  pointers into the map stay valid while the object lives
+class MappedFile
+{
+public:
+    MappedFile (std::string const& file);
+    ~MappedFile ();
+
+    MappedFile (MappedFile const&) = delete;
+    MappedFile& operator= (MappedFile const&) = delete;
+
+    char const* data () const { return _data; };
+    size_t size () const { return _size; };
+    std::string const& getFile () const { return _file; };
+
+private:
+    std::string _file;
+    char const* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _file_handle = nullptr;
+    void* _map_handle = nullptr;
+#endif
+
+    void unmap ();
+};
+
+#endif // !TEXTIO_H
@@ -23,7 +23,7 @@ class ObjectFinder2D
 private:
     void findTracer2D(std::vector<Tracer2D>& tr2d_list, Image const& img, double max_intensity, double min_intensity, double r_px=2);
 
-    void findTracer2D(std::vector<Tracer2D>& tr2d_list, Image const& img, double max_intensity, double min_intensity, double r_px, PixelRange const& region);
+    void findTracer2D(std::vector<Tracer2D>& tr2d_list, Image const& img, double max_intensity, double min_intensity, double r_px, PixelRange const& region, PixelMask const* mask);
 
 public:
     ObjectFinder2D() {};
@@ -35,8 +35,16 @@ public:
     template <class T> 
     void findObject2D(std::vector<T>& obj2d_list, Image const& img, std::vector<double> const& properties);
 
+    // only search in region, pixels with mask != 0 are skipped (mask = nullptr: no mask)
     template <class T>
-    void findObject2D(std::vector<T>& obj2d_list, Image const& img, std::vector<double> const& properties, PixelRange const& region);
+    void findObject2D(std::vector<T>& obj2d_list, Image const& img, std::vector<double> const& properties, PixelRange const& region, PixelMask const* mask = nullptr);
+
+    // Mask the pixels where objects are found in more than rate_max of the images
+    //  (reflections, hot pixels), a peak also counts on its 8 neighbours for sub-pixel jitter
+    //  input: images of one camera, object properties
+    //  output: mask with the size of the images
+    template <class T>
+    void findMask(PixelMask& mask, std::vector<Image> const& img_list, std::vector<double> const& properties, double rate_max);
 
 };
 
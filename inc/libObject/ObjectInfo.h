@@ -14,6 +14,7 @@
 #include "Matrix.h"
 #include "Camera.h"
 #include "STBCommons.h"
+#include "TextIO.h"
 
 // 2D object classes
 class Object2D
@@ -50,6 +51,7 @@ public:
     Object3D (Object3D const& object) : _pt_center(object._pt_center) {};
     Object3D (Pt3D const& pt_center) : _pt_center(pt_center) {};
     void saveObject3D (std::ofstream& output, int n_cam_all) const {};
+    void saveObject3D (TextBuffer& output, int n_cam_all) const {};
     void projectObject2D (std::vector<int> const& camid_list, std::vector<Camera> const& cam_list_all) {};
     ~Object3D () {};
 };
@@ -93,6 +95,7 @@ public:
 
     // save the 3D tracer to a file
     void saveObject3D (std::ofstream& output, int n_cam_all) const;
+    void saveObject3D (TextBuffer& output, int n_cam_all) const;
 };
 
 #endif
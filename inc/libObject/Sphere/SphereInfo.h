@@ -54,6 +54,7 @@ public:
 
     // save the 3D tracer to a file
     void saveObject3D (std::ofstream& output, int n_cam_all) const;
+    void saveObject3D (TextBuffer& output, int n_cam_all) const;
 };
 
 #endif
\ No newline at end of file
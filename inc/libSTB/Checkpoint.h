@@ -0,0 +1,220 @@
+//
+//  Checkpoint.h
+//
+//  binary checkpoint stream: exact save/restore of the STB state
+//
+//  File layout (native endian, sequential fields, no padding):
+//      char[8]   magic      "OLPTCKP"
+//      uint32    version    CHECKPOINT_VERSION
+//      ...       fields in the order they are written (see STB::saveCheckpoint)
+//      char[8]   magic      end mark, a truncated file is rejected
+//
+//  scalars are written as raw bytes, vectors as uint64 size + raw elements,
+//  strings as uint64 size + chars, Matrix<double> as int32 rows, int32 cols + row-major values
+//
+//  The file is first written to <file>.tmp and renamed when closed,
+//  so an interrupted save never replaces the previous checkpoint.
+//
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "STBCommons.h"
+#include "Matrix.h"
+#include "ObjectInfo.h"
+#include "OTF.h"
+#include "Track.h"
+
+#define CHECKPOINT_MAGIC "OLPTCKP"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_BUFFER_SIZE 16777216 // bytes buffered before writing to the file
+
+class CheckpointWriter
+{
+public:
+    CheckpointWriter () {};
+    ~CheckpointWriter ();
+
+    CheckpointWriter (CheckpointWriter const&) = delete;
+    CheckpointWriter& operator= (CheckpointWriter const&) = delete;
+
+    // open <file>.tmp and write the header
+    void open (std::string const& file);
+
+    // write the end mark, close and rename <file>.tmp to file
+    void close ();
+
+    bool isOpen () const { return _output.is_open(); };
+
+    // raw bytes
+    void writeBytes (void const* data, size_t n_byte);
+
+    // scalars and enums
+    template<class T, typename std::enable_if<std::is_trivially_copyable<T>::value, int>::type = 0>
+    void write (T const& x)
+    {
+        writeBytes(&x, sizeof(T));
+    };
+
+    // trivially copyable elements are written in one block
+    template<class T>
+    void write (std::vector<T> const& x)
+    {
+        write(uint64_t(x.size()));
+        if constexpr (std::is_trivially_copyable<T>::value)
+        {
+            writeBytes(x.data(), x.size() * sizeof(T));
+        }
+        else
+        {
+            for (size_t i = 0; i < x.size(); i ++)
+            {
+                write(x[i]);
+            }
+        }
+    };
+
+    void write (std::string const& x);
+    void write (Matrix<double> const& x);
+    void write (AxisLimit const& x);
+    void write (OTFParam const& x);
+    void write (Tracer2D const& x);
+    void write (Tracer3D const& x);
+
+    template<class T3D>
+    void write (Track<T3D> const& track);
+
+    template<class T3D>
+    void write (std::deque<Track<T3D>> const& track_list)
+    {
+        write(uint64_t(track_list.size()));
+        for (size_t i = 0; i < track_list.size(); i ++)
+        {
+            write(track_list[i]);
+        }
+    };
+
+private:
+    std::string _file;
+    std::ofstream _output;
+    std::vector<char> _buffer;
+};
+
+
+class CheckpointReader
+{
+public:
+    // read the whole file and check the header
+    CheckpointReader (std::string const& file);
+    ~CheckpointReader () {};
+
+    CheckpointReader (CheckpointReader const&) = delete;
+    CheckpointReader& operator= (CheckpointReader const&) = delete;
+
+    // check the end mark, throw if the file has unread or missing bytes
+    void close ();
+
+    void readBytes (void* data, size_t n_byte);
+
+    template<class T, typename std::enable_if<std::is_trivially_copyable<T>::value, int>::type = 0>
+    void read (T& x)
+    {
+        readBytes(&x, sizeof(T));
+    };
+
+    template<class T>
+    void read (std::vector<T>& x)
+    {
+        if constexpr (std::is_trivially_copyable<T>::value)
+        {
+            x.resize(readSize(sizeof(T)));
+            readBytes(x.data(), x.size() * sizeof(T));
+        }
+        else
+        {
+            x.resize(readSize(1));
+            for (size_t i = 0; i < x.size(); i ++)
+            {
+                read(x[i]);
+            }
+        }
+    };
+
+    void read (std::string& x);
+    void read (Matrix<double>& x);
+    void read (AxisLimit& x);
+    void read (OTFParam& x);
+    void read (Tracer2D& x);
+    void read (Tracer3D& x);
+
+    template<class T3D>
+    void read (Track<T3D>& track);
+
+    template<class T3D>
+    void read (std::deque<Track<T3D>>& track_list)
+    {
+        track_list.clear();
+        track_list.resize(readSize(1));
+        for (size_t i = 0; i < track_list.size(); i ++)
+        {
+            read(track_list[i]);
+        }
+    };
+
+private:
+    std::string _file;
+    std::string _data;
+    size_t _pos = 0;
+
+    // read a vector size, check that n_byte_min bytes per element are left
+    size_t readSize (size_t n_byte_min);
+};
+
+
+template<class T3D>
+void CheckpointWriter::write (Track<T3D> const& track)
+{
+    write(track._obj3d_list);
+    write(track._t_list);
+    write(track._n_obj3d);
+    write(track._active);
+    write(track._track_id);
+    write(track._pt_list);
+    write(track._error_list);
+    write(track._obs_start);
+    write(track._obs_camid_list);
+    write(track._obs_pt_list);
+}
+
+template<class T3D>
+void CheckpointReader::read (Track<T3D>& track)
+{
+    read(track._obj3d_list);
+    read(track._t_list);
+    read(track._n_obj3d);
+    read(track._active);
+    read(track._track_id);
+    read(track._pt_list);
+    read(track._error_list);
+    read(track._obs_start);
+    read(track._obs_camid_list);
+    read(track._obs_pt_list);
+
+    if (track._t_list.size() != track._n_obj3d || track._pt_list.size() != 3*track._t_list.size() || track._obs_start.size() != track._t_list.size()+1)
+    {
+        std::cerr << "CheckpointReader::read error at line " << __LINE__ << ":\n"
+                  << "Inconsistent track in checkpoint " << _file << std::endl;
+        throw error_io;
+    }
+}
+
+#endif // !CHECKPOINT_H
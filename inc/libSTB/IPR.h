@@ -5,8 +5,10 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <map>
 
 #include "Matrix.h"
+#include "TextIO.h"
 #include "Camera.h"
 #include "ObjectInfo.h"
 #include "ObjectFinder.h"
@@ -34,6 +36,23 @@ struct IPRParam
     int n_loop_shake = 1; // number of shake times, using gradient descent
     double shake_width = 2.4e-2; // [mm]
     double ghost_threshold = 0.1; // Ghost threshold: remove residue > mean + ghost_threshold * std
+    bool shake_gauss_seidel = false; // shake tracers color by color (graph coloring on 2D footprints)
+    double shake_tol_conv_pos = 0; // [mm] freeze a tracer once its shift is below it (0: always shake)
+    double shake_tol_conv_res = 0; // freeze a tracer once its relative residue change is below it (0: always shake)
+};
+
+
+// Stereo match and shake for one number of used cameras
+//  kept by IPR across runIPR calls, so the object ID maps and residue buffers are allocated once
+struct IPRWorkspace
+{
+    StereoMatch stereo_match;
+    Shake shake;
+
+    IPRWorkspace (CamList const& cam_list, SMParam const& match_param, IPRParam const& param)
+        : stereo_match(match_param, cam_list), 
+          shake(cam_list, param.shake_width, param.tol_3d * 3, param.ghost_threshold, param.n_loop_shake, param.n_thread, param.shake_gauss_seidel, param.shake_tol_conv_pos, param.shake_tol_conv_res) 
+    {};
 };
 
 
@@ -43,16 +62,35 @@ private:
     CamList& _cam_list;
     int _n_cam_all;
 
+    // Workspaces, key: number of used cameras
+    //  created on first use, rebuilt if the shake parameters in _param change
+    std::map<int, IPRWorkspace> _ws_map;
+    IPRParam _ws_param;
+
     void resetCamIDList ();
 
+    // workspace for the cameras in _cam_list.useid_list
+    IPRWorkspace& getWorkspace ();
+
 public:
     std::vector<Image> _imgRes_list;
     IPRParam _param;
 
+    // no image yet: set _imgRes_list before runIPR
+    //  a long-lived IPR reuses its workspaces for every frame
+    IPR (CamList& cam_list, IPRParam const& param) 
+        : _cam_list(cam_list), _n_cam_all(cam_list.cam_list.size()), _param(param) 
+    {};
+
     IPR (CamList& cam_list, std::vector<Image> const& imgOrig_list, IPRParam const& param) 
         : _cam_list(cam_list), _n_cam_all(cam_list.cam_list.size()), _imgRes_list(imgOrig_list), _param(param) 
     {};
 
+    // take over the images without copying them, runIPR turns them into residue images in place
+    IPR (CamList& cam_list, std::vector<Image>&& imgOrig_list, IPRParam const& param) 
+        : _cam_list(cam_list), _n_cam_all(cam_list.cam_list.size()), _imgRes_list(std::move(imgOrig_list)), _param(param) 
+    {};
+
     ~IPR () {};
 
     // Run IPR
@@ -77,10 +115,9 @@ public:
         }
         file << "\n";
 
-        for (int i = 0; i < obj3d_list.size(); i ++)
-        {
-            obj3d_list[i].saveObject3D(file, _n_cam_all);
-        }
+        writeTextParallel(file, obj3d_list.size(), [&](TextBuffer& buffer, int i){
+            obj3d_list[i].saveObject3D(buffer, _n_cam_all);
+        });
         file.close();
     };
 };
@@ -2,6 +2,7 @@
 #define STB_H
 
 #include "Matrix.h"
+#include "PointGrid.h"
 #include "Camera.h"
 #include "ObjectInfo.h"
 #include "ImageIO.h"
@@ -12,6 +13,7 @@
 #include "IPR.h"
 #include "PredField.h"
 #include "Track.h"
+#include "Checkpoint.h"
 
 #include <vector>
 #include <deque>
@@ -23,6 +25,10 @@
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <memory>
+#include <map>
+#include <thread>
+#include <mutex>
 
 namespace fs = std::filesystem;
 
@@ -35,6 +41,7 @@ public:
 
     std::deque<Track<T3D>> _short_track_active;
     std::deque<Track<T3D>> _long_track_active;
+    // finished tracks, moved to the background writers after each frame
     std::deque<Track<T3D>> _long_track_inactive; // only save very long tracks
     std::deque<Track<T3D>> _exit_track;
 
@@ -53,25 +60,64 @@ public:
     void calibrateOTF (int cam_id, int n_obj2d_max, double r_otf_calib, std::vector<Image> const& img_list);
 
 
+    // Mask the pixels of cam_id with objects in more than rate_max of img_list (persistent peaks)
+    // return: number of masked pixels
+    int findMask (int cam_id, double rate_max, std::vector<Image> const& img_list);
+
+
     // Process STB on frame frame_id
     // return img_list: residue images
     void processFrame(int frame_id, std::vector<Image>& img_list, bool is_update_img = false);
 
 
-    // Load tracks
+    // Load tracks (.csv or .lpt)
+    //  long tracks keep their global IDs, old csv files with IDs 0,1,2,... in each file are renumbered after the assigned IDs
     void loadTracks (std::string const& file, TrackStatusID status);
 
 
-    // save tracks of one status
+    // save tracks of one status, the format follows the file extension (.csv or .lpt)
     void saveTracks (std::string const& file, std::deque<Track<T3D>>& tracks);
 
-    // save all tracks at any status
+    // save all resident tracks at any status
     void saveTracksAll(std::string const& folder, int frame);
 
 
     // get obj param
     std::vector<double> getObjParam() const;
 
+
+    // Checkpoint: binary snapshot of the whole STB state after frame
+    //  (tracks with 2D observations, _ipr_matched, OTF, counters and config parameters)
+    //  finished tracks are written to disk and the current ExitTrack_/LongTrackInactive_ files are closed,
+    //  the next ones start at frame+1
+    void saveCheckpoint (std::string const& file, int frame);
+
+    // restore the state saved by saveCheckpoint, the output folder, thread number and frame range are kept
+    //  the state is unchanged if the file cannot be read, a frame outside the frame range is an error
+    // return: last processed frame, continue with processFrame(frame+1, ...)
+    int loadCheckpoint (std::string const& file);
+
+    // IPR only (option 2): the frames are independent, no tracking
+    bool isIPROnly () const { return _ipr_only; };
+
+    // IPR flag of the config, false: the initial objects are not found by IPR
+    bool isIPREnabled () const { return _ipr_flag; };
+
+    // Run IPR on frames [frame_start, frame_end], getNumOfFrameParallel() frames at a time
+    //  each frame has its own camera list, IPR workspace and share of _n_thread threads
+    //  IPR_<frame>.csv are written to InitialTrack/ in frame order, followed by the (empty) tracks of frame_end
+    //  requires isIPROnly() and isIPREnabled()
+    //  frame_loader: the workers request their frames concurrently, 
+    //   its prefetch window should cover getNumOfFrameParallel() frames (FrameLoader::setFrameAhead)
+    void runIPROnly (FrameLoader& frame_loader, int frame_start, int frame_end);
+
+    // number of frames processed in parallel by runIPROnly
+    int getNumOfFrameParallel () const;
+
+    // checkpoint saved every getCheckpointInterval() frames (0: no checkpoint)
+    int getCheckpointInterval () const { return _checkpoint_interval; };
+    std::string getCheckpointFile () const { return _output_folder + "Checkpoint.bin"; };
+
 private:
     int _first = 0; // first frame ID
     int _last = 0; // last frame ID
@@ -97,6 +143,9 @@ private:
     // Predict Field parameters
     PFParam _pf_param;
 
+    // Track prediction parameters
+    TrackPredParam _pred_param;
+
     // IPR parameters
     bool _ipr_only = false;
     IPRParam _ipr_param;
@@ -110,12 +159,51 @@ private:
     // Dummy variables to identify the no. of tracks added and subtracted 
     int _a_sa = 0, _a_la = 0, _s_sa = 0, _s_la = 0, _a_li = 0;
 
+    // Output of finished tracks
+    TrackFormatID _track_format = TRACK_CSV;
+    int _n_track_id = 0; // next global track ID
+    TrackWriter<T3D> _exit_writer; // ExitTrack_<first>_<last>
+    TrackWriter<T3D> _long_inactive_writer; // LongTrackInactive_<first>_<last>
+    int _seg_first = 0; // first frame of the current ExitTrack_/LongTrackInactive_ files
+    int _n_exit_saved = 0; // number of tracks in closed ExitTrack_ files
+    int _n_long_inactive_saved = 0; // number of tracks in closed LongTrackInactive_ files
+
+    // Checkpoint
+    int _checkpoint_interval = 0; // [frame], 0: no checkpoint
+
+    // IPR only
+    int _n_frame_parallel = 0; // frames processed in parallel, 0: one frame per thread
+
+    // Workspaces reused by every frame, created on first use
+    //  their maps and image buffers keep the capacity, copies of STB start without them
+    std::unique_ptr<IPR> _ipr_ws;     // IPR of the initial phase and on the residue images
+    std::unique_ptr<Shake> _shake_ws; // shake of the predicted objects
+
 
     // FUNCTIONS //
     void createFolder (std::string const& folder);
 
     void loadObjParam (std::stringstream& config);
 
+    // read the config parameters, counters and tracks written by saveCheckpoint
+    void readCheckpointState (CheckpointReader& input);
+
+    // stream _exit_track and _long_track_inactive to disk and release them
+    void flushTracks ();
+
+    // close the ExitTrack_/LongTrackInactive_ files, they end at frame
+    void closeTrackWriters (int frame);
+
+    // number of finished tracks written to disk or queued
+    int getNumOfExitTrack () const { return _n_exit_saved + (_exit_writer.isOpen() ? _exit_writer.getNumOfTrack() : 0); };
+    int getNumOfLongInactiveTrack () const { return _n_long_inactive_saved + (_long_inactive_writer.isOpen() ? _long_inactive_writer.getNumOfTrack() : 0); };
+
+    // file extension of saved tracks
+    std::string getTrackExt () const { return _track_format == TRACK_BIN ? ".lpt" : ".csv"; };
+
+    IPR& getIPR ();
+    Shake& getShakePred ();
+
     void runInitPhase (int frame_id, std::vector<Image>& img_list, bool is_update_img = false);
 
     void runConvPhase (int frame_id, std::vector<Image>& img_list, bool is_update_img = false);
@@ -128,19 +216,23 @@ private:
     void findRepeatObj (std::vector<int>& is_repeat, std::vector<T3D> const& obj3d_list, double tol_3d);
 
     // make all possible links for tracks
-    int makeLink (Track<T3D> const& track, int nextframe, Pt3D const& vel_curr, double radius);
+    // grid: index over _ipr_matched of nextframe
+    int makeLink (Track<T3D> const& track, int nextframe, Pt3D const& vel_curr, double radius, PointGrid const& grid);
 
-    void startTrack (int frame, PredField& pf);
+    void startTrack (int frame, PredField& pf, PointGrid const& grid);
 
     bool findPredObj (T3D& obj3d, std::vector<Image> const& img_list);
     bool checkObj2D (T3D& obj3d);
 
-    int linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& obj3d_list, int n_iter);
+    // grid: index over obj3d_list
+    // grid_track: index over _long_track_active positions at the previous frame
+    int linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& obj3d_list, PointGrid const& grid, PointGrid const& grid_track, int n_iter);
 
     bool checkLinearFit (Track<T3D> const& track);
 
-    // find nearest neighbor around a position
-    int findNN (std::vector<T3D> const& obj3d_list, Pt3D const& pt3d_est, double radius);
+    // find nearest untracked neighbor around a position
+    //  grid: PointGrid built over obj3d_list
+    int findNN (std::vector<T3D> const& obj3d_list, PointGrid const& grid, Pt3D const& pt3d_est, double radius);
 
 };
 
@@ -9,16 +9,84 @@
 #include <random>
 
 #include "Matrix.h"
+#include "PointGrid.h"
 #include "ObjectInfo.h"
 #include "Camera.h"
 #include "OTF.h"
 
+// View on a patch stored in a PatchArena
+//  (i,j) are local to the patch, (0,0) = (region.row_min, region.col_min)
+struct ImgPatch
+{
+    double* data = nullptr;
+    int n_row = 0;
+    int n_col = 0;
+
+    double  operator() (int i, int j) const { return data[i*n_col + j]; };
+    double& operator() (int i, int j) { return data[i*n_col + j]; };
+};
+
 struct ImgAugList
 {
-    std::vector<Image> img_list;
+    std::vector<ImgPatch> img_list;
     std::vector<PixelRange> region_list;
 };
 
+// Contiguous patch storage for one thread, reused across tracers and loops
+//  each camera owns a fixed slot of _n_pix_max pixels
+//  memory is only reallocated when the requested capacity grows
+class PatchArena
+{
+public:
+    ImgAugList _imgAug_list; // views on the slots, size = n_cam
+
+    PatchArena () {};
+    ~PatchArena () {};
+
+    // n_pix_max: max number of pixels of one patch
+    void config (int n_cam, int n_pix_max)
+    {
+        if (n_cam > _n_cam || n_pix_max > _n_pix_max)
+        {
+            _n_cam = std::max(n_cam, _n_cam);
+            _n_pix_max = std::max(n_pix_max, _n_pix_max);
+            _buffer.resize(size_t(_n_cam) * _n_pix_max);
+            _scratch.resize(_n_pix_max);
+        }
+        _imgAug_list.img_list.resize(n_cam);
+        _imgAug_list.region_list.resize(n_cam);
+    };
+
+    // get the patch of camera id with size (n_row, n_col)
+    ImgPatch getPatch (int id, int n_row, int n_col)
+    {
+        if (n_row * n_col > _n_pix_max)
+        {
+            std::cerr << "PatchArena::getPatch error at line " << __LINE__ << ":\n"
+                      << "Patch size " << n_row << "x" << n_col 
+                      << " is larger than the arena slot " << _n_pix_max << std::endl;
+            throw error_size;
+        }
+
+        ImgPatch patch;
+        patch.data = _buffer.data() + size_t(id) * _n_pix_max;
+        patch.n_row = n_row;
+        patch.n_col = n_col;
+        return patch;
+    };
+
+    // temporary storage of one slot, used when a patch is re-gathered
+    double* getScratch () { return _scratch.data(); };
+
+    int getMaxPixel () const { return _n_pix_max; };
+
+private:
+    int _n_cam = 0;
+    int _n_pix_max = 0;
+    std::vector<double> _buffer;
+    std::vector<double> _scratch;
+};
+
 class Shake
 {
 public:
@@ -27,6 +95,10 @@ public:
     std::vector<double> _score_list; // score of each object: for tracer score=intensity; for bubble score=cross-correlation
     std::vector<int> _is_ghost; // 0: not ghost, 1: ghost, include repeated objects
     std::vector<int> _is_repeated; // 0: not repeated, 1: repeated
+    std::vector<int> _is_converged; // 0: still shaken, 1: frozen (removed from the active set)
+    std::vector<double> _residue_list; // residue of each object after its last shake
+    std::vector<double> _converge_ratio_list; // fraction of converged objects after each loop
+    std::vector<int> _color_list; // color of each object at the last coloring (Gauss-Seidel shake)
     int _n_ghost = 0; // include repeated objects
     int _n_repeated = 0;
 
@@ -36,15 +108,24 @@ public:
         double tol_3d, // unit:mm 3D tolerance to check repeated objects (IPR: 3*tol_3d, STB: 2*tol_3d)
         double score_min = 0.1, // Ghost threshold
         int n_loop = 4, // Number of shake times
-        int n_thread = 0 // Number of threads
-    ) : _cam_list(cam_list), _n_cam(cam_list.cam_list.size()), _n_cam_use(cam_list.useid_list.size()), _shake_width(shake_width), _tol_3d(tol_3d), _score_min(score_min), _n_loop(n_loop), _n_thread(n_thread) {};
+        int n_thread = 0, // Number of threads
+        bool is_gauss_seidel = false, // true: shake tracers color by color and update residue in between
+        double tol_conv_pos = 0, // unit: mm, freeze a tracer if its shift < tol_conv_pos
+        double tol_conv_res = 0  // and its relative residue change < tol_conv_res (both > 0 to enable)
+    ) : _cam_list(cam_list), _n_cam(cam_list.cam_list.size()), _n_cam_use(cam_list.useid_list.size()), _shake_width(shake_width), _tol_3d(tol_3d), _score_min(score_min), _n_loop(n_loop), _n_thread(n_thread), _is_gauss_seidel(is_gauss_seidel), _tol_conv_pos(tol_conv_pos), _tol_conv_res(tol_conv_res) {};
 
     ~Shake() {};
 
     // Run shake
     // if tri_only=true, only calculate residue images
+    //  imgOrig_list is copied into _imgRes_list once
     void runShake(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::vector<Image> const& imgOrig_list, bool tri_only=false);
 
+    // Run shake on img_list in place without copying any image
+    //  input: original images of all cameras; output: residue images of the used cameras
+    //  _imgRes_list is not updated
+    void runShakeInPlace(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::vector<Image>& img_list, bool tri_only=false);
+
     
 private:
     // INPUTS //
@@ -56,20 +137,77 @@ private:
     double _score_min; // Ghost threshold
     int _n_loop;       // Number of shake times
     int _n_thread = 0; // Number of threads
+    bool _is_gauss_seidel = false; // Gauss-Seidel shake with graph coloring
+    double _tol_conv_pos = 0; // unit: mm, position tolerance of the active set
+    double _tol_conv_res = 0; // relative residue tolerance of the active set
+
+    // Per-thread patch storage, id = omp_get_thread_num()
+    std::vector<PatchArena> _arena_list;
+
+    // Graph coloring for Gauss-Seidel shake
+    //  two tracers are neighbors if their augmented regions overlap in any camera
+    //  tracers with the same color can be shaken in parallel
+    int _n_color = 0;
+    std::vector<std::vector<int>> _neighbor_list; // neighbor tracer ids of each tracer
+    std::vector<std::vector<int>> _color_class;   // tracer ids of each color
+    std::vector<double> _pt2d_prev; // 2D centers before shaking, size = n_tr3d*_n_cam_use*2
+    std::vector<double> _pt2d_color; // 2D centers at the last coloring, size = n_tr3d*_n_cam_use*2
+    double _shift_px_per_mm = 0; // unit: px/mm, max 2D shift (row or col) if each 3D axis shifts by 1 mm
+    double _color_margin = 0; // unit: px, max 2D shift of a tracer since the last coloring
+
+    // Residue workspace
+    //  _imgRes_list is updated in place, the original value of each changed pixel is kept,
+    //  so the residue can be recalculated without copying the original image again
+    //  pixel id = row*n_col + col
+    std::vector<std::vector<double>> _orig_list;     // original value, only valid where _is_saved_list != 0
+    std::vector<std::vector<uint8_t>> _is_saved_list; // 1: pixel has been changed since the last restore
+    std::vector<std::vector<int>> _saved_id_list;    // ids of the changed pixels
 
 
     //                //
     // MAIN FUNCTIONS //
     //                //
 
-    void shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::vector<Image> const& imgOrig_list, bool tri_only=false);
+    // Shake tracers on _imgRes_list, which holds the original images on input
+    void shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, bool tri_only=false);
+
+    // Reset the residue workspace for the images in _imgRes_list
+    void initResImg();
+
+    // Keep the original value of the pixels in region before they are changed
+    void saveRegion(int id, PixelRange const& region);
+
+    // Restore all changed pixels, _imgRes_list is the original image again
+    void restoreResImg();
+
+    // Prepare one patch arena for each thread
+    //  patch size only depends on r_px, shaking moves the patch but does not enlarge it
+    void configArena(std::vector<Tracer3D> const& tr3d_list);
+
+    // Shake tracer i if it is in the active set, and update its convergence state
+    void shakeActiveTracer(Tracer3D& tr3d, int i, OTF const& otf, double delta, bool is_check_conv, PatchArena& arena);
 
     // Procedure for each shake
-    double shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, double score_old);
-    double shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, double score_old, double lr=1e-4);
+    //  residue: residue after shaking (output)
+    double shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, double score_old, PatchArena& arena, double& residue);
+    double shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, double score_old, PatchArena& arena, double lr=1e-4);
 
     // Remove all tracked particles from image to get residual image.
-    void calResImg(std::vector<Tracer3D> const& tr3d_list, OTF const& otf, std::vector<Image> const& imgOrig_list);
+    void calResImg(std::vector<Tracer3D> const& tr3d_list, OTF const& otf);
+
+    // Build neighbor list from 2D projections and greedily color tracers in index order
+    //  patches use _tr2d_list[id]._r_px, tracers may move by _color_margin before recoloring
+    void colorTracers(std::vector<Tracer3D> const& tr3d_list);
+
+    // Estimate _shift_px_per_mm from the projections of all tracers
+    void calShiftScale(std::vector<Tracer3D> const& tr3d_list);
+
+    // Max 2D shift (row or col) of all tracers since the last coloring, unit: px
+    double getColorShift(std::vector<Tracer3D> const& tr3d_list);
+
+    // Recalculate residue around the tracers of one color (old and new positions)
+    //  pixels of different tracers in one color never overlap, so it is race-free
+    void updateResImgColor(std::vector<Tracer3D> const& tr3d_list, OTF const& otf, std::vector<int> const& tr_id_list);
 
     // Remove negative pxiel and set them as zeros, this function is used to prepare residual image for the next run of IPR.
     void absResImg ();
@@ -100,10 +238,11 @@ private:
     double updateTracerGrad (Tracer3D& tr3d, ImgAugList& imgAug_list, OTF const& otf, double delta, double lr);
 
     // Update imgAug_list and region_list
-    void updateImgAugList (ImgAugList& imgAug_list, Tracer3D const& tr3d);
+    void updateImgAugList (ImgAugList& imgAug_list, Tracer3D const& tr3d, PatchArena& arena);
 
     // Calculate intensity for shaken particles
-    double calTracerScore (Tracer3D const& tr3d, ImgAugList const& imgAug_list, OTF const& otf, double score);
+    // residue: residue at the final position, computed in the same pass
+    double calTracerScore (Tracer3D const& tr3d, ImgAugList const& imgAug_list, OTF const& otf, double score, double& residue);
 
 };
 
@@ -24,10 +24,13 @@
 #include "ObjectInfo.h"
 #include "Camera.h"
 #include "Matrix.h"
+#include "TextIO.h"
 #include "STBCommons.h"
 #include "myMATH.h"
 
 // Map from (row_id,col_id) to object ID for each camera
+//  the map is allocated once by config, reset only clears the pixels filled by insert,
+//  so a reused map costs O(number of objects) per frame instead of O(number of pixels)
 class ObjIDMap
 {
 private:
@@ -35,6 +38,7 @@ private:
     // map from img_id to object ID
     // _map[img_id] = object ID list on (row_id, col_id)
     std::vector<std::vector<int>> _map; 
+    std::vector<int> _used_list; // img_id filled since the last reset
 
 public:
     int _n_row = 0;
@@ -52,11 +56,17 @@ public:
         // _map.reserve(_n_row * _n_col);
         _map.resize(_n_row * _n_col);
         std::fill(_map.begin(), _map.end(), std::vector<int>(1,-1));
+        _used_list.clear();
     };
 
     void reset ()
     {
-        std::fill(_map.begin(), _map.end(), std::vector<int>(1,-1));
+        for (int img_id : _used_list)
+        {
+            _map[img_id].resize(1);
+            _map[img_id][0] = -1;
+        }
+        _used_list.clear();
     };
 
     // map from (row_id, col_id) to img_id
@@ -69,6 +79,21 @@ public:
     {
         return _map[mapImgID(row_id, col_id)];
     };
+
+    // add object obj_id on (row_id, col_id)
+    void insert (int row_id, int col_id, int obj_id)
+    {
+        int img_id = mapImgID(row_id, col_id);
+        if (_map[img_id][0] == -1)
+        {
+            _map[img_id][0] = obj_id;
+            _used_list.push_back(img_id);
+        }
+        else
+        {
+            _map[img_id].push_back(obj_id);
+        }
+    };
 };
 
 
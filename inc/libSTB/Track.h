@@ -1,32 +1,58 @@
 #ifndef TRACK_H
 #define TRACK_H
 
-// #include <deque>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <typeinfo>
+#include <deque>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "STBCommons.h"
 #include "Matrix.h"
+#include "TextIO.h"
+#include "myMATH.h"
 #include "ObjectInfo.h"
+#include "TrackFile.h"
 
+// Wiener filter prediction on one axis
+//  x[0], x[stride], ..., x[order*stride]: history, oldest first
+//  closed form of the LMS filter trained on the single sample (x[0:order] -> x[order])
+inline double predWienerAxis (double const* x, int stride, int order);
 
+
+// Track storage:
+//  _obj3d_list keeps only the latest LEN_TRACK_LIVE objects (live working set for prediction and linking),
+//  all points are kept in the compact history arrays below.
 template<class T3D>
 class Track
 {
 public:
-    std::vector<T3D> _obj3d_list;
-    std::vector<int> _t_list; // frame ID list
-    int _n_obj3d = 0;
+    std::vector<T3D> _obj3d_list; // latest objects, at most LEN_TRACK_LIVE
+    std::vector<int> _t_list; // frame ID list, all points
+    int _n_obj3d = 0; // number of points
     bool _active = true;
+    int _track_id = -1; // global track ID, assigned when the track becomes a long track (-1: not assigned)
+
+    // compact history of all points
+    std::vector<double> _pt_list; // world position, [3*i + axis]
+    std::vector<double> _error_list; // [mm]
+    // 2D observations side table, point i: [_obs_start[i], _obs_start[i+1])
+    std::vector<int> _obs_start = {0};
+    std::vector<int> _obs_camid_list;
+    std::vector<double> _obs_pt_list; // [2*k], [2*k+1]: (col, row)
 
 
     // Functions //
     Track() {};
     Track(T3D const& obj3d, int t);
     Track(Track const& track);
+    Track(Track&& track) = default;
     ~Track() {};
 
     // Add a new point to the Track
@@ -35,6 +61,13 @@ public:
 
     // Add another Track onto the end of this one
     void addNext(Track const& t);
+
+    // world position of point i (0 <= i < _n_obj3d)
+    Pt3D getPt3D (int i) const { return Pt3D(_pt_list[3*i], _pt_list[3*i+1], _pt_list[3*i+2]); };
+
+    // object of point i rebuilt from the compact history (0 <= i < _n_obj3d)
+    //  position, error and 2D observations, the other members keep their default values
+    T3D getObj3D (int i) const;
     
     // Predict the next position of the track
     // but not update the obj2d list
@@ -42,15 +75,123 @@ public:
 
     // write the track to a file
     void saveTrack(std::ofstream& output, int track_id, float fps = 1, int n_cam_all = 0);
+    void saveTrack(TextBuffer& output, int track_id, float fps = 1, int n_cam_all = 0);
+
+    // write the track to a binary track file
+    void saveTrack(TrackFileWriter& output, int track_id);
     
     // member operators
     Track<T3D>& operator=(Track<T3D> const& t);
+    Track<T3D>& operator=(Track<T3D>&& t) = default;
 
 private:
     void predLMSWiener (T3D& obj3d);
 
 };
 
+
+struct TrackPredParam
+{
+    PredTypeID type = PRED_WIENER;
+    int n_hist = 6; // number of history points for PRED_POLY and PRED_KALMAN
+    int poly_order = 2; // PRED_POLY
+    double kalman_q = 1e-6; // PRED_KALMAN, process noise (jerk) [mm^2/frame^6]
+    double kalman_r = 1e-4; // PRED_KALMAN, measurement noise [mm^2]
+    bool is_hindcast = false; // report the hindcast residual, costs a second prediction
+};
+
+// Hindcast residual: predict the last point of each track from the points before it
+struct TrackPredStats
+{
+    int n_track = 0;
+    double mean = 0; // [mm]
+    double rms = 0; // [mm]
+    double max = 0; // [mm]
+};
+
+// Predict all tracks in one batch
+//  history positions are gathered into SoA buffers, one pass per axis
+template<class T3D>
+class TrackPredictor
+{
+public:
+    TrackPredParam _param;
+    TrackPredStats _stats;
+
+    TrackPredictor () {};
+    TrackPredictor (TrackPredParam const& param) : _param(param) {};
+    ~TrackPredictor () {};
+
+    // predict the next position of each track (tracks need at least 3 points)
+    //  is_cal_stats: update _stats
+    void predict (std::vector<T3D>& obj3d_list_pred, std::deque<Track<T3D>> const& track_list, bool is_cal_stats = false);
+
+private:
+    int _n_track = 0;
+    int _n_hist = 0; 
+    std::vector<int> _len_list; // valid history points of each track
+    std::vector<double> _hist; // [(axis*_n_hist + k)*_n_track + i], newest point at k = _n_hist-1
+    std::vector<double> _pred; // [axis*_n_track + i]
+    std::vector<std::vector<double>> _poly_coeff; // PRED_POLY weights for each window length
+
+    // n_skip: number of newest points to leave out (1 for hindcast)
+    void gather (std::deque<Track<T3D>> const& track_list, int n_skip);
+    void calPolyCoeff ();
+
+    void predWiener ();
+    void predPoly ();
+    void predKalman ();
+    void run ();
+};
+
+// Write finished tracks to one file on a background thread
+//  tracks are moved into the writer queue and released once written,
+//  each track is written with its _track_id
+//  csv: the file is flushed after each batch, so a crash only loses the tracks still in the queue
+//  binary (.lpt): tracks are written in chunks, the file is readable after close()
+template<class T3D>
+class TrackWriter
+{
+public:
+    TrackWriter () {};
+    ~TrackWriter () { close(); };
+
+    TrackWriter (TrackWriter const&) = delete;
+    TrackWriter& operator= (TrackWriter const&) = delete;
+
+    // create the file, write the header and start the writer thread
+    void open (std::string const& file, float fps = 1, int n_cam_all = 0);
+
+    // move all tracks into the queue, track_list is empty on return
+    void push (std::deque<Track<T3D>>& track_list);
+
+    // write all queued tracks, stop the thread and close the file
+    void close ();
+
+    bool isOpen () const { return _is_open; };
+
+    // number of tracks pushed since open
+    int getNumOfTrack () const { return _n_track; };
+
+private:
+    std::string _file;
+    float _fps = 1;
+    int _n_cam_all = 0;
+    bool _is_open = false;
+    int _n_track = 0;
+
+    bool _is_bin = false;
+    std::ofstream _output;
+    TrackFileWriter _output_bin;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<Track<T3D>> _queue;
+    bool _is_stop = false;
+
+    void run ();
+};
+
 #include "Track.hpp"
 
 #endif
\ No newline at end of file
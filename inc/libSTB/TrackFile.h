@@ -0,0 +1,199 @@
+//
+//  TrackFile.h
+//
+//  binary columnar track file (.lpt): writer, memory-mapped reader and csv converter
+//
+//  File layout (native little endian, every block starts on an 8 byte boundary):
+//
+//  Header (64 bytes)
+//      char[8]   magic          "OLPTTRK"
+//      uint32    version        TRACKFILE_VERSION
+//      uint32    n_cam_all
+//      double    fps
+//      uint64    n_chunk
+//      uint64    n_track
+//      uint64    n_pt
+//      uint64    index_offset   file offset of the chunk index, 0 if the file was not closed
+//      uint64    reserved
+//
+//  Chunk header (64 bytes)
+//      char[8]   magic          "OLPTCHK"
+//      TrackChunkInfo info      same entry as in the chunk index
+//
+//  Chunk (whole tracks, one column per block, each block padded to 8 bytes)
+//      int64     track_id[n_track]
+//      int64     track_start[n_track+1]   first point of each track in the chunk
+//      int32     frame[n_pt]              frame ID
+//      double    x[n_pt], y[n_pt], z[n_pt]  world position [mm]
+//      double    error[n_pt]              [mm]
+//      int32     obs_start[n_pt+1]        first 2D observation of each point in the chunk
+//      int32     obs_cam[n_obs]           camera ID
+//      double    obs_x[n_obs], obs_y[n_obs]  image position (col, row) [px]
+//
+//  Chunk index (at index_offset, n_chunk entries of TrackChunkInfo)
+//  a file that was not closed has no index, the reader rebuilds it from the chunk headers
+//
+//  The csv layout is the one of Track::saveTrack, FrameID = frame / fps.
+//
+
+#ifndef TRACKFILE_H
+#define TRACKFILE_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+
+#include "STBCommons.h"
+#include "TextIO.h"
+
+#define TRACKFILE_MAGIC "OLPTTRK"
+#define TRACKFILE_CHUNK_MAGIC "OLPTCHK"
+#define TRACKFILE_VERSION 2
+#define TRACKFILE_CHUNK_SIZE 65536 // number of points per chunk
+
+struct TrackFileHeader
+{
+    char magic[8] = TRACKFILE_MAGIC;
+    uint32_t version = TRACKFILE_VERSION;
+    uint32_t n_cam_all = 0;
+    double fps = 1;
+    uint64_t n_chunk = 0;
+    uint64_t n_track = 0;
+    uint64_t n_pt = 0;
+    uint64_t index_offset = 0;
+    uint64_t reserved = 0;
+};
+
+struct TrackChunkInfo
+{
+    uint64_t offset = 0; // file offset of the chunk columns (after the chunk header)
+    uint64_t n_track = 0;
+    uint64_t n_pt = 0;
+    uint64_t n_obs = 0;
+    int64_t track_id_min = 0;
+    int64_t track_id_max = 0;
+    int32_t frame_min = 0;
+    int32_t frame_max = 0;
+};
+
+struct TrackChunkHeader
+{
+    char magic[8] = TRACKFILE_CHUNK_MAGIC;
+    TrackChunkInfo info;
+};
+
+// pointers into one chunk of a mapped file
+struct TrackChunk
+{
+    int n_track = 0;
+    int n_pt = 0;
+    int n_obs = 0;
+    int64_t const* track_id = nullptr;
+    int64_t const* track_start = nullptr;
+    int32_t const* frame = nullptr;
+    double const* x = nullptr;
+    double const* y = nullptr;
+    double const* z = nullptr;
+    double const* error = nullptr;
+    int32_t const* obs_start = nullptr;
+    int32_t const* obs_cam = nullptr;
+    double const* obs_x = nullptr;
+    double const* obs_y = nullptr;
+};
+
+
+// true if file has the .lpt extension
+bool isTrackFileBin (std::string const& file);
+
+
+// Write tracks to a binary track file
+//  tracks are buffered and written chunk by chunk, the index is written by close()
+class TrackFileWriter
+{
+public:
+    TrackFileWriter () {};
+    ~TrackFileWriter () { close(); };
+
+    TrackFileWriter (TrackFileWriter const&) = delete;
+    TrackFileWriter& operator= (TrackFileWriter const&) = delete;
+
+    void open (std::string const& file, float fps = 1, int n_cam_all = 0, int chunk_size = TRACKFILE_CHUNK_SIZE);
+
+    // add one track, arrays have the layout of the Track compact history:
+    //  t_list[n_pt], pt_list[3*n_pt], error_list[n_pt],
+    //  obs_start[n_pt+1], obs_camid_list[obs_start[n_pt]], obs_pt_list[2*obs_start[n_pt]]
+    void addTrack (int64_t track_id, int n_pt, int const* t_list, double const* pt_list, double const* error_list, int const* obs_start, int const* obs_camid_list, double const* obs_pt_list);
+
+    // write the buffered chunk and flush the file
+    void flush ();
+
+    // write the remaining tracks, the chunk index and the header
+    void close ();
+
+    bool isOpen () const { return _output.is_open(); };
+
+private:
+    std::ofstream _output;
+    TrackFileHeader _header;
+    std::vector<TrackChunkInfo> _index;
+    int _chunk_size = TRACKFILE_CHUNK_SIZE;
+    uint64_t _offset = 0; // current file offset
+
+    // chunk buffer
+    std::vector<int64_t> _track_id;
+    std::vector<int64_t> _track_start = {0};
+    std::vector<int32_t> _frame;
+    std::vector<double> _x, _y, _z, _error;
+    std::vector<int32_t> _obs_start = {0};
+    std::vector<int32_t> _obs_cam;
+    std::vector<double> _obs_x, _obs_y;
+
+    void writeBlock (void const* data, size_t n_byte);
+};
+
+
+// Read a binary track file through a read-only memory map
+//  chunk arrays point into the map and stay valid while the reader lives
+class TrackFileReader
+{
+public:
+    TrackFileReader (std::string const& file);
+    ~TrackFileReader () {};
+
+    TrackFileReader (TrackFileReader const&) = delete;
+    TrackFileReader& operator= (TrackFileReader const&) = delete;
+
+    int getNumOfChunk () const { return _index.size(); };
+    int64_t getNumOfTrack () const { return _header.n_track; };
+    int64_t getNumOfPt () const { return _header.n_pt; };
+    int getNumOfCam () const { return _header.n_cam_all; };
+    double getFPS () const { return _header.fps; };
+
+    TrackChunkInfo const& getChunkInfo (int chunk_id) const { return _index[chunk_id]; };
+
+    // arrays of the chunk are checked against n_pt, n_obs and n_cam_all
+    TrackChunk getChunk (int chunk_id) const;
+
+private:
+    std::string _file;
+    MappedFile _map;
+    TrackFileHeader _header;
+    std::vector<TrackChunkInfo> _index;
+
+    char const* _data = nullptr;
+    size_t _size = 0;
+
+    // rebuild the chunk index from the chunk headers, for files that were not closed
+    void scanChunk ();
+};
+
+
+// write tracks of a binary file as csv (same layout as Track::saveTrack)
+void convertTrackBinToCSV (std::string const& file_bin, std::string const& file_csv);
+
+// convert a track csv file to the binary format, fps is the one used to save the csv
+void convertTrackCSVToBin (std::string const& file_csv, std::string const& file_bin, float fps = 1);
+
+#endif // !TRACKFILE_H
@@ -25,6 +25,7 @@ void init_OTF(py::module &);
 void init_Shake(py::module &);
 void init_IPR(py::module &);
 void init_PredField(py::module &);
+void init_TrackFile(py::module &);
 void init_Track(py::module &);
 void init_STB(py::module &);
 
@@ -105,6 +106,7 @@ PYBIND11_MODULE(pyOpenLPT, m)
     init_Shake(m_stb);
     init_IPR(m_stb);
     init_PredField(m_stb);
+    init_TrackFile(m_stb);
     init_Track(m_stb);
     init_STB(m_stb);
 }
\ No newline at end of file
@@ -25,6 +25,7 @@ void run (std::string file)
     int n_cam_all;
     AxisLimit axis_limit;
     double vx_to_mm;
+    std::vector<int> mask_auto_list; // cameras with a mask built from the first frames
 
     std::cout << "Load config file: " << file << std::endl;
     std::ifstream stb_config(file, std::ios::in);
@@ -97,16 +98,85 @@ void run (std::string file)
 
         cam_list.useid_list.push_back(i);
 
+        // Optional pixel mask: image file (pixels != 0 are masked) or auto
+        if (std::getline(parsed, line, ','))
+        {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t") + 1);
+            if (line == "auto")
+            {
+                mask_auto_list.push_back(i);
+            }
+            else if (!line.empty())
+            {
+                ImageIO mask_io;
+                mask_io.loadImgPath("", line);
+                cam_list.setMask(i, mask_io.loadImg(0));
+                std::cout << "Camera " << i << " mask: " << line << ", " << cam_list.mask_list[i].getNumOfMasked() << " pixels masked" << std::endl;
+            }
+        }
+
         parsed.clear();
     }
 
     // Load image io
+    //  optional preprocessing: background (none, min, median, mean), window size, threshold, clip
     std::vector<ImageIO> imgio_list;
+    std::vector<PreprocParam> preproc_list(n_cam_all);
+    bool is_preproc = false;
     for (int i = 0; i < n_cam_all; i++)
     {
         line_id ++;
+        parsed.str(lines[line_id]);
+
+        std::getline(parsed, line, ',');
         imgio_list.push_back(ImageIO());
-        imgio_list[i].loadImgPath("", lines[line_id]);
+        imgio_list[i].loadImgPath("", line);
+
+        std::vector<std::string> option_list;
+        while (std::getline(parsed, line, ','))
+        {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t") + 1);
+            option_list.push_back(line);
+        }
+        parsed.clear();
+
+        if (option_list.size() > 0)
+        {
+            std::string bg_type = option_list[0];
+            if (bg_type == "min")
+            {
+                preproc_list[i].bg_type = BG_MIN;
+            }
+            else if (bg_type == "median")
+            {
+                preproc_list[i].bg_type = BG_MEDIAN;
+            }
+            else if (bg_type == "mean")
+            {
+                preproc_list[i].bg_type = BG_MEAN;
+            }
+            else if (bg_type != "none")
+            {
+                std::cerr << "Error: Unknown background type: " << bg_type << std::endl;
+                return;
+            }
+            if (option_list.size() > 1)
+            {
+                preproc_list[i].n_window = std::stoi(option_list[1]);
+            }
+            if (option_list.size() > 2)
+            {
+                preproc_list[i].threshold = std::stod(option_list[2]);
+            }
+            if (option_list.size() > 3)
+            {
+                preproc_list[i].clip_max = std::stod(option_list[3]);
+            }
+            is_preproc = true;
+            std::cout << "Camera " << i << " preprocessing: background " << bg_type << " over " << preproc_list[i].n_window << " frames, threshold " << preproc_list[i].threshold << ", clip " << preproc_list[i].clip_max << std::endl;
+        }
     }
 
     // Load axis limit
@@ -126,6 +196,17 @@ void run (std::string file)
     axis_limit.z_max = std::stod(line);
     parsed.clear();
 
+    // Image region of each camera that sees the volume
+    //  only the roi is loaded and searched for objects
+    int roi_margin_px = 20;
+    cam_list.setROI(axis_limit, roi_margin_px);
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        PixelRange roi = cam_list.getROI(i);
+        imgio_list[i].setROI(roi);
+        std::cout << "Camera " << i << " roi (row,col): [" << roi.row_min << "," << roi.row_max << ") x [" << roi.col_min << "," << roi.col_max << ")" << std::endl;
+    }
+
     // Load vx_to_mm
     line_id ++;
     vx_to_mm = std::stod(lines[line_id]);
@@ -134,10 +215,30 @@ void run (std::string file)
     line_id ++;
     std::string output_folder = lines[line_id];
 
+    // Prefetch images of all cameras
+    //  the OTF calibration frames stay in the cache and are reused by the first frames of STB
+    int n_otf_calib = 5;
+    int n_frame_ahead = 2;
+    FrameLoader frame_loader;
+    if (is_preproc)
+    {
+        frame_loader.setPreproc(preproc_list);
+    }
+    frame_loader.start(imgio_list, frame_start, std::max(frame_end, frame_start + n_otf_calib - 1), n_frame_ahead, n_otf_calib + n_frame_ahead + 1);
+
+    // Auto mask: pixels with objects in more than mask_rate_max of n_mask_frame frames
+    //  spread over the first n_mask_span frames, so slow tracers move away between the samples
+    int n_mask_span = std::min(100, frame_end - frame_start + 1);
+    int n_mask_frame = std::min(10, n_mask_span);
+    int mask_stride = n_mask_span / n_mask_frame;
+    double mask_rate_max = 0.8;
+    std::vector<std::vector<Image>> mask_img_list(n_cam_all);
+
     // Load STB
     line_id ++;    
     parsed.str(lines[line_id]);
     std::vector<std::variant<STB<Tracer3D>>> stb_list;
+    std::vector<int> frame_id_ckp_list; // last processed frame of the resumed STBs
     int n_obj_class = 0;
     while (std::getline(parsed, line, ','))
     {
@@ -146,29 +247,79 @@ void run (std::string file)
         {
             stb_list.push_back(STB<Tracer3D>(frame_start, frame_end, fps, vx_to_mm, n_thread, output_folder+"Tracer_"+std::to_string(n_obj_class)+'/', cam_list, axis_limit, lines[line_id]));
 
-            // Calibrate OTF // 
-            std::cout << "Start Calibrating OTF!" << std::endl;
-            int n_otf_calib = 5;
-            int n_obj2d_max = 1000;
-            std::vector<Image> img_list(n_otf_calib);
+            if (mask_auto_list.size() > 0)
+            {
+                // frames are loaded once and shared by all object types
+                if (mask_img_list[mask_auto_list[0]].size() == 0)
+                {
+                    std::vector<Image> frame;
+                    for (int j = 0; j < n_mask_frame; j ++)
+                    {
+                        frame_loader.getFrame(frame_start + j * mask_stride, frame);
+                        for (int i : mask_auto_list)
+                        {
+                            mask_img_list[i].push_back(std::move(frame[i]));
+                        }
+                    }
+                }
+
+                std::visit(
+                    [&](auto& stb) 
+                    { 
+                        for (int i : mask_auto_list)
+                        {
+                            int n_masked = stb.findMask(i, mask_rate_max, mask_img_list[i]);
+                            std::cout << "Camera " << i << " auto mask: " << n_masked << " pixels masked" << std::endl;
+                        }
+                    }, 
+                    stb_list[n_obj_class]
+                );
+            }
 
+            // Resume from the last checkpoint, the OTF is restored from it
+            bool is_resume = false;
             std::visit(
                 [&](auto& stb) 
                 { 
-                    double r_otf_calib = stb.getObjParam()[2];
-                    for (int i = 0; i < n_cam_all; i ++)
+                    if (stb.getCheckpointInterval() > 0 && fs::exists(stb.getCheckpointFile()))
                     {
-                        for (int j = 0; j < n_otf_calib; j ++)
-                        {
-                            img_list[j] = imgio_list[i].loadImg(frame_start + j);
-                        }
-                        stb.calibrateOTF(i, n_obj2d_max, r_otf_calib, img_list); 
+                        frame_id_ckp_list.push_back(stb.loadCheckpoint(stb.getCheckpointFile()));
+                        is_resume = true;
                     }
                 }, 
                 stb_list[n_obj_class]
             );
 
-            std::cout << "Finish Calibrating OTF!\n" << std::endl;
+            if (!is_resume)
+            {
+                // Calibrate OTF // 
+                std::cout << "Start Calibrating OTF!" << std::endl;
+                int n_obj2d_max = 1000;
+                std::vector<std::vector<Image>> frame_list(n_otf_calib);
+                for (int j = 0; j < n_otf_calib; j ++)
+                {
+                    frame_loader.getFrame(frame_start + j, frame_list[j]);
+                }
+                std::vector<Image> img_list(n_otf_calib);
+
+                std::visit(
+                    [&](auto& stb) 
+                    { 
+                        double r_otf_calib = stb.getObjParam()[2];
+                        for (int i = 0; i < n_cam_all; i ++)
+                        {
+                            for (int j = 0; j < n_otf_calib; j ++)
+                            {
+                                img_list[j] = frame_list[j][i];
+                            }
+                            stb.calibrateOTF(i, n_obj2d_max, r_otf_calib, img_list); 
+                        }
+                    }, 
+                    stb_list[n_obj_class]
+                );
+
+                std::cout << "Finish Calibrating OTF!\n" << std::endl;
+            }
 
             n_obj_class ++;
         }
@@ -179,12 +330,24 @@ void run (std::string file)
         }
     }
     parsed.clear();
+    mask_img_list.clear();
 
-    // Load previous tracks
+    // Continue after the checkpoints
     line_id ++;
     int frame_id_prev = frame_start-1;
 
-    if (line_id < lines.size())
+    if (frame_id_ckp_list.size() > 0)
+    {
+        if (frame_id_ckp_list.size() != n_obj_class || *std::min_element(frame_id_ckp_list.begin(), frame_id_ckp_list.end()) != *std::max_element(frame_id_ckp_list.begin(), frame_id_ckp_list.end()))
+        {
+            std::cerr << "Error: Checkpoints of all object types must be at the same frame! Remove Checkpoint.bin to restart." << std::endl;
+            return;
+        }
+        frame_id_prev = frame_id_ckp_list[0];
+        std::cout << "Resume after frame " << frame_id_prev << std::endl;
+    }
+    // Load previous tracks
+    else if (line_id < lines.size())
     {
         // std::cout << lines[line_id] << std::endl;
         bool is_load_tracks = false;
@@ -223,28 +386,59 @@ void run (std::string file)
         }
     }
 
+    // IPR only: the frames are independent and processed in parallel
+    //  without the IPR flag the frames go through processFrame
+    bool is_ipr_only = true;
+    for (int i = 0; i < stb_list.size(); i ++)
+    {
+        std::visit([&](auto& stb) { is_ipr_only = is_ipr_only && stb.isIPROnly() && stb.isIPREnabled(); }, stb_list[i]);
+    }
+
     // Start processing
+    //  the images of the next frames are loaded in the background while the current frame is tracked
     clock_t start = clock();
-    std::vector<Image> img_list(n_cam_all);
-    for (int frame_id = frame_id_prev+1; frame_id < frame_end+1; frame_id ++)
+    if (is_ipr_only)
     {
-        // load image
-        for (int i = 0; i < n_cam_all; i ++)
+        // one frame ahead for each frame processed in parallel
+        int n_frame_parallel = 1;
+        for (int i = 0; i < stb_list.size(); i ++)
         {
-            img_list[i] = imgio_list[i].loadImg(frame_id);
+            std::visit([&](auto& stb) { n_frame_parallel = std::max(n_frame_parallel, stb.getNumOfFrameParallel()); }, stb_list[i]);
         }
+        n_frame_ahead = std::max(n_frame_ahead, n_frame_parallel);
+        frame_loader.setFrameAhead(n_frame_ahead, n_otf_calib + n_frame_ahead + 1);
 
         for (int i = 0; i < stb_list.size(); i ++)
         {
             std::visit(
                 [&](auto& stb) 
                 { 
-                    stb.processFrame(frame_id, img_list); 
+                    stb.runIPROnly(frame_loader, frame_id_prev+1, frame_end); 
                 }, 
                 stb_list[i]
             );
         }
     }
+    else
+    {
+        std::vector<Image> img_list(n_cam_all);
+        for (int frame_id = frame_id_prev+1; frame_id < frame_end+1; frame_id ++)
+        {
+            frame_loader.getFrame(frame_id, img_list);
+
+            for (int i = 0; i < stb_list.size(); i ++)
+            {
+                std::visit(
+                    [&](auto& stb) 
+                    { 
+                        stb.processFrame(frame_id, img_list); 
+                    }, 
+                    stb_list[i]
+                );
+            }
+        }
+    }
+    frame_loader.stop();
 
     std::cout << std::endl;
     clock_t end = clock();
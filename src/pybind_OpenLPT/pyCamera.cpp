@@ -81,6 +81,7 @@ void init_Camera(py::module &m)
         .def("rmtxTorvec", &Camera::rmtxTorvec)
         .def("getNRow", &Camera::getNRow)
         .def("getNCol", &Camera::getNCol)
+        .def("projectROI", &Camera::projectROI, py::arg("axis_limit"), py::arg("margin_px")=0)
         .def("project", &Camera::project)
         .def("project", [](Camera const& self, std::vector<Pt3D> const& pt3d_list){
             std::vector<Pt2D> pt2d_list(pt3d_list.size());
@@ -129,6 +130,15 @@ void init_Camera(py::module &m)
         .def_readwrite("cam_list", &CamList::cam_list)
         .def_readwrite("intensity_max", &CamList::intensity_max)
         .def_readwrite("useid_list", &CamList::useid_list)
+        .def_readwrite("roi_list", &CamList::roi_list)
+        .def("setROI", &CamList::setROI)
+        .def("getROI", &CamList::getROI)
+        .def_readwrite("mask_list", &CamList::mask_list)
+        .def("setMask", &CamList::setMask)
+        .def("getMask", [](CamList const& self, int cam_id){
+            PixelMask const* mask = self.getMask(cam_id);
+            return mask == nullptr ? PixelMask() : *mask;
+        })
         .def("to_dict", [](CamList const& self){
             return py::dict(
                 "cam_list"_a=self.cam_list, 
@@ -15,17 +15,22 @@ void init_IPR(py::module &m)
         .def_readwrite("n_loop_shake", &IPRParam::n_loop_shake)
         .def_readwrite("shake_width", &IPRParam::shake_width)
         .def_readwrite("ghost_threshold", &IPRParam::ghost_threshold)
+        .def_readwrite("shake_gauss_seidel", &IPRParam::shake_gauss_seidel)
+        .def_readwrite("shake_tol_conv_pos", &IPRParam::shake_tol_conv_pos)
+        .def_readwrite("shake_tol_conv_res", &IPRParam::shake_tol_conv_res)
         .def("to_dict", [](IPRParam const& self){
             return py::dict(
                 "tri_only"_a=self.tri_only, "n_thread"_a=self.n_thread, "n_loop_ipr"_a=self.n_loop_ipr, "n_loop_ipr_reduced"_a=self.n_loop_ipr_reduced,
                 "n_obj2d_max"_a=self.n_obj2d_max, "tol_2d"_a=self.tol_2d, "tol_3d"_a=self.tol_3d, "check_id"_a=self.check_id, "check_radius"_a=self.check_radius,
-                "n_loop_shake"_a=self.n_loop_shake, "shake_width"_a=self.shake_width, "ghost_threshold"_a=self.ghost_threshold
+                "n_loop_shake"_a=self.n_loop_shake, "shake_width"_a=self.shake_width, "ghost_threshold"_a=self.ghost_threshold,
+                "shake_gauss_seidel"_a=self.shake_gauss_seidel, "shake_tol_conv_pos"_a=self.shake_tol_conv_pos, "shake_tol_conv_res"_a=self.shake_tol_conv_res
             );
         })
         .doc() = "IPRParam struct";
 
     py::class_<IPR>(m, "IPR")
         .def(py::init<CamList&, std::vector<Image> const&, IPRParam const&>())
+        .def(py::init<CamList&, IPRParam const&>())
         .def("runIPR", [](IPR& self, std::vector<double> const& tr2d_properties, OTF const& otf, int n_reduced){
             std::vector<Tracer3D> tr3d_list_all;
             self.runIPR(tr3d_list_all, tr2d_properties, otf, n_reduced);
@@ -27,6 +27,9 @@ void init_ImageIO(py::module &m)
         .def("setImgParam", &ImageIO::setImgParam)
         .def("getImgParam", &ImageIO::getImgParam)
         .def("getCurrImgID", &ImageIO::getCurrImgID)
+        .def("getNumOfImg", &ImageIO::getNumOfImg)
+        .def("setROI", &ImageIO::setROI)
+        .def("getROI", &ImageIO::getROI)
         .def("to_dict", [](ImageIO const& self){
             return py::dict(
                 "img_path (no_access)"_a=self.getImgPath(), 
@@ -35,4 +38,34 @@ void init_ImageIO(py::module &m)
             );
         })
         .doc() = "ImageIO class";
-}
\ No newline at end of file
+
+    py::class_<PreprocParam>(m, "PreprocParam")
+        .def(py::init<>())
+        .def_readwrite("bg_type", &PreprocParam::bg_type)
+        .def_readwrite("n_window", &PreprocParam::n_window)
+        .def_readwrite("threshold", &PreprocParam::threshold)
+        .def_readwrite("clip_max", &PreprocParam::clip_max)
+        .def("to_dict", [](PreprocParam const& self){
+            return py::dict(
+                "bg_type"_a=self.bg_type, 
+                "n_window"_a=self.n_window, 
+                "threshold"_a=self.threshold, 
+                "clip_max"_a=self.clip_max
+            );
+        })
+        .doc() = "PreprocParam struct";
+
+    py::class_<Preprocessor>(m, "Preprocessor")
+        .def(py::init<>())
+        .def(py::init<PreprocParam const&>())
+        .def("setParam", &Preprocessor::setParam)
+        .def("getParam", &Preprocessor::getParam)
+        .def("process", [](Preprocessor& self, ImageIO& imgio, int img_id){
+            Image image;
+            self.process(imgio, img_id, image);
+            return image;
+        })
+        .def("reset", &Preprocessor::reset)
+        .def("getNumOfDecode", &Preprocessor::getNumOfDecode)
+        .doc() = "Preprocessor class";
+}
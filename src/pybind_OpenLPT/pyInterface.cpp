@@ -18,6 +18,7 @@
 #include "Shake.h"
 #include "IPR.h"
 #include "PredField.h"
+#include "TrackFile.h"
 #include "Track.h"
 #include "STB.h"
 #include "main.cpp"
@@ -41,5 +42,6 @@ using namespace pybind11::literals;
 #include "pyShake.cpp"
 #include "pyIPR.cpp"
 #include "pyPredField.cpp"
+#include "pyTrackFile.cpp"
 #include "pyTrack.cpp"
 #include "pySTB.cpp"
@@ -13,6 +13,11 @@ void init_ObjectFinder(py::module& m)
             self.findObject2D(obj2d_list, img, properties, region);
             return obj2d_list;
         })
+        .def("findObject2D", [](ObjectFinder2D& self, Image const& img, std::vector<double> const& properties, PixelRange const& region, PixelMask const& mask){
+            std::vector<Tracer2D> obj2d_list;
+            self.findObject2D(obj2d_list, img, properties, region, mask.isEmpty() ? nullptr : &mask);
+            return obj2d_list;
+        })
         .def("findTracer2D", [](ObjectFinder2D& self, Image const& img, std::vector<double> const& properties){
             std::vector<Tracer2D> obj2d_list;
             self.findObject2D(obj2d_list, img, properties);
@@ -23,6 +28,11 @@ void init_ObjectFinder(py::module& m)
             self.findObject2D(obj2d_list, img, properties, region);
             return obj2d_list;
         })
+        .def("findMask", [](ObjectFinder2D& self, std::vector<Image> const& img_list, std::vector<double> const& properties, double rate_max){
+            PixelMask mask;
+            self.findMask<Tracer2D>(mask, img_list, properties, rate_max);
+            return mask;
+        })
         .def("to_dict", [](ObjectFinder2D const& self){
             return py::dict();
         })
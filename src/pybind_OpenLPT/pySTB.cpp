@@ -4,6 +4,7 @@ void init_STB(py::module &m)
     py::class_<STB<Tracer3D>>(m, "STBTracer")
         .def(py::init<int, int, float, double, int, std::string const&, CamList const&, AxisLimit const&, std::string const&>(), py::arg("frame_start"), py::arg("frame_end"), py::arg("fps"), py::arg("vx_to_mm"), py::arg("n_thread"), py::arg("output_folder"), py::arg("cam_list"), py::arg("axis_limit"), py::arg("file"))
         .def("calibrateOTF", &STB<Tracer3D>::calibrateOTF)
+        .def("findMask", &STB<Tracer3D>::findMask)
         .def("processFrame", [](STB<Tracer3D>& self, int frame_id, std::vector<Image> const& img_list, bool is_update_img){
             std::vector<Image> img_list_copy(img_list);
             self.processFrame(frame_id, img_list_copy, is_update_img);  
@@ -14,6 +15,13 @@ void init_STB(py::module &m)
         .def("saveTracks", &STB<Tracer3D>::saveTracks)
         .def("saveTracksAll", &STB<Tracer3D>::saveTracksAll)
         .def("getObjParam", &STB<Tracer3D>::getObjParam)
+        .def("saveCheckpoint", &STB<Tracer3D>::saveCheckpoint, py::arg("file"), py::arg("frame"))
+        .def("loadCheckpoint", &STB<Tracer3D>::loadCheckpoint, py::arg("file"))
+        .def("getCheckpointInterval", &STB<Tracer3D>::getCheckpointInterval)
+        .def("getCheckpointFile", &STB<Tracer3D>::getCheckpointFile)
+        .def("isIPROnly", &STB<Tracer3D>::isIPROnly)
+        .def("isIPREnabled", &STB<Tracer3D>::isIPREnabled)
+        .def("getNumOfFrameParallel", &STB<Tracer3D>::getNumOfFrameParallel)
         .def_readwrite("_ipr_matched", &STB<Tracer3D>::_ipr_matched)
         .def_readwrite("_short_track_active", &STB<Tracer3D>::_short_track_active)
         .def_readwrite("_long_track_active", &STB<Tracer3D>::_long_track_active)
@@ -44,6 +44,26 @@ void init_STBCommons(py::module &m)
         })
         .doc() = "AxisLimit struct";
 
+    py::class_<PixelMask>(m, "PixelMask")
+        .def(py::init<>())
+        .def_readwrite("n_row", &PixelMask::n_row)
+        .def_readwrite("n_col", &PixelMask::n_col)
+        .def_readwrite("data", &PixelMask::data)
+        .def("config", &PixelMask::config)
+        .def("isEmpty", &PixelMask::isEmpty)
+        .def("__call__", &PixelMask::operator())
+        .def("set", &PixelMask::set, py::arg("row"), py::arg("col"), py::arg("is_masked")=true)
+        .def("nextUnmasked", &PixelMask::nextUnmasked)
+        .def("getNumOfMasked", &PixelMask::getNumOfMasked)
+        .def("to_dict", [](PixelMask const& self){
+            return py::dict(
+                "n_row"_a=self.n_row, 
+                "n_col"_a=self.n_col, 
+                "data"_a=self.data
+            );
+        })
+        .doc() = "PixelMask struct";
+
     py::enum_<ErrorTypeID>(m, "ErrorTypeID")
         .value("error_size", ErrorTypeID::error_size)
         .value("error_type", ErrorTypeID::error_type)
@@ -71,5 +91,17 @@ void init_STBCommons(py::module &m)
         .value("LONG_INACTIVE", TrackStatusID::LONG_INACTIVE)
         .value("EXIT", TrackStatusID::EXIT)
         .export_values();
+
+    py::enum_<BackgroundTypeID>(m, "BackgroundTypeID")
+        .value("BG_NONE", BackgroundTypeID::BG_NONE)
+        .value("BG_MIN", BackgroundTypeID::BG_MIN)
+        .value("BG_MEDIAN", BackgroundTypeID::BG_MEDIAN)
+        .value("BG_MEAN", BackgroundTypeID::BG_MEAN)
+        .export_values();
+
+    py::enum_<TrackFormatID>(m, "TrackFormatID")
+        .value("TRACK_CSV", TrackFormatID::TRACK_CSV)
+        .value("TRACK_BIN", TrackFormatID::TRACK_BIN)
+        .export_values();
 }
 
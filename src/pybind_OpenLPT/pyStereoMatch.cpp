@@ -5,6 +5,8 @@ void init_StereoMatch(py::module& m)
         .def(py::init<>())
         .def("config", &ObjIDMap::config)
         .def("mapImgID", &ObjIDMap::mapImgID)
+        .def("reset", &ObjIDMap::reset)
+        .def("insert", &ObjIDMap::insert)
         .doc() = "ObjIDMap class";
 
     py::class_<SMParam>(m, "SMParam")
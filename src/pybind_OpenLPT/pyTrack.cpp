@@ -13,13 +13,30 @@ void init_Track(py::module &m)
             self.saveTrack(output, track_id, fps, n_cam_all);
             output.close();
         }, py::arg("file"), py::arg("track_id"), py::arg("fps")=1, py::arg("n_cam_all")=0)
-        .def_readwrite("_obj3d_list", &Track<Tracer3D>::_obj3d_list)
+        .def_readwrite("_obj3d_list", &Track<Tracer3D>::_obj3d_list, "latest objects only (at most LEN_TRACK_LIVE), use getObj3DList or getObj3D for the full track")
         .def_readwrite("_t_list", &Track<Tracer3D>::_t_list)
         .def_readwrite("_n_obj3d", &Track<Tracer3D>::_n_obj3d)
         .def_readwrite("_active", &Track<Tracer3D>::_active)
+        .def_readwrite("_track_id", &Track<Tracer3D>::_track_id)
+        .def_readwrite("_pt_list", &Track<Tracer3D>::_pt_list)
+        .def_readwrite("_error_list", &Track<Tracer3D>::_error_list)
+        .def_readwrite("_obs_start", &Track<Tracer3D>::_obs_start)
+        .def_readwrite("_obs_camid_list", &Track<Tracer3D>::_obs_camid_list)
+        .def_readwrite("_obs_pt_list", &Track<Tracer3D>::_obs_pt_list)
+        .def("getPt3D", &Track<Tracer3D>::getPt3D, py::arg("i"))
+        .def("getObj3D", &Track<Tracer3D>::getObj3D, py::arg("i"))
+        .def("getObj3DList", [](Track<Tracer3D> const& self){
+            std::vector<Tracer3D> obj3d_list;
+            obj3d_list.reserve(self._n_obj3d);
+            for (int i = 0; i < self._n_obj3d; i ++)
+            {
+                obj3d_list.push_back(self.getObj3D(i));
+            }
+            return obj3d_list;
+        }, "all objects of the track, rebuilt from the compact history")
         .def("to_dict", [](Track<Tracer3D> const& self){
             return py::dict(
-                "_obj3d_list"_a=self._obj3d_list, "_t_list"_a=self._t_list, "_n_obj3d"_a=self._n_obj3d, "_active"_a=self._active
+                "_obj3d_list"_a=self._obj3d_list, "_t_list"_a=self._t_list, "_n_obj3d"_a=self._n_obj3d, "_active"_a=self._active, "_track_id"_a=self._track_id, "_pt_list"_a=self._pt_list, "_error_list"_a=self._error_list, "_obs_start"_a=self._obs_start, "_obs_camid_list"_a=self._obs_camid_list, "_obs_pt_list"_a=self._obs_pt_list
             );
         })
         .doc() = "TracerTrack class";
@@ -0,0 +1,73 @@
+
+// numpy view on memory owned by base (read-only)
+template<class T>
+py::array_t<T> view_to_numpy(T const* data, int64_t n, py::handle base)
+{
+    py::array_t<T> array({n}, {sizeof(T)}, data, base);
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+void init_TrackFile(py::module &m) 
+{
+    py::class_<TrackFileReader>(m, "TrackFileReader")
+        .def(py::init<std::string const&>())
+        .def("getNumOfChunk", &TrackFileReader::getNumOfChunk)
+        .def("getNumOfTrack", &TrackFileReader::getNumOfTrack)
+        .def("getNumOfPt", &TrackFileReader::getNumOfPt)
+        .def("getNumOfCam", &TrackFileReader::getNumOfCam)
+        .def("getFPS", &TrackFileReader::getFPS)
+        .def("getChunk", [](py::object self_obj, int chunk_id){
+            // arrays are views on the memory map, they keep the reader alive
+            TrackChunk chunk = self_obj.cast<TrackFileReader&>().getChunk(chunk_id);
+            return py::dict(
+                "track_id"_a=view_to_numpy(chunk.track_id, chunk.n_track, self_obj),
+                "track_start"_a=view_to_numpy(chunk.track_start, chunk.n_track+1, self_obj),
+                "frame"_a=view_to_numpy(chunk.frame, chunk.n_pt, self_obj),
+                "x"_a=view_to_numpy(chunk.x, chunk.n_pt, self_obj),
+                "y"_a=view_to_numpy(chunk.y, chunk.n_pt, self_obj),
+                "z"_a=view_to_numpy(chunk.z, chunk.n_pt, self_obj),
+                "error"_a=view_to_numpy(chunk.error, chunk.n_pt, self_obj),
+                "obs_start"_a=view_to_numpy(chunk.obs_start, chunk.n_pt+1, self_obj),
+                "obs_cam"_a=view_to_numpy(chunk.obs_cam, chunk.n_obs, self_obj),
+                "obs_x"_a=view_to_numpy(chunk.obs_x, chunk.n_obs, self_obj),
+                "obs_y"_a=view_to_numpy(chunk.obs_y, chunk.n_obs, self_obj)
+            );
+        })
+        .def("readPoints", [](TrackFileReader const& self){
+            // one row per point over all chunks (copy): TrackID, FrameID, WorldX, WorldY, WorldZ, Error
+            int64_t n_pt = self.getNumOfPt();
+            py::array_t<int64_t> track_id(n_pt);
+            py::array_t<int32_t> frame(n_pt);
+            py::array_t<double> xyz({n_pt, int64_t(3)});
+            py::array_t<double> error(n_pt);
+            auto track_id_buf = track_id.mutable_unchecked<1>();
+            auto frame_buf = frame.mutable_unchecked<1>();
+            auto xyz_buf = xyz.mutable_unchecked<2>();
+            auto error_buf = error.mutable_unchecked<1>();
+
+            int64_t k = 0;
+            for (int c = 0; c < self.getNumOfChunk(); c ++)
+            {
+                TrackChunk chunk = self.getChunk(c);
+                for (int i = 0; i < chunk.n_track; i ++)
+                {
+                    for (int64_t j = chunk.track_start[i]; j < chunk.track_start[i+1]; j ++, k ++)
+                    {
+                        track_id_buf(k) = chunk.track_id[i];
+                        frame_buf(k) = chunk.frame[j];
+                        xyz_buf(k, 0) = chunk.x[j];
+                        xyz_buf(k, 1) = chunk.y[j];
+                        xyz_buf(k, 2) = chunk.z[j];
+                        error_buf(k) = chunk.error[j];
+                    }
+                }
+            }
+            return py::dict("track_id"_a=track_id, "frame"_a=frame, "xyz"_a=xyz, "error"_a=error);
+        })
+        .doc() = "TrackFileReader class";
+
+    m.def("isTrackFileBin", &isTrackFileBin);
+    m.def("convertTrackBinToCSV", &convertTrackBinToCSV, py::arg("file_bin"), py::arg("file_csv"));
+    m.def("convertTrackCSVToBin", &convertTrackCSVToBin, py::arg("file_csv"), py::arg("file_bin"), py::arg("fps")=1);
+}
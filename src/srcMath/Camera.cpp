@@ -373,6 +373,63 @@ void Camera::saveParameters (std::string file_name)
 // 
 // Get image size
 //
+PixelRange Camera::projectROI (AxisLimit const& axis_limit, int margin_px) const
+{
+    int n_row = getNRow();
+    int n_col = getNCol();
+
+    // the edges of the box can be curved by distortion, sample the faces and not only the corners
+    int n_sample = 5;
+    double x_min = std::numeric_limits<double>::max(), x_max = -std::numeric_limits<double>::max();
+    double y_min = std::numeric_limits<double>::max(), y_max = -std::numeric_limits<double>::max();
+    for (int i = 0; i < n_sample; i ++)
+    {
+        for (int j = 0; j < n_sample; j ++)
+        {
+            for (int k = 0; k < n_sample; k ++)
+            {
+                Pt3D pt_world(
+                    axis_limit.x_min + (axis_limit.x_max - axis_limit.x_min) * i / (n_sample-1),
+                    axis_limit.y_min + (axis_limit.y_max - axis_limit.y_min) * j / (n_sample-1),
+                    axis_limit.z_min + (axis_limit.z_max - axis_limit.z_min) * k / (n_sample-1)
+                );
+                Pt2D pt_img = project(pt_world);
+                if (!std::isfinite(pt_img[0]) || !std::isfinite(pt_img[1]))
+                {
+                    continue;
+                }
+                x_min = std::min(x_min, pt_img[0]);
+                x_max = std::max(x_max, pt_img[0]);
+                y_min = std::min(y_min, pt_img[1]);
+                y_max = std::max(y_max, pt_img[1]);
+            }
+        }
+    }
+
+    PixelRange roi;
+    if (x_min > x_max)
+    {
+        // nothing can be projected, keep the whole image
+        roi.row_max = n_row;
+        roi.col_max = n_col;
+        return roi;
+    }
+
+    // x: col, y: row
+    roi.row_min = std::max(0, int(std::floor(y_min)) - margin_px);
+    roi.row_max = std::min(n_row, int(std::ceil(y_max)) + 1 + margin_px);
+    roi.col_min = std::max(0, int(std::floor(x_min)) - margin_px);
+    roi.col_max = std::min(n_col, int(std::ceil(x_max)) + 1 + margin_px);
+
+    // the volume is not seen at all
+    if (roi.row_min >= roi.row_max || roi.col_min >= roi.col_max)
+    {
+        roi.row_min = roi.row_max = roi.col_min = roi.col_max = 0;
+    }
+    return roi;
+}
+
+
 int Camera::getNRow () const
 {
     if (_type == PINHOLE)
@@ -754,4 +811,62 @@ Line3D Camera::polyLineOfSight (Pt2D const& pt_img_dist) const
     Line3D line = {pt_world_1, unit_vec};
 
     return line;
-}
\ No newline at end of file
+}
+
+void CamList::setROI (AxisLimit const& axis_limit, int margin_px)
+{
+    roi_list.resize(cam_list.size());
+    for (int i = 0; i < cam_list.size(); i ++)
+    {
+        roi_list[i] = cam_list[i].projectROI(axis_limit, margin_px);
+    }
+}
+
+
+PixelRange CamList::getROI (int cam_id) const
+{
+    if (cam_id < int(roi_list.size()))
+    {
+        return roi_list[cam_id];
+    }
+
+    PixelRange roi;
+    roi.row_max = cam_list[cam_id].getNRow();
+    roi.col_max = cam_list[cam_id].getNCol();
+    return roi;
+}
+
+
+void CamList::setMask (int cam_id, Image const& img)
+{
+    int n_row = cam_list[cam_id].getNRow();
+    int n_col = cam_list[cam_id].getNCol();
+    if (img.getDimRow() != n_row || img.getDimCol() != n_col)
+    {
+        std::cerr << "CamList::setMask error at line " << __LINE__ << ":\n"
+                  << "The mask size (" << img.getDimRow() << "," << img.getDimCol() << ") "
+                  << "is different from the image size (" << n_row << "," << n_col << ") of camera " << cam_id << "." << std::endl;
+        throw error_size;
+    }
+
+    mask_list.resize(cam_list.size());
+    PixelMask& mask = mask_list[cam_id];
+    mask.config(n_row, n_col);
+    for (int i = 0; i < n_row; i ++)
+    {
+        for (int j = 0; j < n_col; j ++)
+        {
+            mask.set(i, j, img(i,j) != 0);
+        }
+    }
+}
+
+
+PixelMask const* CamList::getMask (int cam_id) const
+{
+    if (cam_id < int(mask_list.size()) && !mask_list[cam_id].isEmpty())
+    {
+        return &mask_list[cam_id];
+    }
+    return nullptr;
+}
@@ -1,8 +1,12 @@
 #include "ImageIO.h"
 
 
+static_assert(sizeof(ImageStackHeader) == 64, "ImageStackHeader must be 64 bytes");
+
 ImageIO::ImageIO (const ImageIO& img)
-    : _n_row(img._n_row), _n_col(img._n_col), _bits_per_sample(img._bits_per_sample), _n_channel(img._n_channel), _is_tiled(img._is_tiled), _tile_height0(img._tile_height0), _tile_width0(img._tile_width0), _img_orientation(img._img_orientation), _img_id(img._img_id), _img_path(img._img_path)
+    : _n_row(img._n_row), _n_col(img._n_col), _bits_per_sample(img._bits_per_sample), _n_channel(img._n_channel), _is_tiled(img._is_tiled), _tile_height0(img._tile_height0), _tile_width0(img._tile_width0), _img_orientation(img._img_orientation), _img_id(img._img_id), _img_path(img._img_path), 
+      _source(img._source), _stack_map(img._stack_map), _stack_header(img._stack_header), _stack_frame(img._stack_frame), 
+      _roi(img._roi), _is_roi(img._is_roi)
 {}
 
 ImageIO::ImageIO (std::string folder_path, std::string file_img_path)
@@ -22,12 +26,21 @@ void ImageIO::init ()
     _img_orientation = ORIENTATION_TOPLEFT;
     _img_id = -1;
     _img_path.clear();
+
+    _source = IMG_PATH_LIST;
+    _stack_map.reset();
+    _stack_header = ImageStackHeader();
+    _stack_frame.clear();
+    _stack_tif.reset();
+
+    _roi = PixelRange();
+    _is_roi = false;
 }
 
 
 void ImageIO::loadImgPath (std::string folder_path, std::string file_img_path)
 {
-    std::ifstream infile(folder_path + file_img_path, std::ios::in);
+    std::ifstream infile(folder_path + file_img_path, std::ios::in | std::ios::binary);
 
     if (!infile.is_open())
     {
@@ -38,9 +51,31 @@ void ImageIO::loadImgPath (std::string folder_path, std::string file_img_path)
     // Initialize image path
     init();
 
+    // a stack is detected from its first bytes
+    char magic[8] = {0};
+    infile.read(magic, 8);
+    infile.clear();
+    infile.seekg(0);
+    if (std::memcmp(magic, IMGSTACK_MAGIC, 8) == 0)
+    {
+        infile.close();
+        loadRawStack(folder_path + file_img_path);
+        return;
+    }
+    if (std::memcmp(magic, "II*\0", 4) == 0 || std::memcmp(magic, "MM\0*", 4) == 0 || std::memcmp(magic, "II+\0", 4) == 0 || std::memcmp(magic, "MM\0+", 4) == 0)
+    {
+        infile.close();
+        loadTiffStack(folder_path + file_img_path);
+        return;
+    }
+
     std::string line;
     while (std::getline(infile, line)) 
     {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
         _img_path.push_back(folder_path + line);
     }
     infile.close();
@@ -52,17 +87,293 @@ void ImageIO::loadImgPath (std::string folder_path, std::string file_img_path)
 }
 
 
+void ImageIO::loadRawStack (std::string const& file)
+{
+    _stack_map = std::make_shared<MappedFile>(file);
+    if (_stack_map->size() < sizeof(ImageStackHeader))
+    {
+        std::cerr << "ImageIO::loadRawStack error at line " << __LINE__ << ":\n"
+                  << file << " is too small to be an image stack." << std::endl;
+        throw error_io;
+    }
+    std::memcpy(&_stack_header, _stack_map->data(), sizeof(ImageStackHeader));
+
+    ImageStackHeader const& header = _stack_header;
+    uint64_t bytes_per_frame = uint64_t(header.n_row) * header.n_col * (header.bits_per_sample / BITS_PER_BYTE);
+    if (header.version != IMGSTACK_VERSION)
+    {
+        std::cerr << "ImageIO::loadRawStack error at line " << __LINE__ << ":\n"
+                  << file << " is not an image stack of version " << IMGSTACK_VERSION << "." << std::endl;
+        throw error_type;
+    }
+    if (!(header.bits_per_sample==8 || header.bits_per_sample==16 || header.bits_per_sample==32 || header.bits_per_sample==64) 
+        || header.n_row == 0 || header.n_col == 0 || header.frame_stride < bytes_per_frame 
+        || header.frame_offset < sizeof(ImageStackHeader) 
+        || (header.n_frame > 0 && header.frame_offset + (header.n_frame-1) * header.frame_stride + bytes_per_frame > _stack_map->size()))
+    {
+        std::cerr << "ImageIO::loadRawStack error at line " << __LINE__ << ":\n"
+                  << "Invalid header of image stack " << file << ": "
+                  << "bits_per_sample = " << header.bits_per_sample << ", "
+                  << "size = " << header.n_row << " x " << header.n_col << ", "
+                  << "n_frame = " << header.n_frame << std::endl;
+        throw error_io;
+    }
+
+    _source = IMG_RAW_STACK;
+    _n_row = header.n_row;
+    _n_col = header.n_col;
+    _bits_per_sample = header.bits_per_sample;
+    _n_channel = 1;
+}
+
+
+// rows are stored bottom-up
+static bool isVertFlip (uint16 orientation)
+{
+    return orientation == ORIENTATION_BOTLEFT || orientation == ORIENTATION_BOTRIGHT || orientation == ORIENTATION_LEFTBOT || orientation == ORIENTATION_RIGHTBOT;
+}
+
+
+void ImageIO::loadTiffStack (std::string const& file)
+{
+    _stack_map = std::make_shared<MappedFile>(file);
+
+    TIFF* tif = TIFFOpen(file.c_str(), "r");
+    if (tif == NULL) 
+    {
+        std::cerr << "ImageIO::loadTiffStack: Could not open image!" << std::endl;
+        throw error_io;
+    }
+    _stack_tif = std::shared_ptr<TIFF>(tif, TIFFClose);
+
+    // scan all pages once, frames are then accessed directly
+    do
+    {
+        ImageStackFrame frame;
+        frame.dir_offset = TIFFCurrentDirOffset(tif);
+
+        uint32 n_row = 0, n_col = 0;
+        uint16 bits_per_sample = 0, n_channel = 1, compression = COMPRESSION_NONE, orientation = ORIENTATION_TOPLEFT;
+        IMAGEIO_CHECK_CALL(TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &n_row));
+        IMAGEIO_CHECK_CALL(TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &n_col));
+        IMAGEIO_CHECK_CALL(TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bits_per_sample));
+        TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &n_channel);
+        TIFFGetFieldDefaulted(tif, TIFFTAG_COMPRESSION, &compression);
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ORIENTATION, &orientation);
+        frame.n_row = n_row;
+        frame.n_col = n_col;
+        frame.bits_per_sample = bits_per_sample;
+        frame.is_vert_flip = isVertFlip(orientation);
+
+        // uncompressed strips that follow each other are used in place
+        size_t bytes_per_frame = size_t(n_row) * n_col * (bits_per_sample / BITS_PER_BYTE);
+        if (!TIFFIsTiled(tif) && !TIFFIsByteSwapped(tif) && compression == COMPRESSION_NONE && n_channel == 1 && bits_per_sample % BITS_PER_BYTE == 0)
+        {
+            uint64* strip_offset = nullptr;
+            uint64* strip_byte = nullptr;
+            uint32 n_strip = TIFFNumberOfStrips(tif);
+            if (n_strip > 0 && TIFFGetField(tif, TIFFTAG_STRIPOFFSETS, &strip_offset) && TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &strip_byte))
+            {
+                uint64 n_byte = 0;
+                bool is_contiguous = true;
+                for (uint32 i = 0; i < n_strip && is_contiguous; i ++)
+                {
+                    is_contiguous = strip_offset[i] == strip_offset[0] + n_byte;
+                    n_byte += strip_byte[i];
+                }
+                if (is_contiguous && n_byte >= bytes_per_frame && strip_offset[0] + bytes_per_frame <= _stack_map->size())
+                {
+                    frame.data_offset = strip_offset[0];
+                }
+            }
+        }
+
+        _stack_frame.push_back(frame);
+    } while (TIFFReadDirectory(tif));
+
+    _source = IMG_TIFF_STACK;
+    _n_row = _stack_frame[0].n_row;
+    _n_col = _stack_frame[0].n_col;
+    _bits_per_sample = _stack_frame[0].bits_per_sample;
+    _n_channel = 1;
+}
+
+
+void ImageIO::setROI (PixelRange const& roi)
+{
+    _roi = roi;
+    _is_roi = true;
+}
+
+
+PixelRange ImageIO::getDecodeRegion () const
+{
+    PixelRange region;
+    region.row_max = _n_row;
+    region.col_max = _n_col;
+    if (_is_roi)
+    {
+        region.row_min = std::min(std::max(_roi.row_min, 0), _n_row);
+        region.row_max = std::min(std::max(_roi.row_max, region.row_min), _n_row);
+        region.col_min = std::min(std::max(_roi.col_min, 0), _n_col);
+        region.col_max = std::min(std::max(_roi.col_max, region.col_min), _n_col);
+    }
+    return region;
+}
+
+
+int ImageIO::getNumOfImg () const
+{
+    switch (_source)
+    {
+    case IMG_RAW_STACK:
+        return _stack_header.n_frame;
+    case IMG_TIFF_STACK:
+        return _stack_frame.size();
+    default:
+        return _img_path.size();
+    }
+}
+
+
+template<class T>
+void convertRow (double* dst, uchar const* src, int n_col)
+{
+    T const* src_typed = reinterpret_cast<T const*>(src);
+    for (int j = 0; j < n_col; j ++)
+    {
+        dst[j] = (double) src_typed[j];
+    }
+}
+
+void ImageBuffer::toImage (Image& image) const
+{
+    if (image.getDimRow() != n_row || image.getDimCol() != n_col)
+    {
+        image = Image(n_row, n_col, 0);
+    }
+    if (n_row == 0 || n_col == 0)
+    {
+        return;
+    }
+
+    // pixels outside the roi are 0
+    bool is_full = roi.row_min == 0 && roi.row_max == n_row && roi.col_min == 0 && roi.col_max == n_col;
+    if (!is_full)
+    {
+        std::fill(&image[0], &image[0] + size_t(n_row) * n_col, 0.0);
+    }
+
+    int n_col_roi = roi.getNumOfCol();
+    size_t col_offset = size_t(roi.col_min) * (bits_per_sample / BITS_PER_BYTE);
+    for (int i = roi.row_min; i < roi.row_max; i ++)
+    {
+        double* dst = &image[0] + size_t(i) * n_col + roi.col_min;
+        uchar const* src = row(i) + col_offset;
+        switch (bits_per_sample)
+        {
+        case 8:
+            convertRow<uint8>(dst, src, n_col_roi);
+            break;
+        case 16:
+            convertRow<uint16>(dst, src, n_col_roi);
+            break;
+        case 32:
+            convertRow<uint32>(dst, src, n_col_roi);
+            break;
+        case 64:
+            convertRow<uint64>(dst, src, n_col_roi);
+            break;
+        default:
+            std::cerr << "ImageBuffer::toImage: Image bits per sample is out of range! " 
+                      << "bits_per_sample: " << bits_per_sample << " "
+                      << "Line: " << __LINE__
+                      << std::endl;
+            throw error_type;
+        }
+    }
+}
+
+
 Image ImageIO::loadImg (int img_id)
 {
-    if (img_id >= int(_img_path.size()))
+    Image image;
+    loadImgInto(img_id, image);
+    return image;
+}
+
+
+void ImageIO::loadImgInto (int img_id, Image& image)
+{
+    loadImgInto(img_id, _buffer);
+    _buffer.toImage(image);
+}
+
+
+void ImageIO::loadImgInto (int img_id, ImageBuffer& buffer)
+{
+    int n_img = getNumOfImg();
+    if (img_id >= n_img || img_id < 0)
     {
         std::cerr << "Image id: " << img_id 
                   << " is larger than total number of image: " 
-                  << _img_path.size()
+                  << n_img
                   << std::endl;
         throw error_size;
     }
     _img_id = img_id;
+
+    // pixels of a mapped frame are used in place
+    uint64_t data_offset = 0;
+    bool is_view = false;
+    bool vert_flip = false;
+    if (_source == IMG_RAW_STACK)
+    {
+        data_offset = _stack_header.frame_offset + img_id * _stack_header.frame_stride;
+        is_view = true;
+    }
+    else if (_source == IMG_TIFF_STACK && _stack_frame[img_id].data_offset >= 0)
+    {
+        ImageStackFrame const& frame = _stack_frame[img_id];
+        _n_row = frame.n_row;
+        _n_col = frame.n_col;
+        _bits_per_sample = frame.bits_per_sample;
+        IMAGEIO_CHECK_CALL((_bits_per_sample==8 || _bits_per_sample==16 || _bits_per_sample==32 || _bits_per_sample==64));
+        data_offset = frame.data_offset;
+        is_view = true;
+        vert_flip = frame.is_vert_flip;
+    }
+    if (is_view)
+    {
+        std::ptrdiff_t bytes_per_row = _n_col * (_bits_per_sample / BITS_PER_BYTE);
+        buffer.n_row = _n_row;
+        buffer.n_col = _n_col;
+        buffer.bits_per_sample = _bits_per_sample;
+        buffer.row_stride = vert_flip ? -bytes_per_row : bytes_per_row;
+        buffer.row0_offset = vert_flip ? (_n_row - 1) * bytes_per_row : 0;
+        buffer.view = reinterpret_cast<uchar const*>(_stack_map->data()) + data_offset;
+        buffer.roi = getDecodeRegion();
+        return;
+    }
+
+    // compressed page of a multi-page tiff
+    if (_source == IMG_TIFF_STACK)
+    {
+        if (!_stack_tif)
+        {
+            TIFF* tif = TIFFOpen(_stack_map->getFile().c_str(), "r");
+            if (tif == NULL) 
+            {
+                std::cerr << "ImageIO::LoadImg: Could not open image!" << std::endl;
+                throw error_io;
+            }
+            _stack_tif = std::shared_ptr<TIFF>(tif, TIFFClose);
+        }
+        IMAGEIO_CHECK_CALL(TIFFSetSubDirectory(_stack_tif.get(), _stack_frame[img_id].dir_offset));
+        readTiff(_stack_tif.get(), buffer);
+        return;
+    }
+
     std::string file = _img_path[img_id];
     
     TIFF* tif;
@@ -72,12 +383,19 @@ Image ImageIO::loadImg (int img_id)
         throw error_io;
     }
 
-    // check is the image is colorful
-    _n_channel = 1;
+    // close the file on every error
+    struct TIFFCloser { TIFF* tif; ~TIFFCloser() { TIFFClose(tif); } } tif_closer{tif};
+
+    readTiff(tif, buffer);
+}
 
-    #ifdef DEBUG
-    IMAGEIO_CHECK_CALL_DEBUG(TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &_n_channel));
-    #endif
+
+void ImageIO::readTiff (TIFF* tif, ImageBuffer& buffer)
+{
+    // check is the image is colorful
+    uint16 n_channel = 1;
+    TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &n_channel);
+    _n_channel = n_channel;
     if (_n_channel != 1)
     {
         std::cerr << "ImageIO::LoadImg: current version not supported for colorful image! " 
@@ -97,194 +415,105 @@ Image ImageIO::loadImg (int img_id)
 
     // check is the image is tiled or stripped
     _is_tiled = TIFFIsTiled(tif) != 0;
-    bool is_read_scanline = false;
     if (_is_tiled)
     {
         IMAGEIO_CHECK_CALL(TIFFGetField(tif, TIFFTAG_TILELENGTH, &_tile_height0));
         IMAGEIO_CHECK_CALL(TIFFGetField(tif, TIFFTAG_TILEWIDTH, &_tile_width0));
         IMAGEIO_CHECK_CALL((_tile_height0>0 && _tile_height0<=TILE_MAX_HEIGHT && _tile_width0>0 && _tile_width0<=TILE_MAX_WIDTH));
-
-        // For debug
-        // if (_tile_height0 > TILE_MAX_HEIGHT || _tile_width0 > TILE_MAX_WIDTH || _tile_height0 <= 0 || _tile_width0 <= 0)
-        // {
-        //     std::cerr << "ImageIO::LoadImg: Image tile size is out of range! " 
-        //               << "_tile_height0: " << _tile_height0 << " "
-        //               << "_tile_width0: " << _tile_width0 << " "
-        //               << "Line: " << __LINE__
-        //               << std::endl;
-        //     throw error_io;
-        // }
     }
     else 
     {
+        // a missing tag means the whole image is one strip
         _tile_width0 = _n_col;
-
-        if (_bits_per_sample <= 32)
-        {
-            is_read_scanline = true;
-            _tile_height0 = 1; // read each scanline
-        }
-        else 
-        {
-            _tile_height0 = _n_row;
-        }
+        uint32 rows_per_strip = _n_row;
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+        _tile_height0 = int(std::min(rows_per_strip, uint32(_n_row)));
+        IMAGEIO_CHECK_CALL((_tile_height0 > 0));
     }
-    
-    // create buffer to store image data
-    const size_t buffer_bytes_per_row = (_n_channel*_tile_width0*_bits_per_sample + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
-    const size_t buffer_size = _tile_height0 * buffer_bytes_per_row;
-    if (buffer_size > MAX_TILE_SIZE)
+
+    // check image orientation
+    uint16 orientation = ORIENTATION_TOPLEFT;
+    TIFFGetFieldDefaulted(tif, TIFFTAG_ORIENTATION, &orientation);
+    _img_orientation = orientation;
+    bool vert_flip = isVertFlip(orientation);
+
+    // the whole image in file order, resize keeps the storage of the previous frame
+    const size_t bytes_per_sample = _bits_per_sample / BITS_PER_BYTE;
+    const size_t bytes_per_row = _n_col * bytes_per_sample;
+    const size_t img_size = _n_row * bytes_per_row;
+    if (bytes_per_row * _tile_height0 > MAX_TILE_SIZE)
     {
         std::cerr << "ImageIO::LoadImg: Image buffer size is out of range! " 
-                  << "buffer_size: " << buffer_size << " "
+                  << "buffer_size: " << bytes_per_row * _tile_height0 << " "
                   << "Line: " << __LINE__
                   << std::endl;
         throw error_io;
     }
-    uchar* buffer = new uchar[buffer_size]; 
-    
-    // check image orientation
-    _img_orientation = ORIENTATION_TOPLEFT;
-    #ifdef DEBUG
-    IMAGEIO_CHECK_CALL_DEBUG(TIFFGetField(tif, TIFFTAG_ORIENTATION, &_img_orientation));
-    #endif
-    bool vert_flip = _img_orientation == ORIENTATION_BOTLEFT || _img_orientation == ORIENTATION_BOTRIGHT || _img_orientation == ORIENTATION_LEFTBOT || _img_orientation == ORIENTATION_RIGHTBOT;
-
-    // initialize data array to convert buffer
-    const size_t data_num_per_row = _n_channel * _tile_width0 * _tile_height0;
-    uint8*  buffer_8 = nullptr;
-    uint16* buffer_16 = nullptr;
-    uint32* buffer_32 = nullptr;
-    uint64* buffer_64 = nullptr;
-    switch (_bits_per_sample)
-    {
-    case 8:
-        buffer_8 = new uint8[data_num_per_row];
-        buffer_16 = nullptr;
-        buffer_32 = nullptr;
-        buffer_64 = nullptr;
-        break;
-    case 16:
-        buffer_8 = nullptr;
-        buffer_16 = new uint16[data_num_per_row];
-        buffer_32 = nullptr;
-        buffer_64 = nullptr;
-        break;
-    case 32:
-        buffer_8 = nullptr;
-        buffer_16 = nullptr;
-        buffer_32 = new uint32[data_num_per_row];
-        buffer_64 = nullptr;
-        break;
-    case 64:
-        buffer_8 = nullptr;
-        buffer_16 = nullptr;
-        buffer_32 = nullptr;
-        buffer_64 = new uint64[data_num_per_row];
-        break;
-    default:
-        std::cerr << "ImageIO::LoadImg: Image bits per sample is out of range! " 
-                  << "_bits_per_sample: " << _bits_per_sample << " "
-                  << "Line: " << __LINE__
-                  << std::endl;
-        break;
-    }
+    buffer.n_row = _n_row;
+    buffer.n_col = _n_col;
+    buffer.bits_per_sample = _bits_per_sample;
+    buffer.data.resize(img_size);
+    buffer.row_stride = vert_flip ? -std::ptrdiff_t(bytes_per_row) : std::ptrdiff_t(bytes_per_row);
+    buffer.row0_offset = vert_flip ? img_size - bytes_per_row : 0;
+    buffer.view = nullptr;
+    buffer.roi = getDecodeRegion();
 
-    // read image data
-    Image image(_n_row, _n_col, -1);
-    int tile_id = 0;
-    for (int row = 0; row < _n_row; row += _tile_height0)
-    {
-        int tile_height = std::min(_tile_height0, _n_row - row);
-        const int img_row = vert_flip ? _n_row-1-row : row; 
+    // roi rows in file order
+    const int file_row_min = vert_flip ? _n_row - buffer.roi.row_max : buffer.roi.row_min;
+    const int file_row_max = vert_flip ? _n_row - buffer.roi.row_min : buffer.roi.row_max;
 
-        for (int col = 0; col < _n_col; col += _tile_width0, tile_id ++)
+    uchar* data = buffer.data.data();
+    if (!_is_tiled)
+    {
+        // strips are consecutive rows, each strip is decoded at its place
+        //  strips outside the roi are skipped
+        int n_strip = (_n_row + _tile_height0 - 1) / _tile_height0;
+        for (int strip_id = 0; strip_id < n_strip; strip_id ++)
         {
-            int tile_width = std::min(_tile_width0, _n_col - col);
-
-            if (_is_tiled)
-            {
-                IMAGEIO_CHECK_CALL((TIFFReadEncodedTile(tif, tile_id, buffer, buffer_size) >= 0));
-            }
-            else if (is_read_scanline)
-            {
-                IMAGEIO_CHECK_CALL((TIFFReadScanline(tif, (uint32*)buffer, row) >= 0));
-            }
-            else
+            if ((strip_id+1) * _tile_height0 <= file_row_min || strip_id * _tile_height0 >= file_row_max)
             {
-                IMAGEIO_CHECK_CALL((TIFFReadEncodedStrip(tif, tile_id, buffer, buffer_size) >= 0));
+                continue;
             }
+            size_t offset = size_t(strip_id) * _tile_height0 * bytes_per_row;
+            IMAGEIO_CHECK_CALL((TIFFReadEncodedStrip(tif, strip_id, data + offset, img_size - offset) >= 0));
+        }
+    }
+    else
+    {
+        // a tile covers part of the rows, it is decoded once and copied row by row
+        const size_t bytes_per_tile_row = _tile_width0 * bytes_per_sample;
+        const size_t tile_size = _tile_height0 * bytes_per_tile_row;
+        if (tile_size > MAX_TILE_SIZE)
+        {
+            std::cerr << "ImageIO::LoadImg: Image tile size is out of range! " 
+                      << "tile_size: " << tile_size << " "
+                      << "Line: " << __LINE__
+                      << std::endl;
+            throw error_io;
+        }
+        buffer.tile.resize(tile_size);
 
-            switch (_bits_per_sample)
+        int tile_id = 0;
+        for (int row = 0; row < _n_row; row += _tile_height0)
+        {
+            int tile_height = std::min(_tile_height0, _n_row - row);
+            for (int col = 0; col < _n_col; col += _tile_width0, tile_id ++)
             {
-            case 8:
-                std::memcpy(buffer_8, buffer, buffer_size);
-                for (int i = 0; i < tile_height; i ++)
+                // tiles outside the roi are skipped
+                if (row + _tile_height0 <= file_row_min || row >= file_row_max || col + _tile_width0 <= buffer.roi.col_min || col >= buffer.roi.col_max)
                 {
-                    for (int j = 0; j < tile_width; j ++)
-                    {
-                        image(img_row+i, col+j) = (double) buffer_8[i*tile_width+j];
-                    }
-                }
-                break;
-            case 16:
-                std::memcpy(buffer_16, buffer, buffer_size);
-                for (int i = 0; i < tile_height; i ++)
-                {
-                    for (int j = 0; j < tile_width; j ++)
-                    {
-                        image(img_row+i, col+j) = (double) buffer_16[i*tile_width+j];
-                    }
+                    continue;
                 }
-                break;
-            case 32:
-                std::memcpy(buffer_32, buffer, buffer_size);
+
+                int tile_width = std::min(_tile_width0, _n_col - col);
+                IMAGEIO_CHECK_CALL((TIFFReadEncodedTile(tif, tile_id, buffer.tile.data(), tile_size) >= 0));
                 for (int i = 0; i < tile_height; i ++)
                 {
-                    for (int j = 0; j < tile_width; j ++)
-                    {
-                        image(img_row+i, col+j) = (double) buffer_32[i*tile_width+j];
-                    }
+                    std::memcpy(data + (row+i) * bytes_per_row + col * bytes_per_sample, buffer.tile.data() + i * bytes_per_tile_row, tile_width * bytes_per_sample);
                 }
-                break;
-            case 64:
-                std::memcpy(buffer_64, buffer, buffer_size);
-                for (int i = 0; i < tile_height; i ++)
-                {
-                    for (int j = 0; j < tile_width; j ++)
-                    {
-                        image(img_row+i, col+j) = (double) buffer_64[i*tile_width+j];
-                    }
-                }
-                break;
-            default:
-                break;
-            } 
+            }
         }
     }
-    
-    switch (_bits_per_sample)
-    {
-    case 8:
-        delete[] buffer_8;
-        break;
-    case 16:
-        delete[] buffer_16;
-        break;
-    case 32:
-        delete[] buffer_32;
-        break;
-    case 64:
-        delete[] buffer_64;
-        break;
-    default:
-        break;
-    }
-
-    _TIFFfree(buffer);
-    TIFFClose(tif);
-
-    return image;
 }
 
 
@@ -312,7 +541,7 @@ void ImageIO::saveImg (std::string save_path, Image const& image)
             TIFFSetField(tif, TIFFTAG_IMAGELENGTH, _n_row);
             TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, _n_col);
             TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, _n_channel);
-            TIFFSetField(tif, TIFFTAG_ORIENTATION, _img_orientation);
+            TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
             TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
 
             for (int iter_x = 0; iter_x < _n_row; iter_x ++)
@@ -339,7 +568,7 @@ void ImageIO::saveImg (std::string save_path, Image const& image)
             TIFFSetField(tif, TIFFTAG_IMAGELENGTH, _n_row);
             TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, _n_col);
             TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, _n_channel);
-            TIFFSetField(tif, TIFFTAG_ORIENTATION, _img_orientation);
+            TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
             TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
 
             for (int iter_x = 0; iter_x < _n_row; iter_x ++)
@@ -366,7 +595,7 @@ void ImageIO::saveImg (std::string save_path, Image const& image)
             TIFFSetField(tif, TIFFTAG_IMAGELENGTH, _n_row);
             TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, _n_col);
             TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, _n_channel);
-            TIFFSetField(tif, TIFFTAG_ORIENTATION, _img_orientation);
+            TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
             TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
 
             for (int iter_x = 0; iter_x < _n_row; iter_x ++)
@@ -393,7 +622,7 @@ void ImageIO::saveImg (std::string save_path, Image const& image)
             TIFFSetField(tif, TIFFTAG_IMAGELENGTH, _n_row);
             TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, _n_col);
             TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, _n_channel);
-            TIFFSetField(tif, TIFFTAG_ORIENTATION, _img_orientation);
+            TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
             TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
 
             for (int iter_x = 0; iter_x < _n_row; iter_x ++)
@@ -435,4 +664,508 @@ ImageParam ImageIO::getImgParam () const
     img_param.n_channel = _n_channel;
 
     return img_param;
-}
\ No newline at end of file
+}
+
+
+// background of one row from the raw samples of the window, then subtract, threshold and clip
+//  src[k]: row of frame k in the window, src[k_cur]: row of the processed frame
+//  work: n_col samples of type T
+template<class T>
+void preprocRow (double* dst, std::vector<uchar const*> const& src, int k_cur, int n_col, PreprocParam const& param, double const* sum, T* work)
+{
+    int n_window = src.size();
+    T const* cur = reinterpret_cast<T const*>(src[k_cur]);
+
+    switch (param.bg_type)
+    {
+    case BG_MIN:
+    {
+        std::memcpy(work, src[0], size_t(n_col) * sizeof(T));
+        for (int k = 1; k < n_window; k ++)
+        {
+            T const* frame = reinterpret_cast<T const*>(src[k]);
+            #pragma omp simd
+            for (int j = 0; j < n_col; j ++)
+            {
+                work[j] = std::min(work[j], frame[j]);
+            }
+        }
+        #pragma omp simd
+        for (int j = 0; j < n_col; j ++)
+        {
+            dst[j] = double(cur[j]) - double(work[j]);
+        }
+        break;
+    }
+    case BG_MEDIAN:
+    {
+        T val[IMG_PREPROC_MAX_WINDOW];
+        for (int j = 0; j < n_col; j ++)
+        {
+            for (int k = 0; k < n_window; k ++)
+            {
+                val[k] = reinterpret_cast<T const*>(src[k])[j];
+            }
+            std::nth_element(val, val + n_window/2, val + n_window);
+            dst[j] = double(cur[j]) - double(val[n_window/2]);
+        }
+        break;
+    }
+    case BG_MEAN:
+    {
+        double scale = 1.0 / n_window;
+        #pragma omp simd
+        for (int j = 0; j < n_col; j ++)
+        {
+            dst[j] = double(cur[j]) - sum[j] * scale;
+        }
+        break;
+    }
+    default:
+    {
+        #pragma omp simd
+        for (int j = 0; j < n_col; j ++)
+        {
+            dst[j] = double(cur[j]);
+        }
+        break;
+    }
+    }
+
+    // threshold (negative values are always removed) and clip
+    double threshold = std::max(param.threshold, 0.0);
+    double clip_max = param.clip_max < 0 ? std::numeric_limits<double>::max() : param.clip_max;
+    #pragma omp simd
+    for (int j = 0; j < n_col; j ++)
+    {
+        double val = dst[j] < threshold ? 0.0 : dst[j];
+        dst[j] = std::min(val, clip_max);
+    }
+}
+
+
+template<class T>
+void addSumRow (double* sum, uchar const* src, int n_col, double sign)
+{
+    T const* src_typed = reinterpret_cast<T const*>(src);
+    #pragma omp simd
+    for (int j = 0; j < n_col; j ++)
+    {
+        sum[j] += sign * double(src_typed[j]);
+    }
+}
+
+
+void Preprocessor::reset ()
+{
+    _frame.clear();
+    _frame_id.clear();
+    _sum.clear();
+    _is_sum = false;
+    _n_decode = 0;
+}
+
+
+void Preprocessor::addSum (ImageBuffer const& buffer, double sign)
+{
+    PixelRange const& roi = buffer.roi;
+    int n_col_roi = roi.getNumOfCol();
+    size_t col_offset = size_t(roi.col_min) * (buffer.bits_per_sample / BITS_PER_BYTE);
+    for (int i = roi.row_min; i < roi.row_max; i ++)
+    {
+        double* dst = _sum.data() + size_t(i) * buffer.n_col + roi.col_min;
+        uchar const* src = buffer.row(i) + col_offset;
+        switch (buffer.bits_per_sample)
+        {
+        case 8:
+            addSumRow<uint8>(dst, src, n_col_roi, sign);
+            break;
+        case 16:
+            addSumRow<uint16>(dst, src, n_col_roi, sign);
+            break;
+        case 32:
+            addSumRow<uint32>(dst, src, n_col_roi, sign);
+            break;
+        default:
+            addSumRow<uint64>(dst, src, n_col_roi, sign);
+            break;
+        }
+    }
+}
+
+
+void Preprocessor::process (ImageIO& imgio, int img_id, Image& image)
+{
+    int n_img = imgio.getNumOfImg();
+    if (img_id >= n_img || img_id < 0)
+    {
+        std::cerr << "Preprocessor::process error at line " << __LINE__ << ":\n"
+                  << "Image id: " << img_id << " is out of range [0," << n_img << ")." << std::endl;
+        throw error_range;
+    }
+    if (_param.bg_type != BG_NONE && (_param.n_window < 1 || _param.n_window > IMG_PREPROC_MAX_WINDOW))
+    {
+        std::cerr << "Preprocessor::process error at line " << __LINE__ << ":\n"
+                  << "Background window " << _param.n_window << " is out of range [1," << IMG_PREPROC_MAX_WINDOW << "]." << std::endl;
+        throw error_range;
+    }
+
+    // window [img_start, img_start+n_window) centered on img_id, shifted at the ends of the sequence
+    int n_window = _param.bg_type == BG_NONE ? 1 : std::min(_param.n_window, n_img);
+    int img_start = std::max(0, std::min(img_id - n_window/2, n_img - n_window));
+    if (int(_frame.size()) != n_window)
+    {
+        reset();
+        _frame.resize(n_window);
+        _frame_id.assign(n_window, -1);
+    }
+
+    // slots of frames that leave the window are loaded with the frames that enter it
+    std::vector<bool> is_kept(n_window, false);
+    for (int k = 0; k < n_window; k ++)
+    {
+        is_kept[k] = _frame_id[k] >= img_start && _frame_id[k] < img_start + n_window;
+    }
+    int slot = 0;
+    for (int id = img_start; id < img_start + n_window; id ++)
+    {
+        if (std::find(_frame_id.begin(), _frame_id.end(), id) != _frame_id.end())
+        {
+            continue;
+        }
+        while (is_kept[slot])
+        {
+            slot ++;
+        }
+
+        bool is_update_sum = _is_sum && _frame_id[slot] >= 0;
+        if (is_update_sum)
+        {
+            addSum(_frame[slot], -1);
+        }
+
+        _frame_id[slot] = -1;
+        try
+        {
+            imgio.loadImgInto(id, _frame[slot]);
+        }
+        catch (...)
+        {
+            reset();
+            throw;
+        }
+        _frame_id[slot] = id;
+        is_kept[slot] = true;
+        _n_decode ++;
+
+        ImageBuffer const& first = _frame[0];
+        ImageBuffer const& buffer = _frame[slot];
+        if (buffer.n_row != first.n_row || buffer.n_col != first.n_col || buffer.bits_per_sample != first.bits_per_sample ||
+            buffer.roi.row_min != first.roi.row_min || buffer.roi.row_max != first.roi.row_max || buffer.roi.col_min != first.roi.col_min || buffer.roi.col_max != first.roi.col_max)
+        {
+            std::cerr << "Preprocessor::process error at line " << __LINE__ << ":\n"
+                      << "Image " << id << " has a different size or roi from the other images in the background window." << std::endl;
+            reset();
+            throw error_size;
+        }
+
+        if (is_update_sum)
+        {
+            addSum(buffer, 1);
+        }
+    }
+
+    int k_cur = std::find(_frame_id.begin(), _frame_id.end(), img_id) - _frame_id.begin();
+    ImageBuffer const& cur = _frame[k_cur];
+    int n_row = cur.n_row;
+    int n_col = cur.n_col;
+    PixelRange const& roi = cur.roi;
+    if (cur.bits_per_sample != 8 && cur.bits_per_sample != 16 && cur.bits_per_sample != 32 && cur.bits_per_sample != 64)
+    {
+        std::cerr << "Preprocessor::process error at line " << __LINE__ << ":\n"
+                  << "Image bits per sample " << cur.bits_per_sample << " is not supported." << std::endl;
+        throw error_type;
+    }
+
+    // running sum of the window
+    if (_param.bg_type == BG_MEAN && !_is_sum)
+    {
+        _sum.assign(size_t(n_row) * n_col, 0.0);
+        for (int k = 0; k < n_window; k ++)
+        {
+            addSum(_frame[k], 1);
+        }
+        _is_sum = true;
+    }
+
+    if (image.getDimRow() != n_row || image.getDimCol() != n_col)
+    {
+        image = Image(n_row, n_col, 0);
+    }
+    if (n_row == 0 || n_col == 0)
+    {
+        return;
+    }
+    bool is_full = roi.row_min == 0 && roi.row_max == n_row && roi.col_min == 0 && roi.col_max == n_col;
+    if (!is_full)
+    {
+        std::fill(&image[0], &image[0] + size_t(n_row) * n_col, 0.0);
+    }
+
+    int n_col_roi = roi.getNumOfCol();
+    size_t col_offset = size_t(roi.col_min) * (cur.bits_per_sample / BITS_PER_BYTE);
+    _work.resize(n_col_roi);
+    std::vector<uchar const*> src(n_window);
+    for (int i = roi.row_min; i < roi.row_max; i ++)
+    {
+        for (int k = 0; k < n_window; k ++)
+        {
+            src[k] = _frame[k].row(i) + col_offset;
+        }
+        double* dst = &image[0] + size_t(i) * n_col + roi.col_min;
+        double const* sum = _is_sum ? _sum.data() + size_t(i) * n_col + roi.col_min : nullptr;
+        switch (cur.bits_per_sample)
+        {
+        case 8:
+            preprocRow<uint8>(dst, src, k_cur, n_col_roi, _param, sum, reinterpret_cast<uint8*>(_work.data()));
+            break;
+        case 16:
+            preprocRow<uint16>(dst, src, k_cur, n_col_roi, _param, sum, reinterpret_cast<uint16*>(_work.data()));
+            break;
+        case 32:
+            preprocRow<uint32>(dst, src, k_cur, n_col_roi, _param, sum, reinterpret_cast<uint32*>(_work.data()));
+            break;
+        default:
+            preprocRow<uint64>(dst, src, k_cur, n_col_roi, _param, sum, reinterpret_cast<uint64*>(_work.data()));
+            break;
+        }
+    }
+}
+
+
+void FrameLoader::start (std::vector<ImageIO>& imgio_list, int frame_start, int frame_end, int n_frame_ahead, int n_frame_cache)
+{
+    stop();
+
+    _imgio_list = &imgio_list;
+    _frame_start = frame_start;
+    _frame_end = frame_end;
+    _n_frame_ahead = std::max(n_frame_ahead, 0);
+    _n_frame_cache = std::max(n_frame_cache, _n_frame_ahead + 1);
+    _frame_req = frame_start;
+    _n_load = 0;
+
+    if (_preproc_list.size() > 0 && _preproc_list.size() != imgio_list.size())
+    {
+        std::cerr << "FrameLoader::start error at line " << __LINE__ << ":\n"
+                  << "Number of preprocessing parameters " << _preproc_list.size() << " is different from number of cameras " << imgio_list.size() << "." << std::endl;
+        throw error_size;
+    }
+    for (int i = 0; i < _preproc_list.size(); i ++)
+    {
+        _preproc_list[i].reset();
+    }
+
+    _is_stop = false;
+    _thread = std::thread(&FrameLoader::run, this);
+}
+
+
+void FrameLoader::setPreproc (std::vector<PreprocParam> const& param_list)
+{
+    if (_thread.joinable())
+    {
+        std::cerr << "FrameLoader::setPreproc error at line " << __LINE__ << ":\n"
+                  << "Preprocessing cannot be changed while the loader is running." << std::endl;
+        throw error_io;
+    }
+
+    _preproc_list.clear();
+    for (int i = 0; i < param_list.size(); i ++)
+    {
+        _preproc_list.push_back(Preprocessor(param_list[i]));
+    }
+}
+
+
+void FrameLoader::getFrame (int frame_id, std::vector<Image>& img_list)
+{
+    if (!_thread.joinable())
+    {
+        std::cerr << "FrameLoader::getFrame error at line " << __LINE__ << ":\n"
+                  << "Loader is not started." << std::endl;
+        throw error_io;
+    }
+    if (frame_id < _frame_start || frame_id > _frame_end)
+    {
+        std::cerr << "FrameLoader::getFrame error at line " << __LINE__ << ":\n"
+                  << "Frame " << frame_id << " is out of range [" << _frame_start << "," << _frame_end << "]." << std::endl;
+        throw error_range;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wait_list.insert(frame_id);
+    _frame_req = *_wait_list.begin();
+    _cv.notify_all();
+    _cv.wait(lock, [&]{ return _cache.count(frame_id) || _error.count(frame_id); });
+    _wait_list.erase(_wait_list.find(frame_id));
+    if (!_wait_list.empty())
+    {
+        _frame_req = *_wait_list.begin();
+        _cv.notify_all();
+    }
+
+    // a failed frame is not loaded again
+    auto it_error = _error.find(frame_id);
+    if (it_error != _error.end())
+    {
+        std::rethrow_exception(it_error->second);
+    }
+
+    // copy, the caller may modify the images
+    img_list = _cache[frame_id];
+    touch(frame_id);
+}
+
+
+void FrameLoader::setFrameAhead (int n_frame_ahead, int n_frame_cache)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _n_frame_ahead = std::max(n_frame_ahead, 0);
+        _n_frame_cache = std::max(n_frame_cache, _n_frame_ahead + 1);
+    }
+    _cv.notify_all();
+}
+
+
+void FrameLoader::stop ()
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _is_stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+
+    _cache.clear();
+    _lru.clear();
+    _error.clear();
+    _free.clear();
+    _wait_list.clear();
+}
+
+
+void FrameLoader::touch (int frame_id)
+{
+    _lru.remove(frame_id);
+    _lru.push_front(frame_id);
+
+    // drop the least recently used frames, the prefetch window and the waiting frames are kept
+    auto it = _lru.end();
+    while (int(_cache.size()) > _n_frame_cache && it != _lru.begin())
+    {
+        it --;
+        if (!isInWindow(*it) && !_wait_list.count(*it))
+        {
+            // keep the images of one frame to be loaded into
+            if (_free.empty())
+            {
+                _free.push_back(std::move(_cache[*it]));
+            }
+            _cache.erase(*it);
+            it = _lru.erase(it);
+        }
+    }
+}
+
+
+void FrameLoader::run ()
+{
+    int n_cam = _imgio_list->size();
+
+    while (true)
+    {
+        // first frame of the window that is not loaded
+        int frame_id = -1;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&]
+            { 
+                if (_is_stop)
+                {
+                    return true;
+                }
+                int frame_last = std::min(_frame_req + _n_frame_ahead, _frame_end);
+                for (int i = _frame_req; i <= frame_last; i ++)
+                {
+                    if (!_cache.count(i) && !_error.count(i))
+                    {
+                        frame_id = i;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (_is_stop)
+            {
+                return;
+            }
+        }
+
+        // reuse the images of an evicted frame
+        std::vector<Image> img_list;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_free.empty())
+            {
+                img_list = std::move(_free.back());
+                _free.pop_back();
+            }
+        }
+        img_list.resize(n_cam);
+        std::vector<std::exception_ptr> error_list(n_cam, nullptr);
+
+        #pragma omp parallel for num_threads(std::max(n_cam, 1))
+        for (int i = 0; i < n_cam; i ++)
+        {
+            // exceptions must not leave the parallel region
+            try
+            {
+                if (_preproc_list.size() > 0)
+                {
+                    _preproc_list[i].process((*_imgio_list)[i], frame_id, img_list[i]);
+                }
+                else
+                {
+                    (*_imgio_list)[i].loadImgInto(frame_id, img_list[i]);
+                }
+            }
+            catch (...)
+            {
+                error_list[i] = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it_error = std::find_if(error_list.begin(), error_list.end(), [](std::exception_ptr const& e){ return bool(e); });
+            if (it_error != error_list.end())
+            {
+                _error[frame_id] = *it_error;
+            }
+            else
+            {
+                _cache[frame_id] = std::move(img_list);
+                _n_load ++;
+                touch(frame_id);
+            }
+        }
+        _cv.notify_all();
+    }
+}
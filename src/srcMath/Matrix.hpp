@@ -46,16 +46,20 @@ Matrix<T>::Matrix (const Matrix<T>& mtx)
     std::copy(mtx._mtx, mtx._mtx + _n, _mtx);
 }
 
+template<class T> 
+Matrix<T>::Matrix (Matrix<T>&& mtx) noexcept
+    : _dim_row(mtx._dim_row), _dim_col(mtx._dim_col), _n(mtx._n), _is_space(mtx._is_space), _mtx(mtx._mtx)
+{
+    mtx._dim_row = 0;
+    mtx._dim_col = 0;
+    mtx._n = 0;
+    mtx._is_space = 0;
+    mtx._mtx = nullptr;
+}
+
 template<class T>
 Matrix<T>::Matrix (std::string file_name)
 {
-    std::string line;
-    T value;
-
-    // 1st loop: get _dim_row, _dim_col
-    int dim_row = 0;
-    int dim_col = 0;
-    
     std::ifstream infile;
     infile.open(file_name);
     if (!infile.is_open())
@@ -63,56 +67,21 @@ Matrix<T>::Matrix (std::string file_name)
         std::cerr << "Matrix<T>::Matrix error at line " << __LINE__ << ":\n" << "Cannot open file: " << file_name << std::endl;
         throw error_io;
     }
-
-    std::istringstream istream;
-    while (std::getline(infile, line))
-    {       
-        dim_row ++;
-        
-        if (dim_row == 1)
-        {
-            istream.str(line);
-            while(istream >> value)
-            {
-                dim_col ++;
-                if (istream.peek() == ',')
-                {
-                    istream.ignore();
-                }
-            }
-        }
-    }
     infile.close();
 
+    // _dim_col is the number of values in the first row
+    // NOTE: make sure each row has the same elem
+    std::vector<double> data;
+    int dim_col = 0;
+    int dim_row = readCSV(data, dim_col, file_name);
 
     if (dim_row!=0 && dim_col!=0) 
     {
         create(dim_row, dim_col);
-        
-        // 2nd loop: load data
-        std::ifstream infile_data;
-        infile_data.open(file_name);
-        
-        for (int i = 0; i < _dim_row; i ++)
+        for (int i = 0; i < _n; i ++)
         {
-            std::getline(infile_data, line);
-            std::istringstream istream_data;
-            istream_data.str(line);
-
-            int id_start = i * _dim_col;
-            int j = 0;
-            while (istream_data >> value)
-            {
-                _mtx[id_start+j] = value;
-                j ++;
-                if (istream_data.peek() == ',')
-                {
-                    istream_data.ignore();
-                }
-            } // NOTE: make sure each row has the same elem
+            _mtx[i] = T(data[i]);
         }
-
-        infile_data.close();
     }
     else 
     {
@@ -340,18 +309,7 @@ void Matrix<T>::write (std::string file_name)
     std::cout << "\nStart writing!" << std::endl;
 
     std::ofstream outfile(file_name, std::ios::out);
-    outfile.setf(std::ios_base::scientific);
-    outfile.precision(SAVEPRECISION);
-
-    for (int i = 0; i < _dim_row; i ++)
-    {
-        for (int j = 0; j < _dim_col-1; j ++)
-        {
-            outfile << _mtx[mapID(i,j)] << ",";
-        }
-        outfile << _mtx[mapID(i,_dim_col-1)] << "\n";
-    }
-
+    write(outfile);
     outfile.close();
     std::cout << "Finish writing!" << std::endl;
 }
@@ -363,14 +321,13 @@ void Matrix<T>::write (std::ostream& os)
     os.precision(SAVEPRECISION);
     // os.precision(std::numeric_limits<double>::max_digits10);
 
-    for (int i = 0; i < _dim_row; i ++)
-    {
+    writeTextParallel(os, _dim_row, [&](TextBuffer& buffer, int i){
         for (int j = 0; j < _dim_col-1; j ++)
         {
-            os << _mtx[mapID(i,j)] << ",";
+            buffer << _mtx[mapID(i,j)] << ",";
         }
-        os << _mtx[mapID(i,_dim_col-1)] << "\n";
-    }
+        buffer << _mtx[mapID(i,_dim_col-1)] << "\n";
+    });
 }
 
 //
@@ -395,6 +352,29 @@ Matrix<T>& Matrix<T>::operator= (Matrix<T> const& mtx)
     return *this;
 }
 
+template<class T>
+Matrix<T>& Matrix<T>::operator= (Matrix<T>&& mtx) noexcept
+{
+    if (this != &mtx)
+    {
+        clear();
+
+        _dim_row = mtx._dim_row;
+        _dim_col = mtx._dim_col;
+        _n = mtx._n;
+        _is_space = mtx._is_space;
+        _mtx = mtx._mtx;
+
+        mtx._dim_row = 0;
+        mtx._dim_col = 0;
+        mtx._n = 0;
+        mtx._is_space = 0;
+        mtx._mtx = nullptr;
+    }
+
+    return *this;
+}
+
 template<class T>
 bool Matrix<T>::operator== (Matrix<T> const& mtx1)
 {
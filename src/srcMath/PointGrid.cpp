@@ -0,0 +1,221 @@
+#include "PointGrid.h"
+
+void PointGrid::build (std::vector<Pt3D> const& pt_list, double cell_size)
+{
+    int n_pt = pt_list.size();
+    std::vector<double> xyz(3*n_pt);
+    for (int i = 0; i < n_pt; i ++)
+    {
+        xyz[3*i]   = pt_list[i][0];
+        xyz[3*i+1] = pt_list[i][1];
+        xyz[3*i+2] = pt_list[i][2];
+    }
+    buildXYZ(xyz, cell_size);
+}
+
+
+void PointGrid::buildXYZ (std::vector<double> const& xyz, double cell_size)
+{
+    if (cell_size <= 0 || !std::isfinite(cell_size))
+    {
+        std::cerr << "PointGrid::build error at line " << __LINE__ << ":\n"
+                  << "cell_size = " << cell_size << " should be positive."
+                  << std::endl;
+        throw error_range;
+    }
+
+    _xyz = xyz;
+    _n_pt = xyz.size() / 3;
+    _cell_size = cell_size;
+
+    // bounding box (non-finite coordinates are put into the border cells)
+    double pt_min[3] = {0, 0, 0};
+    double pt_max[3] = {0, 0, 0};
+    bool is_init[3] = {false, false, false};
+    for (int i = 0; i < _n_pt; i ++)
+    {
+        for (int k = 0; k < 3; k ++)
+        {
+            double x = _xyz[3*i+k];
+            if (!std::isfinite(x))
+            {
+                continue;
+            }
+            if (!is_init[k] || x < pt_min[k])
+            {
+                pt_min[k] = x;
+            }
+            if (!is_init[k] || x > pt_max[k])
+            {
+                pt_max[k] = x;
+            }
+            is_init[k] = true;
+        }
+    }
+
+    // cap the number of cells to keep memory O(n_pt)
+    double n_cell_max = std::max(4.0 * _n_pt, 64.0);
+    double n_cell_total;
+    while (true)
+    {
+        n_cell_total = 1;
+        for (int k = 0; k < 3; k ++)
+        {
+            n_cell_total *= std::floor((pt_max[k] - pt_min[k]) / _cell_size) + 1;
+        }
+        if (n_cell_total <= n_cell_max)
+        {
+            break;
+        }
+        _cell_size *= std::cbrt(n_cell_total / n_cell_max) * 1.01;
+    }
+
+    for (int k = 0; k < 3; k ++)
+    {
+        _origin[k] = pt_min[k];
+        _n_cell[k] = int(std::floor((pt_max[k] - pt_min[k]) / _cell_size)) + 1;
+    }
+    int n_cell = _n_cell[0] * _n_cell[1] * _n_cell[2];
+
+    // counting sort of point ids by cell, ids stay ascending in each cell
+    std::vector<int> cell_id(_n_pt);
+    _cell_start.assign(n_cell+1, 0);
+    for (int i = 0; i < _n_pt; i ++)
+    {
+        cell_id[i] = cellIndex(
+            cellCoord(_xyz[3*i], 0),
+            cellCoord(_xyz[3*i+1], 1),
+            cellCoord(_xyz[3*i+2], 2)
+        );
+        _cell_start[cell_id[i]+1] ++;
+    }
+    for (int c = 0; c < n_cell; c ++)
+    {
+        _cell_start[c+1] += _cell_start[c];
+    }
+
+    _id_list.resize(_n_pt);
+    std::vector<int> cell_fill(_cell_start.begin(), _cell_start.end()-1);
+    for (int i = 0; i < _n_pt; i ++)
+    {
+        _id_list[cell_fill[cell_id[i]] ++] = i;
+    }
+}
+
+
+int PointGrid::cellCoord (double x, int axis) const
+{
+    double coord = std::floor((x - _origin[axis]) / _cell_size);
+    if (!(coord > 0)) // also catches NaN
+    {
+        return 0;
+    }
+    if (coord > _n_cell[axis]-1)
+    {
+        return _n_cell[axis]-1;
+    }
+    return int(coord);
+}
+
+
+bool PointGrid::getCellRange (int* cell_min, int* cell_max, Pt3D const& pt, double radius) const
+{
+    if (_n_pt == 0)
+    {
+        return false;
+    }
+
+    for (int k = 0; k < 3; k ++)
+    {
+        double x_min = (pt[k] - radius - _origin[k]) / _cell_size;
+        double x_max = (pt[k] + radius - _origin[k]) / _cell_size;
+        if (!(x_max >= 0 && x_min < _n_cell[k]))
+        {
+            return false;
+        }
+        cell_min[k] = cellCoord(pt[k] - radius, k);
+        cell_max[k] = cellCoord(pt[k] + radius, k);
+    }
+    return true;
+}
+
+
+void PointGrid::findNeighbor (std::vector<int>& id_list, Pt3D const& pt, double radius) const
+{
+    id_list.clear();
+
+    int cell_min[3], cell_max[3];
+    if (!getCellRange(cell_min, cell_max, pt, radius))
+    {
+        return;
+    }
+
+    double radius2 = radius * radius;
+    for (int iz = cell_min[2]; iz <= cell_max[2]; iz ++)
+    {
+        for (int iy = cell_min[1]; iy <= cell_max[1]; iy ++)
+        {
+            for (int ix = cell_min[0]; ix <= cell_max[0]; ix ++)
+            {
+                int cell = cellIndex(ix, iy, iz);
+                for (int k = _cell_start[cell]; k < _cell_start[cell+1]; k ++)
+                {
+                    if (calDist2(_id_list[k], pt) < radius2)
+                    {
+                        id_list.push_back(_id_list[k]);
+                    }
+                }
+            }
+        }
+    }
+    std::sort(id_list.begin(), id_list.end());
+}
+
+
+int PointGrid::findRepeat (std::vector<int>& is_repeat, double tol_3d) const
+{
+    is_repeat.assign(_n_pt, 0);
+
+    // earlier neighbors of each point (parallel)
+    std::vector<std::vector<int>> prev_list(_n_pt);
+    #pragma omp parallel
+    {
+        std::vector<int> id_list;
+        Pt3D pt;
+
+        #pragma omp for
+        for (int j = 0; j < _n_pt; j ++)
+        {
+            pt[0] = _xyz[3*j];
+            pt[1] = _xyz[3*j+1];
+            pt[2] = _xyz[3*j+2];
+            findNeighbor(id_list, pt, tol_3d);
+
+            for (int i : id_list)
+            {
+                if (i >= j)
+                {
+                    break;
+                }
+                prev_list[j].push_back(i);
+            }
+        }
+    }
+
+    // resolve in index order: j is repeated if any earlier kept point is close
+    int n_repeat = 0;
+    for (int j = 0; j < _n_pt; j ++)
+    {
+        for (int i : prev_list[j])
+        {
+            if (!is_repeat[i])
+            {
+                is_repeat[j] = 1;
+                n_repeat ++;
+                break;
+            }
+        }
+    }
+
+    return n_repeat;
+}
@@ -0,0 +1,343 @@
+#include "TextIO.h"
+
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+TextBuffer::TextBuffer (std::ios_base const& os)
+{
+    _precision = os.precision();
+
+    std::ios_base::fmtflags floatfield = os.flags() & std::ios_base::floatfield;
+    if (floatfield == std::ios_base::fixed)
+    {
+        _fmt = std::chars_format::fixed;
+    }
+    else if (floatfield == std::ios_base::scientific)
+    {
+        _fmt = std::chars_format::scientific;
+    }
+    else if (floatfield == (std::ios_base::fixed | std::ios_base::scientific))
+    {
+        _fmt = std::chars_format::hex;
+    }
+    else
+    {
+        _fmt = std::chars_format::general;
+    }
+}
+
+
+TextBuffer& TextBuffer::operator<< (double x)
+{
+    char buf[64];
+    std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), x, _fmt, _precision);
+    if (res.ec == std::errc())
+    {
+        _str.append(buf, res.ptr);
+        return *this;
+    }
+
+    // long fixed format output
+    std::string buf_long(400 + _precision, '\0');
+    res = std::to_chars(buf_long.data(), buf_long.data() + buf_long.size(), x, _fmt, _precision);
+    _str.append(buf_long.data(), res.ptr);
+    return *this;
+}
+
+
+void readTextFile (std::string& text, std::string const& file)
+{
+    std::ifstream input(file, std::ios::in | std::ios::binary);
+    if (!input.is_open())
+    {
+        std::cerr << "readTextFile error at line " << __LINE__ << ":\n"
+                  << "Cannot open file: " << file << std::endl;
+        throw error_io;
+    }
+
+    input.seekg(0, std::ios::end);
+    std::streamoff n_byte = input.tellg();
+    input.seekg(0, std::ios::beg);
+
+    text.resize(n_byte);
+    input.read(text.data(), n_byte);
+    input.close();
+}
+
+
+// parse one row [ptr, end) into row[0:n_col], return number of parsed values
+static int parseRow (double* row, int n_col, char const* ptr, char const* end)
+{
+    int n_value = 0;
+    while (n_value < n_col)
+    {
+        // skip separators
+        while (ptr < end && (*ptr == ',' || *ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '+'))
+        {
+            ptr ++;
+        }
+        if (ptr >= end)
+        {
+            break;
+        }
+
+        double value;
+        std::from_chars_result res = std::from_chars(ptr, end, value);
+        if (res.ec != std::errc())
+        {
+            break;
+        }
+        row[n_value] = value;
+        n_value ++;
+        ptr = res.ptr;
+    }
+    return n_value;
+}
+
+static bool isBlankRow (char const* ptr, char const* end)
+{
+    for (; ptr < end; ptr ++)
+    {
+        if (*ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// position after the end of the row that contains pos
+static size_t nextRow (char const* text, size_t n_byte, size_t pos)
+{
+    void const* ptr_end = std::memchr(text + pos, '\n', n_byte - pos);
+    return ptr_end == nullptr ? n_byte : static_cast<char const*>(ptr_end) - text + 1;
+}
+
+
+static int parseText (std::vector<double>& data, int& n_col, char const* text, size_t n_byte, int n_skip_row)
+{
+    data.clear();
+
+    // skip header rows
+    size_t pos_start = 0;
+    for (int i = 0; i < n_skip_row && pos_start < n_byte; i ++)
+    {
+        pos_start = nextRow(text, n_byte, pos_start);
+    }
+
+    // number of columns from the first non-blank row
+    if (n_col <= 0)
+    {
+        n_col = 0;
+        size_t pos = pos_start;
+        while (pos < n_byte)
+        {
+            size_t pos_next = nextRow(text, n_byte, pos);
+            char const* row_start = text + pos;
+            char const* row_end = text + pos_next;
+            if (!isBlankRow(row_start, row_end))
+            {
+                std::vector<double> row(row_end - row_start);
+                n_col = parseRow(row.data(), row.size(), row_start, row_end);
+                break;
+            }
+            pos = pos_next;
+        }
+        if (n_col == 0)
+        {
+            return 0;
+        }
+    }
+
+    // split text into chunks on row boundaries
+    int n_chunk = std::max(1, std::min(4 * omp_get_max_threads(), int((n_byte - pos_start) / 65536) + 1));
+    std::vector<size_t> chunk_start(n_chunk+1, n_byte);
+    chunk_start[0] = pos_start;
+    for (int c = 1; c < n_chunk; c ++)
+    {
+        size_t pos = pos_start + (n_byte - pos_start) * c / n_chunk;
+        chunk_start[c] = std::max(chunk_start[c-1], pos == 0 ? 0 : nextRow(text, n_byte, pos-1));
+    }
+
+    // count rows of each chunk
+    std::vector<int> row_start(n_chunk+1, 0);
+    #pragma omp parallel for
+    for (int c = 0; c < n_chunk; c ++)
+    {
+        int n_row = 0;
+        size_t pos = chunk_start[c];
+        while (pos < chunk_start[c+1])
+        {
+            size_t pos_next = nextRow(text, n_byte, pos);
+            if (!isBlankRow(text + pos, text + pos_next))
+            {
+                n_row ++;
+            }
+            pos = pos_next;
+        }
+        row_start[c+1] = n_row;
+    }
+    for (int c = 0; c < n_chunk; c ++)
+    {
+        row_start[c+1] += row_start[c];
+    }
+
+    // parse rows
+    int n_row = row_start[n_chunk];
+    data.assign(size_t(n_row) * n_col, 0);
+
+    #pragma omp parallel for
+    for (int c = 0; c < n_chunk; c ++)
+    {
+        int row_id = row_start[c];
+        size_t pos = chunk_start[c];
+        while (pos < chunk_start[c+1])
+        {
+            size_t pos_next = nextRow(text, n_byte, pos);
+            char const* row_start_ptr = text + pos;
+            char const* row_end_ptr = text + pos_next;
+            if (!isBlankRow(row_start_ptr, row_end_ptr))
+            {
+                parseRow(data.data() + size_t(row_id) * n_col, n_col, row_start_ptr, row_end_ptr);
+                row_id ++;
+            }
+            pos = pos_next;
+        }
+    }
+
+    return n_row;
+}
+
+
+int parseCSV (std::vector<double>& data, int& n_col, std::string const& text, int n_skip_row)
+{
+    return parseText(data, n_col, text.data(), text.size(), n_skip_row);
+}
+
+
+int readCSV (std::vector<double>& data, int& n_col, std::string const& file, int n_skip_row)
+{
+    // an empty file cannot be mapped
+    std::error_code ec;
+    if (std::filesystem::exists(file, ec) && std::filesystem::file_size(file, ec) == 0 && !ec)
+    {
+        data.clear();
+        if (n_col <= 0)
+        {
+            n_col = 0;
+        }
+        return 0;
+    }
+
+    // the text stays in the page cache, only the parsed values are held in memory
+    MappedFile text(file);
+    return parseText(data, n_col, text.data(), text.size(), n_skip_row);
+}
+
+
+//////////////////////////////////////////////////
+// MappedFile
+//////////////////////////////////////////////////
+
+MappedFile::MappedFile (std::string const& file) : _file(file)
+{
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "MappedFile::MappedFile error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << file << std::endl;
+        throw error_io;
+    }
+    _file_handle = file_handle;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    _size = file_size.QuadPart;
+
+    if (_size > 0)
+    {
+        HANDLE map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (map_handle != NULL)
+        {
+            _map_handle = map_handle;
+            _data = static_cast<char const*>(MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+#else
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "MappedFile::MappedFile error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << file << std::endl;
+        throw error_io;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+    {
+        _size = st.st_size;
+    }
+
+    if (_size > 0)
+    {
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            _data = static_cast<char const*>(data);
+        }
+    }
+    ::close(fd);
+#endif
+
+    if (_data == nullptr)
+    {
+        unmap();
+        std::cerr << "MappedFile::MappedFile error at line " << __LINE__ << ":\n"
+                  << "Cannot map file " << file << std::endl;
+        throw error_io;
+    }
+}
+
+
+MappedFile::~MappedFile ()
+{
+    unmap();
+}
+
+
+void MappedFile::unmap ()
+{
+#ifdef _WIN32
+    if (_data != nullptr)
+    {
+        UnmapViewOfFile(_data);
+    }
+    if (_map_handle != nullptr)
+    {
+        CloseHandle(_map_handle);
+        _map_handle = nullptr;
+    }
+    if (_file_handle != nullptr)
+    {
+        CloseHandle(_file_handle);
+        _file_handle = nullptr;
+    }
+#else
+    if (_data != nullptr)
+    {
+        munmap(const_cast<char*>(_data), _size);
+    }
+#endif
+    _data = nullptr;
+}
@@ -83,7 +83,7 @@ void ObjectFinder2D::findTracer2D
 }
 
 void ObjectFinder2D::findTracer2D
-(std::vector<Tracer2D>& tr2d_list, Image const& img, double max_intensity, double min_intensity, double r_px, PixelRange const& region)
+(std::vector<Tracer2D>& tr2d_list, Image const& img, double max_intensity, double min_intensity, double r_px, PixelRange const& region, PixelMask const* mask)
 {
     // Check region
     if (region.row_min < 0 || region.row_max > img.getDimRow() || region.col_min < 0 || region.col_max > img.getDimCol())
@@ -94,15 +94,33 @@ void ObjectFinder2D::findTracer2D
                   << "The image size is (nRow,nCol) = (" << img.getDimRow() << "," << img.getDimCol() << ")." << std::endl;
         throw error_range;
     }
+    if (mask != nullptr && (mask->n_row != img.getDimRow() || mask->n_col != img.getDimCol()))
+    {
+        std::cerr << "ObjectFinder2D::findTracer2D error at line " << __LINE__ << ":"
+                  << "The mask size (" << mask->n_row << "," << mask->n_col << ") "
+                  << "is different from the image size (" << img.getDimRow() << "," << img.getDimCol() << ")." << std::endl;
+        throw error_size;
+    }
 
     // Judge whether a given point is local maximum intensity or not
     //  skip first and last rows and columns   
     Tracer2D tr2d;
     tr2d._r_px = r_px;
+    int col_end = region.col_max-1;
     for (int row = region.row_min+1; row < region.row_max-1; row ++)
     {
-        for (int col = region.col_min+1; col < region.col_max-1; col ++)
+        for (int col = region.col_min+1; col < col_end; col ++)
         {
+            // skip masked pixels
+            if (mask != nullptr)
+            {
+                col = mask->nextUnmasked(row, col, col_end);
+                if (col >= col_end)
+                {
+                    break;
+                }
+            }
+
             if (img(row, col) > max_intensity)
             {
                 // the intensity is out of range 
@@ -191,12 +209,12 @@ void ObjectFinder2D::findObject2D
 
 template<class T>
 void ObjectFinder2D::findObject2D
-(std::vector<T>& obj2d_list, Image const& img, std::vector<double> const& properties, PixelRange const& region)
+(std::vector<T>& obj2d_list, Image const& img, std::vector<double> const& properties, PixelRange const& region, PixelMask const* mask)
 {
     if (typeid(T) == typeid(Tracer2D))
     {
         obj2d_list.clear();
-        findTracer2D(obj2d_list, img, properties[0], properties[1], properties[2], region);
+        findTracer2D(obj2d_list, img, properties[0], properties[1], properties[2], region, mask);
     }
     else
     {
@@ -207,4 +225,63 @@ void ObjectFinder2D::findObject2D
     }
 }
 
+template<class T>
+void ObjectFinder2D::findMask
+(PixelMask& mask, std::vector<Image> const& img_list, std::vector<double> const& properties, double rate_max)
+{
+    if (img_list.size() == 0)
+    {
+        std::cerr << "ObjectFinder2D::findMask error at line " << __LINE__ << ":\n"
+                  << "No image is given." << std::endl;
+        throw error_size;
+    }
+
+    int n_row = img_list[0].getDimRow();
+    int n_col = img_list[0].getDimCol();
+    PixelRange region;
+    region.row_max = n_row;
+    region.col_max = n_col;
+
+    // number of images with a peak on or next to each pixel
+    //  img_last: last image counted on the pixel, two close peaks in one image count once
+    std::vector<int> n_peak(size_t(n_row) * n_col, 0);
+    std::vector<int> img_last(size_t(n_row) * n_col, -1);
+    std::vector<T> obj2d_list;
+    for (int i = 0; i < img_list.size(); i ++)
+    {
+        if (img_list[i].getDimRow() != n_row || img_list[i].getDimCol() != n_col)
+        {
+            std::cerr << "ObjectFinder2D::findMask error at line " << __LINE__ << ":\n"
+                      << "Image " << i << " has a different size." << std::endl;
+            throw error_size;
+        }
+
+        findObject2D(obj2d_list, img_list[i], properties, region);
+        for (int j = 0; j < obj2d_list.size(); j ++)
+        {
+            int row = std::round(obj2d_list[j]._pt_center[1]);
+            int col = std::round(obj2d_list[j]._pt_center[0]);
+            for (int row_k = std::max(0, row-1); row_k <= std::min(n_row-1, row+1); row_k ++)
+            {
+                for (int col_k = std::max(0, col-1); col_k <= std::min(n_col-1, col+1); col_k ++)
+                {
+                    size_t id = size_t(row_k) * n_col + col_k;
+                    if (img_last[id] != i)
+                    {
+                        img_last[id] = i;
+                        n_peak[id] ++;
+                    }
+                }
+            }
+        }
+    }
+
+    double n_max = rate_max * img_list.size();
+    mask.config(n_row, n_col);
+    for (size_t i = 0; i < n_peak.size(); i ++)
+    {
+        mask.data[i] = n_peak[i] > n_max;
+    }
+}
+
 #endif 
\ No newline at end of file
@@ -102,6 +102,13 @@ void Tracer3D::getTracer2D(Tracer2D& tracer2d, int cam_id)
 }
 
 void Tracer3D::saveObject3D(std::ofstream& output, int n_cam_all) const
+{
+    TextBuffer buffer(output);
+    saveObject3D(buffer, n_cam_all);
+    output << buffer._str;
+}
+
+void Tracer3D::saveObject3D(TextBuffer& output, int n_cam_all) const
 {
     output << _pt_center[0] << "," << _pt_center[1] << "," << _pt_center[2] << "," << _error << "," << _n_2d;
     
@@ -102,6 +102,13 @@ void Sphere::getCircle(Circle& circle, int cam_id)
 }
 
 void Sphere::saveObject3D(std::ofstream& output, int n_cam_all) const
+{
+    TextBuffer buffer(output);
+    saveObject3D(buffer, n_cam_all);
+    output << buffer._str;
+}
+
+void Sphere::saveObject3D(TextBuffer& output, int n_cam_all) const
 {
     // output: x, y, z, r_mm, error, n_2d, x1, y1, r1_px, x2, y2, r2_px, ...
     output << _pt_center[0] << "," << _pt_center[1] << "," << _pt_center[2] << ",";
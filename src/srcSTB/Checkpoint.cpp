@@ -0,0 +1,327 @@
+#include "Checkpoint.h"
+
+#include <filesystem>
+
+//////////////////////////////////////////////////
+// CheckpointWriter
+//////////////////////////////////////////////////
+
+CheckpointWriter::~CheckpointWriter ()
+{
+    // an unfinished checkpoint is never renamed
+    if (_output.is_open())
+    {
+        _output.close();
+        std::error_code ec;
+        std::filesystem::remove(_file + ".tmp", ec);
+    }
+}
+
+
+void CheckpointWriter::open (std::string const& file)
+{
+    if (_output.is_open())
+    {
+        close();
+    }
+
+    _file = file;
+    _output.open(_file + ".tmp", std::ios::out | std::ios::binary);
+    if (!_output.is_open())
+    {
+        std::cerr << "CheckpointWriter::open error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << _file << ".tmp" << std::endl;
+        throw error_io;
+    }
+
+    _buffer.clear();
+    _buffer.reserve(CHECKPOINT_BUFFER_SIZE);
+
+    char magic[8] = CHECKPOINT_MAGIC;
+    writeBytes(magic, 8);
+    write(uint32_t(CHECKPOINT_VERSION));
+}
+
+
+void CheckpointWriter::close ()
+{
+    if (!_output.is_open())
+    {
+        return;
+    }
+
+    char magic[8] = CHECKPOINT_MAGIC;
+    writeBytes(magic, 8);
+
+    _output.write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+    _output.close();
+    if (_output.fail())
+    {
+        std::cerr << "CheckpointWriter::close error at line " << __LINE__ << ":\n"
+                  << "Cannot write file " << _file << ".tmp" << std::endl;
+        throw error_io;
+    }
+
+    // rename replaces the previous checkpoint in one step
+    std::error_code ec;
+    std::filesystem::rename(_file + ".tmp", _file, ec);
+    if (ec)
+    {
+        std::cerr << "CheckpointWriter::close error at line " << __LINE__ << ":\n"
+                  << "Cannot rename " << _file << ".tmp: " << ec.message() << std::endl;
+        throw error_io;
+    }
+}
+
+
+void CheckpointWriter::writeBytes (void const* data, size_t n_byte)
+{
+    if (_buffer.size() + n_byte > CHECKPOINT_BUFFER_SIZE)
+    {
+        _output.write(_buffer.data(), _buffer.size());
+        _buffer.clear();
+    }
+
+    if (n_byte > CHECKPOINT_BUFFER_SIZE)
+    {
+        _output.write(static_cast<char const*>(data), n_byte);
+        return;
+    }
+
+    char const* ptr = static_cast<char const*>(data);
+    _buffer.insert(_buffer.end(), ptr, ptr + n_byte);
+}
+
+
+void CheckpointWriter::write (std::string const& x)
+{
+    write(uint64_t(x.size()));
+    writeBytes(x.data(), x.size());
+}
+
+
+void CheckpointWriter::write (Matrix<double> const& x)
+{
+    int n_row = x.getDimRow();
+    int n_col = x.getDimCol();
+    write(n_row);
+    write(n_col);
+    for (int i = 0; i < n_row; i ++)
+    {
+        for (int j = 0; j < n_col; j ++)
+        {
+            write(x(i,j));
+        }
+    }
+}
+
+
+void CheckpointWriter::write (AxisLimit const& x)
+{
+    write(x.x_min);
+    write(x.x_max);
+    write(x.y_min);
+    write(x.y_max);
+    write(x.z_min);
+    write(x.z_max);
+}
+
+
+void CheckpointWriter::write (OTFParam const& x)
+{
+    write(x.dx);
+    write(x.dy);
+    write(x.dz);
+    write(x.n_cam);
+    write(x.nx);
+    write(x.ny);
+    write(x.nz);
+    write(x.n_grid);
+    write(x.a);
+    write(x.b);
+    write(x.c);
+    write(x.alpha);
+    write(x.boundary);
+    write(x.grid_x);
+    write(x.grid_y);
+    write(x.grid_z);
+}
+
+
+void CheckpointWriter::write (Tracer2D const& x)
+{
+    write(x._pt_center[0]);
+    write(x._pt_center[1]);
+    write(x._r_px);
+}
+
+
+void CheckpointWriter::write (Tracer3D const& x)
+{
+    write(x._pt_center[0]);
+    write(x._pt_center[1]);
+    write(x._pt_center[2]);
+    write(x._is_tracked);
+    write(x._n_2d);
+    write(x._error);
+    write(x._r2d_px);
+    write(x._camid_list);
+    write(x._tr2d_list);
+}
+
+
+//////////////////////////////////////////////////
+// CheckpointReader
+//////////////////////////////////////////////////
+
+CheckpointReader::CheckpointReader (std::string const& file) : _file(file)
+{
+    readTextFile(_data, file);
+
+    char magic[8];
+    uint32_t version = 0;
+    if (_data.size() < 2*8 + sizeof(uint32_t))
+    {
+        std::cerr << "CheckpointReader::CheckpointReader error at line " << __LINE__ << ":\n"
+                  << file << " is not a checkpoint file." << std::endl;
+        throw error_io;
+    }
+    readBytes(magic, 8);
+    read(version);
+    if (std::strncmp(magic, CHECKPOINT_MAGIC, 8) != 0 || version != CHECKPOINT_VERSION)
+    {
+        std::cerr << "CheckpointReader::CheckpointReader error at line " << __LINE__ << ":\n"
+                  << file << " is not a checkpoint file of version " << CHECKPOINT_VERSION << "." << std::endl;
+        throw error_io;
+    }
+}
+
+
+void CheckpointReader::close ()
+{
+    char magic[8];
+    readBytes(magic, 8);
+    if (std::strncmp(magic, CHECKPOINT_MAGIC, 8) != 0 || _pos != _data.size())
+    {
+        std::cerr << "CheckpointReader::close error at line " << __LINE__ << ":\n"
+                  << "Corrupted checkpoint " << _file << std::endl;
+        throw error_io;
+    }
+
+    _data.clear();
+    _data.shrink_to_fit();
+    _pos = 0;
+}
+
+
+void CheckpointReader::readBytes (void* data, size_t n_byte)
+{
+    if (n_byte > _data.size() - _pos)
+    {
+        std::cerr << "CheckpointReader::readBytes error at line " << __LINE__ << ":\n"
+                  << "Unexpected end of checkpoint " << _file << std::endl;
+        throw error_io;
+    }
+
+    std::memcpy(data, _data.data() + _pos, n_byte);
+    _pos += n_byte;
+}
+
+
+size_t CheckpointReader::readSize (size_t n_byte_min)
+{
+    uint64_t n = 0;
+    read(n);
+    if (n > (_data.size() - _pos) / n_byte_min)
+    {
+        std::cerr << "CheckpointReader::readSize error at line " << __LINE__ << ":\n"
+                  << "Invalid size " << n << " in checkpoint " << _file << std::endl;
+        throw error_io;
+    }
+    return n;
+}
+
+
+void CheckpointReader::read (std::string& x)
+{
+    x.resize(readSize(1));
+    readBytes(x.data(), x.size());
+}
+
+
+void CheckpointReader::read (Matrix<double>& x)
+{
+    int n_row = 0, n_col = 0;
+    read(n_row);
+    read(n_col);
+    if (n_row < 0 || n_col < 0 || size_t(n_row) * n_col > (_data.size() - _pos) / sizeof(double))
+    {
+        std::cerr << "CheckpointReader::read error at line " << __LINE__ << ":\n"
+                  << "Invalid matrix size (" << n_row << "," << n_col << ") in checkpoint " << _file << std::endl;
+        throw error_io;
+    }
+
+    x = Matrix<double>(n_row, n_col, 0);
+    for (int i = 0; i < n_row; i ++)
+    {
+        for (int j = 0; j < n_col; j ++)
+        {
+            read(x(i,j));
+        }
+    }
+}
+
+
+void CheckpointReader::read (AxisLimit& x)
+{
+    read(x.x_min);
+    read(x.x_max);
+    read(x.y_min);
+    read(x.y_max);
+    read(x.z_min);
+    read(x.z_max);
+}
+
+
+void CheckpointReader::read (OTFParam& x)
+{
+    read(x.dx);
+    read(x.dy);
+    read(x.dz);
+    read(x.n_cam);
+    read(x.nx);
+    read(x.ny);
+    read(x.nz);
+    read(x.n_grid);
+    read(x.a);
+    read(x.b);
+    read(x.c);
+    read(x.alpha);
+    read(x.boundary);
+    read(x.grid_x);
+    read(x.grid_y);
+    read(x.grid_z);
+}
+
+
+void CheckpointReader::read (Tracer2D& x)
+{
+    read(x._pt_center[0]);
+    read(x._pt_center[1]);
+    read(x._r_px);
+}
+
+
+void CheckpointReader::read (Tracer3D& x)
+{
+    read(x._pt_center[0]);
+    read(x._pt_center[1]);
+    read(x._pt_center[2]);
+    read(x._is_tracked);
+    read(x._n_2d);
+    read(x._error);
+    read(x._r2d_px);
+    read(x._camid_list);
+    read(x._tr2d_list);
+}
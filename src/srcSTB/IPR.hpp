@@ -19,26 +19,10 @@ void IPR::runIPR(
     // reset cam id list
     resetCamIDList ();
 
-    // Initialize stereo match parameters
-    SMParam match_param;
-    match_param.tor_2d = _param.tol_2d;
-    match_param.tor_3d = _param.tol_3d;
-    match_param.n_thread = _param.n_thread;
-    match_param.check_id = _param.check_id < _n_cam_all ? _param.check_id : _n_cam_all;
-    match_param.check_radius = _param.check_radius;
-    match_param.is_delete_ghost = true;
-    match_param.is_update_inner_var = false;
-    StereoMatch stereo_match(match_param, _cam_list);
-
-    // Initialize shake parameters
-    Shake s (
-        _cam_list, 
-        _param.shake_width, 
-        _param.tol_3d * 3,
-        _param.ghost_threshold, 
-        _param.n_loop_shake, 
-        _param.n_thread
-    ); // gradient descent
+    // Stereo match and shake (gradient descent) kept across frames
+    IPRWorkspace& ws = getWorkspace();
+    StereoMatch& stereo_match = ws.stereo_match;
+    Shake& s = ws.shake;
 
 
     // Start IPR loop
@@ -51,7 +35,7 @@ void IPR::runIPR(
         for (int i = 0; i < _n_cam_all; i ++)
         {
             std::vector<Tracer2D> tr2d_list;
-            objfinder.findObject2D(tr2d_list, _imgRes_list[i], tr2d_properties);
+            objfinder.findObject2D(tr2d_list, _imgRes_list[i], tr2d_properties, _cam_list.getROI(i), _cam_list.getMask(i));
             std::cout << tr2d_list.size();
 
             // if tr2d_list is too large, randomly select some tracers
@@ -94,7 +78,7 @@ void IPR::runIPR(
             break;
         }
         t_start = clock();
-        s.runShake(tr3d_list, otf, _imgRes_list, _param.tri_only); // 0.25 vox, 1 vox = 0.04 mm
+        s.runShakeInPlace(tr3d_list, otf, _imgRes_list, _param.tri_only); // 0.25 vox, 1 vox = 0.04 mm
         t_end = clock();
         #ifdef DEBUG
         std::cout << "\tShake time = " 
@@ -103,20 +87,10 @@ void IPR::runIPR(
         #endif
 
         // Save tracer info after shaking
-        for (int i = tr3d_list.size()-1; i >= 0; i --)
-        {
-            if (s._is_ghost[i])
-            {
-                tr3d_list.erase(tr3d_list.begin()+i);
-            }
-        }
+        //  _imgRes_list has been updated in place
+        removeFlagged(tr3d_list, s._is_ghost);
         tr3d_list_all.insert(tr3d_list_all.end(), tr3d_list.begin(), tr3d_list.end());
 
-        // Update imgRes_list
-        // Note: s._imgRes_list in shake is the same size as n_cam_use, but _imgRes_list in IPR is the same size as _n_cam_all.
-        // Since there is no reduced camera here, s._imgRes_list is the same as _imgRes_list.
-        _imgRes_list = s._imgRes_list;
-
         std::cout << "  IPR step " << loop << ": find " << tr3d_list_all.size() << " particles. " << std::endl;
 
         if (tr3d_list.size() == 0)
@@ -174,28 +148,12 @@ void IPR::reducedCamLoop(std::vector<Tracer3D>& tr3d_list_all, std::vector<doubl
     ObjectFinder2D objfinder;
     int cam_id;
     int n_cam_use = cam_id_all[0].size();
-    _cam_list.useid_list.resize(n_cam_use);
+    _cam_list.useid_list = cam_id_all[0];
 
-    // Initialize stereo match parameters
-    SMParam match_param;
-    match_param.tor_2d = _param.tol_2d;
-    match_param.tor_3d = _param.tol_3d;
-    match_param.n_thread = _param.n_thread;
-    match_param.check_id = _param.check_id < n_cam_use ? _param.check_id : n_cam_use;
-    match_param.check_radius = _param.check_radius;
-    match_param.is_delete_ghost = true;
-    match_param.is_update_inner_var = false;
-    StereoMatch stereo_match(match_param, _cam_list);
-
-    // Initialize shake parameters
-    Shake s (
-        _cam_list, 
-        _param.shake_width, 
-        _param.tol_3d * 3,
-        _param.ghost_threshold, 
-        _param.n_loop_shake, 
-        _param.n_thread
-    );
+    // Stereo match and shake kept across frames
+    IPRWorkspace& ws = getWorkspace();
+    StereoMatch& stereo_match = ws.stereo_match;
+    Shake& s = ws.shake;
 
     for (int loop = 0; loop < n_loop; loop ++)
     {
@@ -211,7 +169,7 @@ void IPR::reducedCamLoop(std::vector<Tracer3D>& tr3d_list_all, std::vector<doubl
                 cam_id = _cam_list.useid_list[i];
 
                 std::vector<Tracer2D> tr2d_list;
-                objfinder.findObject2D(tr2d_list, _imgRes_list[cam_id], tr2d_properties);
+                objfinder.findObject2D(tr2d_list, _imgRes_list[cam_id], tr2d_properties, _cam_list.getROI(cam_id), _cam_list.getMask(cam_id));
 
                 std::cout << tr2d_list.size();
 
@@ -256,7 +214,7 @@ void IPR::reducedCamLoop(std::vector<Tracer3D>& tr3d_list_all, std::vector<doubl
                 break;
             }
             t_start = clock();
-            s.runShake(tr3d_list, otf, _imgRes_list, _param.tri_only); // 0.25 vox, 1 vox = 0.04 mm
+            s.runShakeInPlace(tr3d_list, otf, _imgRes_list, _param.tri_only); // 0.25 vox, 1 vox = 0.04 mm
             t_end = clock();
             #ifdef DEBUG
             std::cout << "\tShake time = " 
@@ -265,26 +223,11 @@ void IPR::reducedCamLoop(std::vector<Tracer3D>& tr3d_list_all, std::vector<doubl
             #endif
 
             // Save tracer info after shaking
-            for (int i = tr3d_list.size()-1; i >= 0; i --)
-            {
-                if (s._is_ghost[i])
-                {
-                    tr3d_list.erase(tr3d_list.begin()+i);
-                }
-            }
+            //  the images of the used cameras in _imgRes_list have been updated in place
+            removeFlagged(tr3d_list, s._is_ghost);
             tr3d_list_all.insert(tr3d_list_all.end(), tr3d_list.begin(), tr3d_list.end());
 
 
-            // Update imgRes_list
-            // Note: s._imgRes_list in shake is the same size as n_cam_use, but _imgRes_list in IPR is the same size as _n_cam_all
-            // Since there is reduced camera here, s._imgRes_list is not the same as _imgRes_list
-            for (int i = 0; i < n_cam_use; i ++)
-            {
-                cam_id = _cam_list.useid_list[i];
-                _imgRes_list[cam_id] = s._imgRes_list[i];
-            }
-
-
             std::cout << " IPR reduced camera step " << loop << ": find " << tr3d_list_all.size() << " particles. " << std::endl;
 
         }
@@ -323,6 +266,41 @@ void IPR::createCamID (std::deque<std::vector<int>>& cam_id_all, std::vector<int
 }
 
 
+IPRWorkspace& IPR::getWorkspace ()
+{
+    // rebuild all workspaces if the shake parameters have changed
+    bool is_changed = 
+        _ws_param.shake_width != _param.shake_width ||
+        _ws_param.tol_3d != _param.tol_3d ||
+        _ws_param.ghost_threshold != _param.ghost_threshold ||
+        _ws_param.n_loop_shake != _param.n_loop_shake ||
+        _ws_param.n_thread != _param.n_thread ||
+        _ws_param.shake_gauss_seidel != _param.shake_gauss_seidel ||
+        _ws_param.shake_tol_conv_pos != _param.shake_tol_conv_pos ||
+        _ws_param.shake_tol_conv_res != _param.shake_tol_conv_res;
+    if (is_changed)
+    {
+        _ws_map.clear();
+        _ws_param = _param;
+    }
+
+    // Initialize stereo match parameters
+    int n_cam_use = _cam_list.useid_list.size();
+    SMParam match_param;
+    match_param.tor_2d = _param.tol_2d;
+    match_param.tor_3d = _param.tol_3d;
+    match_param.n_thread = _param.n_thread;
+    match_param.check_id = _param.check_id < n_cam_use ? _param.check_id : n_cam_use;
+    match_param.check_radius = _param.check_radius;
+    match_param.is_delete_ghost = true;
+    match_param.is_update_inner_var = false;
+
+    IPRWorkspace& ws = _ws_map.try_emplace(n_cam_use, _cam_list, match_param, _param).first->second;
+    ws.stereo_match._param = match_param;
+    return ws;
+}
+
+
 void IPR::resetCamIDList ()
 {
     _cam_list.useid_list.resize(_n_cam_all);
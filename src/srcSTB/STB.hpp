@@ -119,7 +119,7 @@ void calibOTFParam (OTFParam& otf_param, int cam_id, double radius, std::vector<
 
 template<class T3D>
 STB<T3D>::STB(int frame_start, int frame_end, float fps, double vx_to_mm, int n_thread, std::string const& output_folder, CamList const& cam_list, AxisLimit const& axis_limit,  std::string const& file)
-    : _first(frame_start), _last(frame_end), _fps(fps), _vx_to_mm(vx_to_mm), _n_thread(n_thread), _output_folder(output_folder), _cam_list(cam_list), _n_cam_all(cam_list.cam_list.size()), _axis_limit(axis_limit)
+    : _first(frame_start), _last(frame_end), _fps(fps), _vx_to_mm(vx_to_mm), _n_thread(n_thread), _output_folder(output_folder), _cam_list(cam_list), _n_cam_all(cam_list.cam_list.size()), _axis_limit(axis_limit), _seg_first(frame_start)
 {
     // Create output folder
     createFolder(output_folder);
@@ -220,13 +220,64 @@ STB<T3D>::STB(int frame_start, int frame_end, float fps, double vx_to_mm, int n_
     // Load Object Info //
     loadObjParam(parsed);
 
+    // Load optional parameters //
+    // old config files end after object info, default values are kept
+    int shake_mode;
+    if (parsed >> shake_mode)
+    {
+        _ipr_param.shake_gauss_seidel = shake_mode == 1; // 0: Jacobi, 1: Gauss-Seidel
+    }
+    double tol_conv_pos, tol_conv_res;
+    if (parsed >> tol_conv_pos >> tol_conv_res)
+    {
+        _ipr_param.shake_tol_conv_pos = tol_conv_pos * _vx_to_mm; // [vox] -> [mm]
+        _ipr_param.shake_tol_conv_res = tol_conv_res;
+    }
+    int pred_mode;
+    if (parsed >> pred_mode)
+    {
+        if (pred_mode < PRED_WIENER || pred_mode > PRED_KALMAN)
+        {
+            std::cerr << "STB<T3D>::STB error at line" << __LINE__ << ":\n"
+                      << "Prediction mode " << pred_mode << " is out of range: 0 ~ " << PRED_KALMAN << std::endl;
+            throw error_range;
+        }
+        _pred_param.type = PredTypeID(pred_mode); // 0: Wiener, 1: polynomial, 2: Kalman
+    }
+    int track_format;
+    if (parsed >> track_format)
+    {
+        if (track_format < TRACK_CSV || track_format > TRACK_BIN)
+        {
+            std::cerr << "STB<T3D>::STB error at line" << __LINE__ << ":\n"
+                      << "Track format " << track_format << " is out of range: 0 ~ " << TRACK_BIN << std::endl;
+            throw error_range;
+        }
+        _track_format = TrackFormatID(track_format); // 0: csv, 1: binary (.lpt)
+    }
+    int checkpoint_interval;
+    if (parsed >> checkpoint_interval)
+    {
+        _checkpoint_interval = std::max(checkpoint_interval, 0); // [frame], 0: no checkpoint
+    }
+    int n_frame_parallel;
+    if (parsed >> n_frame_parallel)
+    {
+        _n_frame_parallel = std::max(n_frame_parallel, 0); // IPR only, 0: one frame per thread
+    }
+    int is_hindcast;
+    if (parsed >> is_hindcast)
+    {
+        _pred_param.is_hindcast = is_hindcast == 1; // 1: print the hindcast residual of the predictor
+    }
+
     std::cout << std::endl;
 }
 
 
 template<class T3D>
 STB<T3D>::STB(const STB& stb)
-    : _ipr_matched(stb._ipr_matched), _short_track_active(stb._short_track_active), _long_track_active(stb._long_track_active), _long_track_inactive(stb._long_track_inactive), _exit_track(stb._exit_track), _first(stb._first), _last(stb._last), _fps(stb._fps), _vx_to_mm(stb._vx_to_mm), _n_thread(stb._n_thread), _output_folder(stb._output_folder), _cam_list(stb._cam_list), _n_cam_all(stb._n_cam_all), _axis_limit(stb._axis_limit), _ipr_flag(stb._ipr_flag), _r_objSearch(stb._r_objSearch), _r_trackSearch(stb._r_trackSearch), _n_initPhase(stb._n_initPhase), _r_predSearch(stb._r_predSearch), _shake_width(stb._shake_width), _pf_param(stb._pf_param), _ipr_only(stb._ipr_only), _ipr_param(stb._ipr_param), _n_reduced(stb._n_reduced), _tol_2d_overlap(stb._tol_2d_overlap), _obj_param(stb._obj_param), _otf(stb._otf), _a_sa(stb._a_sa), _a_la(stb._a_la), _s_sa(stb._s_sa), _s_la(stb._s_la), _a_li(stb._a_li)
+    : _ipr_matched(stb._ipr_matched), _short_track_active(stb._short_track_active), _long_track_active(stb._long_track_active), _long_track_inactive(stb._long_track_inactive), _exit_track(stb._exit_track), _first(stb._first), _last(stb._last), _fps(stb._fps), _vx_to_mm(stb._vx_to_mm), _n_thread(stb._n_thread), _output_folder(stb._output_folder), _cam_list(stb._cam_list), _n_cam_all(stb._n_cam_all), _axis_limit(stb._axis_limit), _ipr_flag(stb._ipr_flag), _r_objSearch(stb._r_objSearch), _r_trackSearch(stb._r_trackSearch), _n_initPhase(stb._n_initPhase), _r_predSearch(stb._r_predSearch), _shake_width(stb._shake_width), _pf_param(stb._pf_param), _pred_param(stb._pred_param), _ipr_only(stb._ipr_only), _ipr_param(stb._ipr_param), _n_reduced(stb._n_reduced), _tol_2d_overlap(stb._tol_2d_overlap), _obj_param(stb._obj_param), _otf(stb._otf), _a_sa(stb._a_sa), _a_la(stb._a_la), _s_sa(stb._s_sa), _s_la(stb._s_la), _a_li(stb._a_li), _track_format(stb._track_format), _n_track_id(stb._n_track_id), _seg_first(stb._seg_first), _n_exit_saved(stb._n_exit_saved), _n_long_inactive_saved(stb._n_long_inactive_saved), _checkpoint_interval(stb._checkpoint_interval), _n_frame_parallel(stb._n_frame_parallel)
 {
     // Create output folder
     createFolder(_output_folder);
@@ -262,7 +313,7 @@ void STB<T3D>::calibrateOTF(int cam_id, int n_obj2d_max, double r_otf_calib, std
         for (int j = 0; j < img_list.size(); j ++)
         {
             std::vector<Tracer2D> tr2d_list;
-            objfinder.findObject2D(tr2d_list, img_list[j], _obj_param);
+            objfinder.findObject2D(tr2d_list, img_list[j], _obj_param, _cam_list.getROI(cam_id), _cam_list.getMask(cam_id));
 
             std::cout << tr2d_list.size();
 
@@ -298,6 +349,51 @@ void STB<T3D>::calibrateOTF(int cam_id, int n_obj2d_max, double r_otf_calib, std
 }
 
 
+template<class T3D>
+int STB<T3D>::findMask(int cam_id, double rate_max, std::vector<Image> const& img_list)
+{
+    if (cam_id < 0 || cam_id >= _n_cam_all)
+    {
+        std::cerr << "STB<T3D>::findMask error at line" << __LINE__ << ":\n"
+                  << "Camera ID " << cam_id << " is out of range: " << "0 ~ " << _n_cam_all-1 << std::endl;
+        throw error_range;
+    }
+
+    PixelMask mask;
+    ObjectFinder2D objfinder;
+    if (typeid(T3D) == typeid(Tracer3D))
+    {
+        objfinder.findMask<Tracer2D>(mask, img_list, _obj_param, rate_max);
+    }
+    else
+    {
+        std::cerr << "STB<T3D>::findMask error at line" << __LINE__ << ":\n"
+                  << "The type of object is not supported." << std::endl;
+        throw error_type;
+    }
+
+    // keep the pixels masked by the user
+    PixelMask const* mask_user = _cam_list.getMask(cam_id);
+    if (mask_user != nullptr)
+    {
+        if (mask_user->data.size() != mask.data.size())
+        {
+            std::cerr << "STB<T3D>::findMask error at line" << __LINE__ << ":\n"
+                      << "The mask of camera " << cam_id << " has a different size from the images." << std::endl;
+            throw error_size;
+        }
+        for (size_t i = 0; i < mask.data.size(); i ++)
+        {
+            mask.data[i] |= mask_user->data[i];
+        }
+    }
+
+    _cam_list.mask_list.resize(_n_cam_all);
+    _cam_list.mask_list[cam_id] = std::move(mask);
+    return _cam_list.mask_list[cam_id].getNumOfMasked();
+}
+
+
 template<class T3D>
 void STB<T3D>::processFrame (int frame_id, std::vector<Image>& img_list, bool is_update_img)
 {
@@ -326,6 +422,11 @@ void STB<T3D>::processFrame (int frame_id, std::vector<Image>& img_list, bool is
         runConvPhase(frame_id, img_list, is_update_img);
     }
 
+    if (_checkpoint_interval > 0 && frame_id != _last && (frame_id - _first + 1) % _checkpoint_interval == 0)
+    {
+        saveCheckpoint(getCheckpointFile(), frame_id);
+    }
+
     t_end = clock();
     std::cout << "Total time for frame " << frame_id << ": " << (double) (t_end - t_start)/CLOCKS_PER_SEC << std::endl;
     std::cout << std::endl;
@@ -338,13 +439,149 @@ void STB<T3D>::processFrame (int frame_id, std::vector<Image>& img_list, bool is
 
         std::cout << "Output folder: " << _output_folder << std::endl;
 
+        // write the remaining finished tracks and wait for the writers
+        flushTracks();
+        closeTrackWriters(frame_id);
+
         std::cout << "Number of active short tracks: " << _short_track_active.size() << std::endl;
         std::cout << "Number of active long tracks: " << _long_track_active.size() << std::endl;
-        std::cout << "Number of inactive long tracks: " << _long_track_inactive.size() << std::endl;
-        std::cout << "Number of exited tracks: " << _exit_track.size() << std::endl;
+        std::cout << "Number of inactive long tracks: " << getNumOfLongInactiveTrack() << std::endl;
+        std::cout << "Number of exited tracks: " << getNumOfExitTrack() << std::endl;
+
+        // finished tracks are already streamed to ExitTrack_* and LongTrackInactive_*
+        std::string s = std::to_string(frame_id);
+        saveTracks(_output_folder + "LongTrackActive_" + s + getTrackExt(), _long_track_active);
+        saveTracks(_output_folder + "ShortTrackActive_" + s + getTrackExt(), _short_track_active);
+
+        // a finished run is not resumed
+        if (_checkpoint_interval > 0)
+        {
+            std::error_code ec;
+            fs::remove(getCheckpointFile(), ec);
+        }
+    }
+}
+
+
+template<class T3D>
+int STB<T3D>::getNumOfFrameParallel () const
+{
+    int n_thread = _n_thread > 0 ? _n_thread : omp_get_max_threads();
+    return _n_frame_parallel > 0 ? _n_frame_parallel : std::max(n_thread, 1);
+}
+
+
+template<class T3D>
+void STB<T3D>::runIPROnly (FrameLoader& frame_loader, int frame_start, int frame_end)
+{
+    if (!_ipr_only || !_ipr_flag)
+    {
+        std::cerr << "STB<T3D>::runIPROnly error at line " << __LINE__ << ":\n"
+                  << "runIPROnly requires IPR only (option 2) with IPR enabled." << std::endl;
+        throw error_type;
+    }
+    frame_start = std::max(frame_start, _first);
+    frame_end = std::min(frame_end, _last);
+    if (frame_start > frame_end)
+    {
+        return;
+    }
+
+    // threads are shared among the frames, the first ones get the remainder
+    int n_thread = _n_thread > 0 ? _n_thread : omp_get_max_threads();
+    int n_worker = std::min(getNumOfFrameParallel(), frame_end - frame_start + 1);
+    std::cout << "IPR only on frames " << frame_start << " to " << frame_end << ": " 
+              << n_worker << " frames in parallel" << std::endl;
+
+    std::string address = _output_folder + "InitialTrack/";
+    double t_start = omp_get_wtime();
+
+    std::mutex load_mutex; // next frame and first error
+    std::mutex save_mutex; // finished frames, written in frame order
+    int frame_next = frame_start;
+    int frame_save = frame_start;
+    std::map<int, std::vector<T3D>> done_list;
+    std::exception_ptr error = nullptr;
+    bool is_error = false;
+
+    auto worker = [&] (int worker_id)
+    {
+        try
+        {
+            // own camera list (IPR changes useid_list) and workspaces
+            CamList cam_list = _cam_list;
+            IPRParam ipr_param = _ipr_param;
+            ipr_param.n_thread = std::max(n_thread / n_worker + (worker_id < n_thread % n_worker), 1);
+            IPR ipr(cam_list, ipr_param);
+
+            while (true)
+            {
+                int frame;
+                {
+                    std::lock_guard<std::mutex> lock(load_mutex);
+                    if (is_error || frame_next > frame_end)
+                    {
+                        break;
+                    }
+                    frame = frame_next;
+                    frame_next ++;
+                }
+                // the workers wait for their frames together, the loader prefetches ahead of the first one
+                frame_loader.getFrame(frame, ipr._imgRes_list);
+
+                std::vector<T3D> obj3d_list;
+                ipr.runIPR(obj3d_list, _obj_param, _otf, _n_reduced);
+
+                std::lock_guard<std::mutex> lock(save_mutex);
+                done_list[frame] = std::move(obj3d_list);
+                auto it = done_list.find(frame_save);
+                while (it != done_list.end())
+                {
+                    ipr.saveObjInfo(address + "IPR_" + std::to_string(frame_save) + ".csv", it->second);
+                    std::cout << "IPR at frame " << frame_save << ": " << it->second.size() << " objects" << std::endl;
+
+                    done_list.erase(it);
+                    frame_save ++;
+                    it = done_list.find(frame_save);
+                }
+            }
+        }
+        catch (...)
+        {
+            // the other workers finish their current frame and stop
+            std::lock_guard<std::mutex> lock(load_mutex);
+            if (!is_error)
+            {
+                error = std::current_exception();
+                is_error = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> thread_list;
+    for (int i = 1; i < n_worker; i ++)
+    {
+        thread_list.push_back(std::thread(worker, i));
+    }
+    worker(0);
+    for (std::thread& t : thread_list)
+    {
+        t.join();
+    }
 
-        saveTracksAll(_output_folder, frame_id);
+    if (error)
+    {
+        std::rethrow_exception(error);
     }
+
+    // no tracking in IPR only, the track files are written as by the initial phase
+    saveTracksAll(address, frame_end);
+
+    std::cout << "Finish IPR only!" << std::endl;
+    std::cout << "Frame start: " << frame_start << "; Frame end: " << frame_end << std::endl;
+    std::cout << "Total time for IPR only: " << omp_get_wtime() - t_start << "s" << std::endl;
+    std::cout << "Output folder: " << address << std::endl;
+    std::cout << std::endl;
 }
 
 
@@ -389,22 +626,54 @@ void STB<T3D>::loadObjParam (std::stringstream& config)
 }
 
 
+template<class T3D>
+IPR& STB<T3D>::getIPR ()
+{
+    if (!_ipr_ws)
+    {
+        _ipr_ws = std::make_unique<IPR>(_cam_list, _ipr_param);
+    }
+    return *_ipr_ws;
+}
+
+
+template<class T3D>
+Shake& STB<T3D>::getShakePred ()
+{
+    if (!_shake_ws)
+    {
+        _shake_ws = std::make_unique<Shake>(
+            _cam_list, 
+            _shake_width,
+            _ipr_param.tol_3d * 2, 
+            _ipr_param.ghost_threshold, //0.01, 
+            _ipr_param.n_loop_shake, 
+            _n_thread,
+            _ipr_param.shake_gauss_seidel,
+            _ipr_param.shake_tol_conv_pos,
+            _ipr_param.shake_tol_conv_res
+        );
+    }
+    return *_shake_ws;
+}
+
+
 template<class T3D>
 void STB<T3D>::runInitPhase (int frame, std::vector<Image>& img_list, bool is_update_img)
 {
-    // Initialize IPR
-    IPR ipr(_cam_list, img_list, _ipr_param);
     std::vector<T3D> obj3d_list;
     _ipr_matched.push_back(obj3d_list);
 
     if (_ipr_flag)
     {
-        // IPR
+        // IPR, the images are copied into the buffers of the IPR workspace
+        IPR& ipr = getIPR();
+        ipr._imgRes_list = img_list;
         ipr.runIPR(_ipr_matched.back(), _obj_param, _otf, _n_reduced);
 
         if (is_update_img)
         {
-            img_list = ipr._imgRes_list;
+            img_list.swap(ipr._imgRes_list);
         }
     }
     else
@@ -443,6 +712,9 @@ void STB<T3D>::runInitPhase (int frame, std::vector<Image>& img_list, bool is_up
                 clock_t t_start, t_end;
                 t_start = clock();
 
+                // index the candidates in the next frame
+                PointGrid grid(_ipr_matched[i+1], _r_objSearch);
+
                 // extend all the tracks that are active in current frame
                 int n_sa = _short_track_active.size();
                 std::vector<int> link_id(n_sa, UNLINKED);
@@ -456,10 +728,11 @@ void STB<T3D>::runInitPhase (int frame, std::vector<Image>& img_list, bool is_up
                 {
                     Pt3D vel_curr;
                     pf.getDisp(vel_curr, _short_track_active[j]._obj3d_list.back()._pt_center);
-                    link_id[j] = makeLink(_short_track_active[j], nextframe, vel_curr, _r_objSearch);
+                    link_id[j] = makeLink(_short_track_active[j], nextframe, vel_curr, _r_objSearch, grid);
                 }
 
                 // update short track and _is_tracked status for the next frame
+                std::vector<int> is_remove(n_sa, 0);
                 for (int j = n_sa-1; j > -1; j --)
                 {
                     if (link_id[j] != UNLINKED)
@@ -469,13 +742,14 @@ void STB<T3D>::runInitPhase (int frame, std::vector<Image>& img_list, bool is_up
                     }
                     else
                     {
-                        _short_track_active.erase(_short_track_active.begin()+j);
+                        is_remove[j] = 1;
                     }
                 }
+                removeFlagged(_short_track_active, is_remove);
 
 
                 // Start a track for all particles left untracked in current frame
-                startTrack(currframe, pf);
+                startTrack(currframe, pf, grid);
 
 
                 t_end = clock();
@@ -485,18 +759,17 @@ void STB<T3D>::runInitPhase (int frame, std::vector<Image>& img_list, bool is_up
             }
 
             // Move all tracks >= _n_initPhase from _short_track_active to _long_track_active
-            for (typename std::deque<Track<T3D>>::iterator track = _short_track_active.begin(); track != _short_track_active.end();)
+            std::vector<int> is_long(_short_track_active.size(), 0);
+            for (int j = 0; j < _short_track_active.size(); j ++)
             {
-                if (track->_obj3d_list.size() >= _n_initPhase)
-                {
-                    _long_track_active.push_back(*track);
-                    track = _short_track_active.erase(track);
-                }
-                else
+                if (_short_track_active[j]._n_obj3d >= _n_initPhase)
                 {
-                    ++ track;
+                    _short_track_active[j]._track_id = _n_track_id ++;
+                    _long_track_active.push_back(std::move(_short_track_active[j]));
+                    is_long[j] = 1;
                 }
             }
+            removeFlagged(_short_track_active, is_long);
 
             // Add the untracked particles at the last initial phase frame (_first+_n_initPhase-1) to _short_track_active
             int m = _n_initPhase - 1;
@@ -524,7 +797,7 @@ void STB<T3D>::runInitPhase (int frame, std::vector<Image>& img_list, bool is_up
         {
             for (int i = 0; i < _n_initPhase; i ++)
             {
-                ipr.saveObjInfo(address + "IPR_" + std::to_string(_first+i) + ".csv", _ipr_matched[i]);
+                getIPR().saveObjInfo(address + "IPR_" + std::to_string(_first+i) + ".csv", _ipr_matched[i]);
             }
         }
         // _ipr_matched.clear();
@@ -542,7 +815,7 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
     // Initialize some variables
     int n_sa = _short_track_active.size();
     int n_la = _long_track_active.size();
-    int n_li = _long_track_inactive.size();
+    int n_li = getNumOfLongInactiveTrack() + _long_track_inactive.size();
     _a_sa = 0; _a_la = 0; _s_sa = 0; _s_la = 0; _a_li = 0;
 
 
@@ -558,10 +831,13 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
     {
         omp_set_num_threads(_n_thread);
     }
+    // the hindcast residual costs a second prediction, off by default
+    TrackPredictor<T3D> predictor(_pred_param);
+    predictor.predict(obj3d_list_pred, _long_track_active, _pred_param.is_hindcast);
+
     #pragma omp parallel for
     for (int i = 0; i < n_la; i ++)
     {
-        _long_track_active[i].predictNext(obj3d_list_pred[i]);
         is_inRange[i] = _axis_limit.check(
             obj3d_list_pred[i]._pt_center[0], 
             obj3d_list_pred[i]._pt_center[1], 
@@ -583,20 +859,23 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
     }
 
     // Remove out-of-range tracks
+    //  tracks are flagged first and both lists are compacted once
+    std::vector<int> is_remove(n_la, 0);
     for (int i = n_la-1; i >= 0; i --)
     {
         if (!is_inRange[i])
         {
             if (_long_track_active[i]._n_obj3d >= LEN_LONG_TRACK)
             {
-                _exit_track.push_back(_long_track_active[i]);
+                _exit_track.push_back(std::move(_long_track_active[i]));
             }
             
-            _long_track_active.erase(_long_track_active.begin()+i);
-            obj3d_list_pred.erase(obj3d_list_pred.begin()+i);
+            is_remove[i] = 1;
             _s_la ++;
         }
     }
+    removeFlagged(_long_track_active, is_remove);
+    removeFlagged(obj3d_list_pred, is_remove);
 
     // Remove repeated prediction
     int n_pred = obj3d_list_pred.size();
@@ -612,28 +891,26 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
         {
             if (_long_track_active[i]._n_obj3d >= LEN_LONG_TRACK)
             {
-                _long_track_inactive.push_back(_long_track_active[i]);
+                _long_track_inactive.push_back(std::move(_long_track_active[i]));
             }
 
-            _long_track_active.erase(_long_track_active.begin()+i);
-            obj3d_list_pred.erase(obj3d_list_pred.begin()+i);
             _s_la ++;
         }
     }
+    removeFlagged(_long_track_active, is_repeat);
+    removeFlagged(obj3d_list_pred, is_repeat);
 
     t_end = clock();
     std::cout << (double) (t_end - t_start)/CLOCKS_PER_SEC << " s. Done!" << std::endl;
+    if (_pred_param.is_hindcast)
+    {
+        std::cout << "\tHindcast residual: mean = " << predictor._stats.mean 
+                  << ", rms = " << predictor._stats.rms << " [mm]" << std::endl;
+    }
 
     // Shake prediction
     int n_fail_shaking = 0;
-    Shake s (
-        _cam_list, 
-        _shake_width,
-        _ipr_param.tol_3d * 2, 
-        _ipr_param.ghost_threshold, //0.01, 
-        _ipr_param.n_loop_shake, 
-        _n_thread
-    );
+    Shake& s = getShakePred();
 
     if (obj3d_list_pred.size() > 0)
     {
@@ -659,25 +936,36 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
 
                 if (_long_track_active[i]._n_obj3d >= LEN_LONG_TRACK)
                 {
-                    _long_track_inactive.push_back(_long_track_active[i]);
+                    _long_track_inactive.push_back(std::move(_long_track_active[i]));
                     _a_li ++;
                 }
 
-                _long_track_active.erase(_long_track_active.begin()+i);
                 _s_la ++;
             }
         }
+        removeFlagged(_long_track_active, s._is_ghost);
 
         std::cout << "Finish updating active long tracks!" << std::endl;
     }
-    else 
-    {
-        s._imgRes_list = img_list;
-    }
 
 
     // IPR on residue images //
-    IPR ipr(_cam_list, s._imgRes_list, _ipr_param);
+    //  the residue images are handed over, IPR updates them in place
+    //  the shake keeps the previous IPR buffers for the next frame
+    //  with is_update_img the prediction residue is kept to render the updated images
+    IPR& ipr = getIPR();
+    if (obj3d_list_pred.size() > 0 && !is_update_img)
+    {
+        ipr._imgRes_list.swap(s._imgRes_list);
+    }
+    else if (obj3d_list_pred.size() > 0)
+    {
+        ipr._imgRes_list = s._imgRes_list;
+    }
+    else 
+    {
+        ipr._imgRes_list = img_list;
+    }
     std::vector<T3D> obj3d_list;
     ipr.runIPR(obj3d_list, _obj_param, _otf, _n_reduced);
 
@@ -685,6 +973,8 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
     removeOverlap(obj3d_list);
 
     // update img_list
+    //  only the kept particles are removed from the prediction residue, 
+    //  the IPR residue also lacks the overlaps and the ghosts of the reduced-camera loops
     if (is_update_img)
     {
         Shake s_resImg (
@@ -696,8 +986,8 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
             _n_thread
         );
         
-        s_resImg.runShake(obj3d_list, _otf, s._imgRes_list, true);
-        img_list = s_resImg._imgRes_list;
+        s_resImg.runShake(obj3d_list, _otf, obj3d_list_pred.size() > 0 ? s._imgRes_list : img_list, true);
+        img_list.swap(s_resImg._imgRes_list);
     }
 
     // Link each _short_track_active to an obj 
@@ -709,6 +999,16 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
 
         std::vector<int> link_id(n_sa, 0);
         std::vector<int> is_obj_used(n_obj3d, 0);
+        PointGrid grid(obj3d_list, _r_objSearch);
+
+        // index the long tracks by their position in the previous frame
+        std::vector<Pt3D> anchor_list(_long_track_active.size());
+        for (int i = 0; i < _long_track_active.size(); i ++)
+        {
+            int len = _long_track_active[i]._obj3d_list.size();
+            anchor_list[i] = _long_track_active[i]._obj3d_list[len-2]._pt_center;
+        }
+        PointGrid grid_track(anchor_list, 3 * _r_trackSearch);
 
         if (_n_thread>0)
         {
@@ -717,36 +1017,35 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
         #pragma omp parallel for
         for (int i = 0; i < n_sa; i ++)
         {
-            link_id[i] = linkShortTrack (_short_track_active[i], obj3d_list, 5);
+            link_id[i] = linkShortTrack (_short_track_active[i], obj3d_list, grid, grid_track, 5);
         }
 
         // update _short_track_active and _is_tracked status 
+        // move all active short tracks to long tracks if they have >= _n_initPhase particles
+        std::vector<int> is_remove_short(n_sa, 0);
         for (int i = n_sa-1; i >= 0; i --)
         {
             if (link_id[i] != UNLINKED)
             {
                 _short_track_active[i].addNext(obj3d_list[link_id[i]], frame);
                 obj3d_list[link_id[i]]._is_tracked = true;
+
+                if (_short_track_active[i]._n_obj3d >= _n_initPhase)
+                {
+                    _short_track_active[i]._track_id = _n_track_id ++;
+                    _long_track_active.push_back(std::move(_short_track_active[i]));
+                    is_remove_short[i] = 1;
+                    _a_la ++;
+                    _s_sa ++;
+                }
             }
             else
             {
-                _short_track_active.erase(_short_track_active.begin()+i);
-                _s_sa ++;
-            }
-        }
-
-        // move all active short tracks to long tracks if they have >= _n_initPhase particles
-        int n_short_track_active = _short_track_active.size();
-        for (int i = n_short_track_active-1; i >= 0; i --)
-        {
-            if (_short_track_active[i]._n_obj3d >= _n_initPhase)
-            {
-                _long_track_active.push_back(_short_track_active[i]);
-                _short_track_active.erase(_short_track_active.begin()+i);
-                _a_la ++;
+                is_remove_short[i] = 1;
                 _s_sa ++;
             }
         }
+        removeFlagged(_short_track_active, is_remove_short);
 
         // add all the untracked candidates to a new short track
         for (int i = 0; i < n_obj3d; i ++)
@@ -792,17 +1091,17 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
         {
             if (is_erase[i])
             {
-                if (_long_track_active[i]._obj3d_list.size() >= LEN_LONG_TRACK)
+                if (_long_track_active[i]._n_obj3d >= LEN_LONG_TRACK)
                 {
-                    _long_track_inactive.push_back(_long_track_active[i]);
+                    _long_track_inactive.push_back(std::move(_long_track_active[i]));
                     _a_li ++;
                 }
 
-                _long_track_active.erase(_long_track_active.begin()+i);
                 _s_la ++;
                 n_fail_lf ++;
             }
         }
+        removeFlagged(_long_track_active, is_erase);
 
         t_end = clock();
 
@@ -815,19 +1114,23 @@ void STB<T3D>::runConvPhase (int frame, std::vector<Image>& img_list, bool is_up
 
     std::cout << "\tNo. of active long tracks: " << n_la << " + " << _a_la << " - " << _s_la << " = " << _long_track_active.size() << std::endl;
     
-    std::cout << "\tNo. of exited tracks: " << _exit_track.size() << std::endl;
+    // hand finished tracks to the background writers
+    flushTracks();
 
-    std::cout << "\tNo. of inactive Long tracks: " << n_li << " + " << _a_li << " = " << _long_track_inactive.size() << std::endl;
+    std::cout << "\tNo. of exited tracks: " << getNumOfExitTrack() << std::endl;
+
+    std::cout << "\tNo. of inactive Long tracks: " << n_li << " + " << _a_li << " = " << getNumOfLongInactiveTrack() << std::endl;
 
     std::cout << "\tNo. of fail shaking intensity: " << n_fail_shaking << std::endl;
     std::cout << "\tNo. of fail linear fit: " << n_fail_lf << std::endl;
 
-    // save all data every 500 frames
-    if (frame%500 == 0)
+    // without checkpoints, save the active tracks every 500 frames, so a crash does not lose all of them
+    //  finished tracks are already streamed to disk
+    if (_checkpoint_interval == 0 && frame % 500 == 0)
     {
-        saveTracksAll(_output_folder+"ConvergeTrack/", frame);
-        _long_track_inactive.clear();
-        _exit_track.clear();
+        std::string s = std::to_string(frame);
+        saveTracks(_output_folder + "ConvergeTrack/LongTrackActive_" + s + getTrackExt(), _long_track_active);
+        saveTracks(_output_folder + "ConvergeTrack/ShortTrackActive_" + s + getTrackExt(), _short_track_active);
     }
 }
 
@@ -859,10 +1162,42 @@ void STB<T3D>::removeOverlapTracer(std::vector<Tracer3D>& obj3d_list)
 
     std::vector<int> is_overlap(n_obj3d, 0);
 
+    // bucket the 2D projections of the long track heads in each camera
+    //  (z = 0, the radius covers the square window of _tol_2d_overlap)
+    int n_la = _long_track_active.size();
+    double r_search = _tol_2d_overlap * std::sqrt(2.0) * 1.01 + SMALLNUMBER;
+    std::vector<PointGrid> grid_list(_n_cam_all);
+    std::vector<Pt3D> head_list(n_la);
+    for (int cam_id = 0; cam_id < _n_cam_all; cam_id ++)
+    {
+        for (int j = 0; j < n_la; j ++)
+        {
+            Pt2D const& pt2d = _long_track_active[j]._obj3d_list.back()._tr2d_list[cam_id]._pt_center;
+            head_list[j] = Pt3D(pt2d[0], pt2d[1], 0);
+        }
+        grid_list[cam_id].build(head_list, r_search);
+    }
+
     #pragma omp parallel for
     for (int i = 0; i < n_obj3d; i ++)
     {
-        for (int j = 0; j < _long_track_active.size(); j ++)
+        // candidates from the camera with the fewest nearby heads
+        std::vector<int> cand_list, id_list;
+        for (int cam_id = 0; cam_id < _n_cam_all; cam_id ++)
+        {
+            Pt2D const& pt2d = obj3d_list[i]._tr2d_list[cam_id]._pt_center;
+            grid_list[cam_id].findNeighbor(id_list, Pt3D(pt2d[0], pt2d[1], 0), r_search);
+            if (cam_id == 0 || id_list.size() < cand_list.size())
+            {
+                cand_list.swap(id_list);
+            }
+            if (cand_list.empty())
+            {
+                break;
+            }
+        }
+
+        for (int j : cand_list)
         {
             int length = _long_track_active[j]._obj3d_list.size();
             int n_overlap = 0;
@@ -886,13 +1221,7 @@ void STB<T3D>::removeOverlapTracer(std::vector<Tracer3D>& obj3d_list)
         }
     }
 
-    for (int i = n_obj3d-1; i >= 0; i --)
-    {
-        if (is_overlap[i])
-        {
-            obj3d_list.erase(obj3d_list.begin()+i);
-        }
-    }
+    removeFlagged(obj3d_list, is_overlap);
 
     // std::cout << "debug:STB::removeOverlapTracer: " << n_obj3d << " -> " << obj3d_list.size() << std::endl;
 }
@@ -901,80 +1230,46 @@ void STB<T3D>::removeOverlapTracer(std::vector<Tracer3D>& obj3d_list)
 template<class T3D>
 void STB<T3D>::findRepeatObj(std::vector<int>& is_repeat, std::vector<T3D> const& obj3d_list, double tol_3d)
 {
-    int n_obj = obj3d_list.size();
-    
-    if (is_repeat.size() != n_obj)
-    {
-        is_repeat.resize(n_obj);
-    }
-    std::fill(is_repeat.begin(), is_repeat.end(), 0);
-
     if (_n_thread > 0)
     {
         omp_set_num_threads(_n_thread);
     }
 
-    double repeat_thres_2 = tol_3d * tol_3d;
-    for (int i = 0; i < n_obj-1; i ++)
-    {
-        if (is_repeat[i])
-        {
-            continue;
-        }
-
-        #pragma omp parallel for
-        for (int j = i+1; j < n_obj; j ++)
-        {
-            if (myMATH::dist2(obj3d_list[i]._pt_center, obj3d_list[j]._pt_center) < repeat_thres_2)
-            {
-                is_repeat[j] = 1;
-            }
-        }
-    }
+    // first index wins: obj j is repeated if an earlier kept obj is within tol_3d
+    PointGrid grid;
+    grid.build(obj3d_list, tol_3d);
+    grid.findRepeat(is_repeat, tol_3d);
 }
 
 
 // TODO: I donot update _is_tracked on the fly (to avoid conflict during parallelization), not sure whether this will affect the result
 // Note: I still update the _is_track status after makeLink, but set all possible links to be true
 template<class T3D>
-int STB<T3D>::makeLink(Track<T3D> const& track, int nextframe, Pt3D const& vel_curr, double radius)
+int STB<T3D>::makeLink(Track<T3D> const& track, int nextframe, Pt3D const& vel_curr, double radius, PointGrid const& grid)
 {
     int m = nextframe-_first;
 
-    int obj3d_id = findNN(_ipr_matched[m], track._obj3d_list.back()._pt_center+vel_curr, radius);
+    int obj3d_id = findNN(_ipr_matched[m], grid, track._obj3d_list.back()._pt_center+vel_curr, radius);
 
     return obj3d_id;
 }
 
 
 template<class T3D>
-int STB<T3D>::findNN(std::vector<T3D> const& obj3d_list, Pt3D const& pt3d_est, double radius)
+int STB<T3D>::findNN(std::vector<T3D> const& obj3d_list, PointGrid const& grid, Pt3D const& pt3d_est, double radius)
 {
-    double min_dist2 = radius*radius;
-    int obj_id = UNLINKED;
-
-    double dist2;
-    for (int i = 0; i < obj3d_list.size(); i ++)
-    {
-        if (obj3d_list[i]._is_tracked)
-        {
-            continue;
-        }
-
-        dist2 = myMATH::dist2(obj3d_list[i]._pt_center, pt3d_est);
-        if (dist2 < min_dist2)
-        {
-            min_dist2 = dist2;
-            obj_id = i;
-        }
-    }
+    // only cells around pt3d_est are visited, ties go to the smallest id
+    int obj_id = grid.findNearest(
+        pt3d_est, radius, 
+        [&obj3d_list](int i){ return obj3d_list[i]._is_tracked; }
+    );
 
-    return obj_id;
+    return obj_id < 0 ? UNLINKED : obj_id;
 }   
 
 
 template<class T3D>
-void STB<T3D>::startTrack (int frame, PredField& pf)
+void STB<T3D>::startTrack (int frame, PredField& pf, PointGrid const& grid)
 {
     int m = frame - _first;
     int n_obj3d = _ipr_matched[m].size();
@@ -991,7 +1286,7 @@ void STB<T3D>::startTrack (int frame, PredField& pf)
             Track<T3D> init_tr(_ipr_matched[m][i], frame);
 
             pf.getDisp(vel_curr, _ipr_matched[m][i]._pt_center);
-            int obj3d_id = makeLink(init_tr, frame+1, vel_curr, _r_objSearch);
+            int obj3d_id = makeLink(init_tr, frame+1, vel_curr, _r_objSearch, grid);
 
             if (obj3d_id != UNLINKED)
             {
@@ -1039,7 +1334,7 @@ bool STB<T3D>::findPredObj (T3D& obj3d, std::vector<Image> const& img_list)
             obj3d._camid_list.clear();
 
             std::vector<Tracer2D> obj2d_list;
-            objfinder.findObject2D(obj2d_list, img_list[i], _obj_param, region);
+            objfinder.findObject2D(obj2d_list, img_list[i], _obj_param, region, _cam_list.getMask(i));
 
             if (obj2d_list.size() == 0)
             {
@@ -1116,9 +1411,8 @@ bool STB<T3D>::checkObj2D (T3D& obj3d)
 
 
 template<class T3D>
-int STB<T3D>::linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& obj3d_list, int n_iter)
+int STB<T3D>::linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& obj3d_list, PointGrid const& grid, PointGrid const& grid_track, int n_iter)
 {
-    int n_la = _long_track_active.size();
     Pt3D est, vel;
     double w, beta2;
     int obj3d_id = UNLINKED;
@@ -1128,8 +1422,15 @@ int STB<T3D>::linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& o
     int n_nearTracks = 0;
     std::vector<Pt3D> disp;
 
-    std::vector<int> is_around(n_la, 0);
-    std::vector<double> dsqr(n_la, 1e8);
+    // query the neighbouring long tracks once with the largest radius,
+    // each step then only admits the candidates within its own radius
+    double r_max = std::pow(1.1, n_iter-1) * 3 * _r_trackSearch * 1.01;
+    std::vector<int> track_id_list;
+    grid_track.findNeighbor(track_id_list, track._obj3d_list.back()._pt_center, r_max);
+
+    int n_cand = track_id_list.size();
+    std::vector<int> is_around(n_cand, 0);
+    std::vector<double> dsqr(n_cand, 1e8);
     double rsqr, shift;
     
     for (int step = 0; step < n_iter; step ++)
@@ -1143,34 +1444,35 @@ int STB<T3D>::linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& o
         // calculate the predictive vel. field as an avg. of particle vel from neighbouring tracks
         // identify the neighbour tr (using 3*avg interpt dist.) and get their pt vel
         int len = 0;
-        for (int j = 0; j < n_la; j ++)
+        for (int k = 0; k < n_cand; k ++)
         {
-            if (is_around[j])
+            if (is_around[k])
             {
                 continue;
             }
 
-            len = _long_track_active[j]._obj3d_list.size();
+            Track<T3D> const& track_near = _long_track_active[track_id_list[k]];
+            len = track_near._obj3d_list.size();
 
             if (step == 0)
             {
-                dsqr[j] = myMATH::dist2(
-                    _long_track_active[j]._obj3d_list[len-2]._pt_center, 
+                dsqr[k] = myMATH::dist2(
+                    track_near._obj3d_list[len-2]._pt_center, 
                     track._obj3d_list.back()._pt_center
                 ); 
             }
 
-            if (dsqr[j] < rsqr)
+            if (dsqr[k] < rsqr)
             {
-                is_around[j] = 1;
+                is_around[k] = 1;
                 
-                w = 1/(1 + dsqr[j]*beta2);
-                // w = std::sqrt(dsqr[j]);
+                w = 1/(1 + dsqr[k]*beta2);
+                // w = std::sqrt(dsqr[k]);
                 tot_weight += w;
                 weight.push_back(w);
                 
                 disp.push_back(
-                    _long_track_active[j]._obj3d_list[len-1]._pt_center - _long_track_active[j]._obj3d_list[len-2]._pt_center
+                    track_near._obj3d_list[len-1]._pt_center - track_near._obj3d_list[len-2]._pt_center
                 );
             }
         }
@@ -1187,13 +1489,13 @@ int STB<T3D>::linkShortTrack (Track<T3D> const& track, std::vector<T3D> const& o
             }
 
             est = track._obj3d_list.back()._pt_center + vel;
-            obj3d_id = findNN(obj3d_list, est, _r_objSearch);
+            obj3d_id = findNN(obj3d_list, grid, est, _r_objSearch);
         }
         else
         {
             // if no neighbouring tracks are identified
             est = track._obj3d_list.back()._pt_center;
-            obj3d_id = findNN(obj3d_list, est, shift);
+            obj3d_id = findNN(obj3d_list, grid, est, shift);
         }
 
         if (obj3d_id != UNLINKED)
@@ -1291,17 +1593,6 @@ bool STB<T3D>::checkLinearFit(Track<T3D> const& track)
 template<class T3D>
 void STB<T3D>::loadTracks (std::string const& file, TrackStatusID status)
 {
-    std::ifstream input(file, std::ios::in);
-
-    if (!input.is_open())
-    {
-        std::cerr << "STB<T3D>::loadTracks error at line" << __LINE__ << ":\n"
-                  << "Cannot open file " << file << std::endl;
-        throw error_io;
-    }
-
-    int track_id_prev = -1;
-    std::vector<double> data(5,0); // track_id, frame_id, x, y, z  
     T3D obj3d;
     if (typeid(T3D) == typeid(Tracer3D))
     {
@@ -1309,43 +1600,97 @@ void STB<T3D>::loadTracks (std::string const& file, TrackStatusID status)
     }
 
     std::deque<Track<T3D>> track_list;
-    std::string line;
-    std::getline(input, line); // skip the first line
-    while (std::getline(input, line))
+    std::vector<int> track_id_list; // track ID in the file
+    bool is_bin = isTrackFileBin(file);
+    if (is_bin)
     {
-        // Trim leading and trailing whitespace (optional)
-        line.erase(0, line.find_first_not_of(" \t\r\n")); // Trim leading whitespace
-        line.erase(line.find_last_not_of(" \t\r\n") + 1); // Trim trailing whitespace
-        if (line.empty())
+        TrackFileReader reader(file);
+        for (int c = 0; c < reader.getNumOfChunk(); c ++)
         {
-            continue;
+            TrackChunk chunk = reader.getChunk(c);
+            for (int i = 0; i < chunk.n_track; i ++)
+            {
+                for (int64_t j = chunk.track_start[i]; j < chunk.track_start[i+1]; j ++)
+                {
+                    obj3d._pt_center[0] = chunk.x[j];
+                    obj3d._pt_center[1] = chunk.y[j];
+                    obj3d._pt_center[2] = chunk.z[j];
+                    obj3d._error = chunk.error[j];
+
+                    if (j == chunk.track_start[i])
+                    {
+                        track_list.push_back(Track<T3D>(obj3d, chunk.frame[j]));
+                    }
+                    else
+                    {
+                        track_list.back().addNext(obj3d, chunk.frame[j]);
+                    }
+                }
+
+                track_id_list.push_back(chunk.track_id[i]);
+            }
         }
-        
-        std::istringstream ss(line);
+    }
+    else
+    {
+        std::ifstream input(file, std::ios::in);
 
-        for (int i = 0; i < 5; i ++)
+        if (!input.is_open())
         {
-            ss >> data[i];
-            ss.ignore();
+            std::cerr << "STB<T3D>::loadTracks error at line" << __LINE__ << ":\n"
+                      << "Cannot open file " << file << std::endl;
+            throw error_io;
         }
-        
-        obj3d._pt_center[0] = data[2];
-        obj3d._pt_center[1] = data[3];
-        obj3d._pt_center[2] = data[4];
+        input.close();
+
+        // track_id, frame_id, x, y, z  
+        std::vector<double> data;
+        int n_col = 5;
+        int n_row = readCSV(data, n_col, file, 1); // skip the first line
 
-        if (data[0] != track_id_prev)
+        int track_id_prev = -1;
+        for (int i = 0; i < n_row; i ++)
         {
-            Track<T3D> track(obj3d, data[1]);
-            track_list.push_back(track);
-            track_id_prev = data[0];
+            double const* row = data.data() + 5*i;
+
+            obj3d._pt_center[0] = row[2];
+            obj3d._pt_center[1] = row[3];
+            obj3d._pt_center[2] = row[4];
+
+            if (row[0] != track_id_prev)
+            {
+                Track<T3D> track(obj3d, row[1]);
+                track_list.push_back(track);
+                track_id_prev = row[0];
+                track_id_list.push_back(row[0]);
+            }
+            else
+            {
+                track_list.back().addNext(obj3d, row[1]);
+            }
         }
-        else
+    }
+
+    // keep the global ID of long tracks
+    //  old csv files number the tracks 0,1,2,... in each file,
+    //  these IDs are moved after the assigned ones, so loading several files gives unique IDs
+    if (status != SHORT_ACTIVE)
+    {
+        bool is_file_id = !is_bin;
+        for (int i = 0; is_file_id && i < track_id_list.size(); i ++)
         {
-            track_list.back().addNext(obj3d, data[1]);
+            is_file_id = track_id_list[i] == i;
         }
-    }
+        int id_offset = is_file_id ? _n_track_id : 0;
 
-    input.close();
+        int n_track_id = _n_track_id;
+        for (int i = 0; i < track_list.size(); i ++)
+        {
+            track_list[i]._track_id = track_id_list[i] + id_offset;
+            n_track_id = std::max(n_track_id, track_list[i]._track_id + 1);
+        }
+        _n_track_id = n_track_id;
+    }
 
 
     switch (status)
@@ -1375,6 +1720,22 @@ void STB<T3D>::loadTracks (std::string const& file, TrackStatusID status)
 template<class T3D>
 void STB<T3D>::saveTracks (std::string const& file, std::deque<Track<T3D>>& tracks)
 {
+    // tracks without a global ID (short tracks) are numbered after the assigned IDs
+    int track_id_new = _n_track_id;
+
+    if (isTrackFileBin(file))
+    {
+        TrackFileWriter output;
+        output.open(file, _fps, _n_cam_all);
+        for (int i = 0; i < tracks.size(); i ++)
+        {
+            int track_id = tracks[i]._track_id >= 0 ? tracks[i]._track_id : track_id_new ++;
+            tracks[i].saveTrack(output, track_id);
+        }
+        output.close();
+        return;
+    }
+
     std::ofstream output(file, std::ios::out);
 
     if (!output.is_open())
@@ -1391,31 +1752,347 @@ void STB<T3D>::saveTracks (std::string const& file, std::deque<Track<T3D>>& trac
     }
     output << "\n";
 
+    std::vector<int> track_id_list(tracks.size());
     for (int i = 0; i < tracks.size(); i ++)
     {
-        tracks[i].saveTrack(output, i, _fps, _n_cam_all);
+        track_id_list[i] = tracks[i]._track_id >= 0 ? tracks[i]._track_id : track_id_new ++;
+    }
+
+    if (_n_thread > 0)
+    {
+        omp_set_num_threads(_n_thread);
     }
+    writeTextParallel(output, tracks.size(), [&](TextBuffer& buffer, int i){
+        tracks[i].saveTrack(buffer, track_id_list[i], _fps, _n_cam_all);
+    }, 64);
 
     output.close();
 }
 
 
+template<class T3D>
+void STB<T3D>::flushTracks ()
+{
+    if (!_exit_writer.isOpen())
+    {
+        std::string s = std::to_string(_seg_first) + "_" + std::to_string(_last);
+        _exit_writer.open(_output_folder + "ExitTrack_" + s + getTrackExt(), _fps, _n_cam_all);
+        _long_inactive_writer.open(_output_folder + "LongTrackInactive_" + s + getTrackExt(), _fps, _n_cam_all);
+    }
+
+    _exit_writer.push(_exit_track);
+    _long_inactive_writer.push(_long_track_inactive);
+}
+
+
+template<class T3D>
+void STB<T3D>::closeTrackWriters (int frame)
+{
+    if (!_exit_writer.isOpen())
+    {
+        return;
+    }
+
+    _n_exit_saved += _exit_writer.getNumOfTrack();
+    _n_long_inactive_saved += _long_inactive_writer.getNumOfTrack();
+    _exit_writer.close();
+    _long_inactive_writer.close();
+
+    // files of a finished segment are named after its last frame
+    if (frame != _last)
+    {
+        std::string s_open = std::to_string(_seg_first) + "_" + std::to_string(_last) + getTrackExt();
+        std::string s_close = std::to_string(_seg_first) + "_" + std::to_string(frame) + getTrackExt();
+        std::error_code ec_exit, ec_long_inactive;
+        fs::rename(_output_folder + "ExitTrack_" + s_open, _output_folder + "ExitTrack_" + s_close, ec_exit);
+        fs::rename(_output_folder + "LongTrackInactive_" + s_open, _output_folder + "LongTrackInactive_" + s_close, ec_long_inactive);
+        if (ec_exit || ec_long_inactive)
+        {
+            std::cerr << "STB<T3D>::closeTrackWriters error at line" << __LINE__ << ":\n"
+                      << "Cannot rename track files " << _output_folder << "*_" << s_open << std::endl;
+            throw error_io;
+        }
+    }
+    _seg_first = frame + 1;
+}
+
+
+template<class T3D>
+void STB<T3D>::saveCheckpoint (std::string const& file, int frame)
+{
+    clock_t t_start, t_end;
+    t_start = clock();
+
+    // tracks finished up to frame are on disk before the checkpoint refers to them
+    if (_exit_writer.isOpen())
+    {
+        flushTracks();
+        closeTrackWriters(frame);
+    }
+
+    CheckpointWriter output;
+    output.open(file);
+
+    output.write(frame);
+    output.write(_n_cam_all);
+
+    // config parameters
+    output.write(_first);
+    output.write(_last);
+    output.write(_fps);
+    output.write(_vx_to_mm);
+    output.write(_axis_limit);
+    output.write(_ipr_flag);
+    output.write(_r_objSearch);
+    output.write(_r_trackSearch);
+    output.write(_n_initPhase);
+    output.write(_r_predSearch);
+    output.write(_shake_width);
+
+    output.write(_pf_param.limit);
+    output.write(_pf_param.nx);
+    output.write(_pf_param.ny);
+    output.write(_pf_param.nz);
+    output.write(_pf_param.r);
+    output.write(_pf_param.nBin_x);
+    output.write(_pf_param.nBin_y);
+    output.write(_pf_param.nBin_z);
+
+    output.write(_pred_param.type);
+    output.write(_pred_param.n_hist);
+    output.write(_pred_param.poly_order);
+    output.write(_pred_param.kalman_q);
+    output.write(_pred_param.kalman_r);
+    output.write(_pred_param.is_hindcast);
+
+    output.write(_ipr_only);
+    output.write(_ipr_param.tri_only);
+    output.write(_ipr_param.n_loop_ipr);
+    output.write(_ipr_param.n_loop_ipr_reduced);
+    output.write(_ipr_param.n_obj2d_max);
+    output.write(_ipr_param.tol_2d);
+    output.write(_ipr_param.tol_3d);
+    output.write(_ipr_param.check_id);
+    output.write(_ipr_param.check_radius);
+    output.write(_ipr_param.n_loop_shake);
+    output.write(_ipr_param.shake_width);
+    output.write(_ipr_param.ghost_threshold);
+    output.write(_ipr_param.shake_gauss_seidel);
+    output.write(_ipr_param.shake_tol_conv_pos);
+    output.write(_ipr_param.shake_tol_conv_res);
+    output.write(_n_reduced);
+    output.write(_tol_2d_overlap);
+    output.write(_obj_param);
+    output.write(_track_format);
+    output.write(_checkpoint_interval);
+
+    // OTF
+    output.write(_otf._param);
+
+    // counters
+    output.write(_a_sa);
+    output.write(_a_la);
+    output.write(_s_sa);
+    output.write(_s_la);
+    output.write(_a_li);
+    output.write(_n_track_id);
+    output.write(_seg_first);
+    output.write(_n_exit_saved);
+    output.write(_n_long_inactive_saved);
+
+    // objects and tracks
+    output.write(_ipr_matched);
+    output.write(_short_track_active);
+    output.write(_long_track_active);
+    output.write(_long_track_inactive);
+    output.write(_exit_track);
+
+    output.close();
+
+    t_end = clock();
+    std::cout << "Save checkpoint at frame " << frame << ": " << file << "; " << (double) (t_end - t_start)/CLOCKS_PER_SEC << " s." << std::endl;
+}
+
+
+template<class T3D>
+void STB<T3D>::readCheckpointState (CheckpointReader& input)
+{
+    // config parameters
+    input.read(_first);
+    input.read(_last);
+    input.read(_fps);
+    input.read(_vx_to_mm);
+    input.read(_axis_limit);
+    input.read(_ipr_flag);
+    input.read(_r_objSearch);
+    input.read(_r_trackSearch);
+    input.read(_n_initPhase);
+    input.read(_r_predSearch);
+    input.read(_shake_width);
+
+    input.read(_pf_param.limit);
+    input.read(_pf_param.nx);
+    input.read(_pf_param.ny);
+    input.read(_pf_param.nz);
+    input.read(_pf_param.r);
+    input.read(_pf_param.nBin_x);
+    input.read(_pf_param.nBin_y);
+    input.read(_pf_param.nBin_z);
+
+    input.read(_pred_param.type);
+    input.read(_pred_param.n_hist);
+    input.read(_pred_param.poly_order);
+    input.read(_pred_param.kalman_q);
+    input.read(_pred_param.kalman_r);
+    input.read(_pred_param.is_hindcast);
+
+    input.read(_ipr_only);
+    input.read(_ipr_param.tri_only);
+    input.read(_ipr_param.n_loop_ipr);
+    input.read(_ipr_param.n_loop_ipr_reduced);
+    input.read(_ipr_param.n_obj2d_max);
+    input.read(_ipr_param.tol_2d);
+    input.read(_ipr_param.tol_3d);
+    input.read(_ipr_param.check_id);
+    input.read(_ipr_param.check_radius);
+    input.read(_ipr_param.n_loop_shake);
+    input.read(_ipr_param.shake_width);
+    input.read(_ipr_param.ghost_threshold);
+    input.read(_ipr_param.shake_gauss_seidel);
+    input.read(_ipr_param.shake_tol_conv_pos);
+    input.read(_ipr_param.shake_tol_conv_res);
+    input.read(_n_reduced);
+    input.read(_tol_2d_overlap);
+    input.read(_obj_param);
+    input.read(_track_format);
+    input.read(_checkpoint_interval);
+
+    // OTF
+    input.read(_otf._param);
+
+    // counters
+    input.read(_a_sa);
+    input.read(_a_la);
+    input.read(_s_sa);
+    input.read(_s_la);
+    input.read(_a_li);
+    input.read(_n_track_id);
+    input.read(_seg_first);
+    input.read(_n_exit_saved);
+    input.read(_n_long_inactive_saved);
+
+    // objects and tracks
+    input.read(_ipr_matched);
+    input.read(_short_track_active);
+    input.read(_long_track_active);
+    input.read(_long_track_inactive);
+    input.read(_exit_track);
+}
+
+
+template<class T3D>
+int STB<T3D>::loadCheckpoint (std::string const& file)
+{
+    CheckpointReader input(file);
+
+    int frame, n_cam_all;
+    input.read(frame);
+    input.read(n_cam_all);
+    if (n_cam_all != _n_cam_all)
+    {
+        std::cerr << "STB<T3D>::loadCheckpoint error at line" << __LINE__ << ":\n"
+                  << "Checkpoint " << file << " has " << n_cam_all << " cameras, STB has " << _n_cam_all << "." << std::endl;
+        throw error_size;
+    }
+
+    // read into a temporary state, this one is unchanged if the file is broken
+    STB<T3D> state(*this);
+    state.readCheckpointState(input);
+    input.close();
+
+    // the frame range comes from the current config
+    if (frame < _first || frame > _last)
+    {
+        std::cerr << "STB<T3D>::loadCheckpoint error at line" << __LINE__ << ":\n"
+                  << "Checkpoint " << file << " frame " << frame << " is out of the frame range " << _first << " ~ " << _last << "." << std::endl;
+        throw error_range;
+    }
+    if (state._first != _first || state._last != _last)
+    {
+        std::cout << "STB<T3D>::loadCheckpoint warning: "
+                  << "checkpoint frame range " << state._first << " ~ " << state._last 
+                  << " is replaced by " << _first << " ~ " << _last << "." << std::endl;
+    }
+
+    _fps = state._fps;
+    _vx_to_mm = state._vx_to_mm;
+    _axis_limit = state._axis_limit;
+    _ipr_flag = state._ipr_flag;
+    _r_objSearch = state._r_objSearch;
+    _r_trackSearch = state._r_trackSearch;
+    _n_initPhase = state._n_initPhase;
+    _r_predSearch = state._r_predSearch;
+    _shake_width = state._shake_width;
+    _pf_param = state._pf_param;
+    _pred_param = state._pred_param;
+    _ipr_only = state._ipr_only;
+    _ipr_param = state._ipr_param;
+    _n_reduced = state._n_reduced;
+    _tol_2d_overlap = state._tol_2d_overlap;
+    _obj_param = std::move(state._obj_param);
+    _track_format = state._track_format;
+    _checkpoint_interval = state._checkpoint_interval;
+
+    _otf._param = std::move(state._otf._param);
+
+    _a_sa = state._a_sa;
+    _a_la = state._a_la;
+    _s_sa = state._s_sa;
+    _s_la = state._s_la;
+    _a_li = state._a_li;
+    _n_track_id = state._n_track_id;
+    _seg_first = state._seg_first;
+    _n_exit_saved = state._n_exit_saved;
+    _n_long_inactive_saved = state._n_long_inactive_saved;
+
+    _ipr_matched = std::move(state._ipr_matched);
+    _short_track_active = std::move(state._short_track_active);
+    _long_track_active = std::move(state._long_track_active);
+    _long_track_inactive = std::move(state._long_track_inactive);
+    _exit_track = std::move(state._exit_track);
+
+    // files written after the checkpoint are overwritten by the next flushTracks
+    _exit_writer.close();
+    _long_inactive_writer.close();
+
+    // the workspaces are rebuilt with the restored parameters
+    _ipr_ws.reset();
+    _shake_ws.reset();
+
+    std::cout << "Load checkpoint at frame " << frame << ": " << file << std::endl;
+    std::cout << "\tNo. of active short tracks: " << _short_track_active.size()
+              << "; No. of active long tracks: " << _long_track_active.size() << std::endl;
+
+    return frame;
+}
+
+
 template<class T3D>
 void STB<T3D>::saveTracksAll(std::string const& folder, int frame)
 {
     std::string s = std::to_string(frame);
     std::string file;
 
-    file = "LongTrackActive_" + s + ".csv";
+    file = "LongTrackActive_" + s + getTrackExt();
     saveTracks(folder + file, _long_track_active);
 
-    file = "ShortTrackActive_" + s + ".csv";
+    file = "ShortTrackActive_" + s + getTrackExt();
     saveTracks(folder + file, _short_track_active);
 
-    file = "ExitTrack_" + s + ".csv";
+    file = "ExitTrack_" + s + getTrackExt();
     saveTracks(folder + file, _exit_track);
 
-    file = "LongTrackInactive_" + s + ".csv";
+    file = "LongTrackInactive_" + s + getTrackExt();
     saveTracks(folder + file, _long_track_inactive);
 }
 
@@ -5,44 +5,62 @@
 
 void Shake::runShake(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::vector<Image> const& imgOrig_list, bool tri_only)
 {
-    shakeTracers(tr3d_list, otf, imgOrig_list, tri_only);
+    // the only copy of the original images, storage is reused if the size is unchanged
+    _imgRes_list.resize(_n_cam_use);
+    for (int id = 0; id < _n_cam_use; id ++)
+    {
+        _imgRes_list[id] = imgOrig_list[_cam_list.useid_list[id]];
+    }
+
+    shakeTracers(tr3d_list, otf, tri_only);
 }
 
 
-void Shake::checkReaptedObj(std::vector<Tracer3D> const& tr3d_list, double tol_3d)
+void Shake::runShakeInPlace(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::vector<Image>& img_list, bool tri_only)
 {
-    int n_tr3d = tr3d_list.size();
-    _is_repeated.resize(n_tr3d, 0);
-    _n_repeated = 0;
-
-    // Remove repeated tracks
-    if (_n_thread > 0)
+    // borrow the images of the used cameras, only the pixel buffers are swapped
+    _imgRes_list.resize(_n_cam_use);
+    for (int id = 0; id < _n_cam_use; id ++)
     {
-        omp_set_num_threads(_n_thread);
+        std::swap(_imgRes_list[id], img_list[_cam_list.useid_list[id]]);
     }
 
-    double repeat_thres_2 = tol_3d * tol_3d;
-    for (int i = 0; i < n_tr3d-1; i ++)
+    try
+    {
+        shakeTracers(tr3d_list, otf, tri_only);
+    }
+    catch (...)
     {
-        if (_is_repeated[i])
+        for (int id = 0; id < _n_cam_use; id ++)
         {
-            continue;
+            std::swap(_imgRes_list[id], img_list[_cam_list.useid_list[id]]);
         }
+        throw;
+    }
 
-        #pragma omp parallel for
-        for (int j = i+1; j < n_tr3d; j ++)
-        {
-            if (myMATH::dist2(tr3d_list[i]._pt_center, tr3d_list[j]._pt_center) < repeat_thres_2)
-            {
-                _is_repeated[j] = 1;
-                _n_repeated ++;
-            }
-        }
+    for (int id = 0; id < _n_cam_use; id ++)
+    {
+        std::swap(_imgRes_list[id], img_list[_cam_list.useid_list[id]]);
     }
 }
 
 
-void Shake::shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::vector<Image> const& imgOrig_list, bool tri_only)
+void Shake::checkReaptedObj(std::vector<Tracer3D> const& tr3d_list, double tol_3d)
+{
+    // Remove repeated tracks
+    if (_n_thread > 0)
+    {
+        omp_set_num_threads(_n_thread);
+    }
+
+    // a tracer is repeated if an earlier non-repeated tracer is within tol_3d
+    PointGrid grid;
+    grid.build(tr3d_list, tol_3d);
+    _n_repeated = grid.findRepeat(_is_repeated, tol_3d);
+}
+
+
+void Shake::shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, bool tri_only)
 {
     // update tr2d position
     int n_tr3d = tr3d_list.size();
@@ -58,22 +76,16 @@ void Shake::shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::
     }
 
     // Initialize lists
-    _imgRes_list.clear();
-    _is_ghost.resize(n_tr3d, 0);
+    _is_ghost.assign(n_tr3d, 0);
     _n_ghost = 0;
 
     // Initialize residue image
-    int cam_id;
-    for (int id = 0; id < _n_cam_use; id ++)
-    {
-        cam_id = _cam_list.useid_list[id];
-        _imgRes_list.push_back(imgOrig_list[cam_id]);
-    }
+    initResImg();
 
     // if only do triangulation, then skip the following steps
     if (tri_only)
     {
-        calResImg(tr3d_list, otf, imgOrig_list);
+        calResImg(tr3d_list, otf);
         absResImg();
         return;
     }
@@ -82,12 +94,33 @@ void Shake::shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::
     _score_list.resize(n_tr3d);
     std::fill(_score_list.begin(), _score_list.end(), 1);
 
+    // Initialize active set
+    _is_converged.assign(n_tr3d, 0);
+    _residue_list.assign(n_tr3d, 0);
+    _converge_ratio_list.clear();
+    bool is_active_set = _tol_conv_pos > 0 && _tol_conv_res > 0;
+
+    // Initialize patch arena for each thread
+    configArena(tr3d_list);
+
+    // Color tracers for Gauss-Seidel shake
+    //  the margin covers the largest shift of one loop
+    if (_is_gauss_seidel)
+    {
+        calShiftScale(tr3d_list);
+        _color_margin = _shift_px_per_mm * _shake_width;
+        colorTracers(tr3d_list);
+    }
+
     double delta;
-    std::vector<int> is_ignore(n_tr3d, 0);
     for (int loop = 0; loop < _n_loop; loop ++)
     {
         // update residue img
-        calResImg(tr3d_list, otf, imgOrig_list);
+        //  Gauss-Seidel shake keeps it updated after each color
+        if (!_is_gauss_seidel || loop == 0)
+        {
+            calResImg(tr3d_list, otf);
+        }
 
         // update shake width
         if (loop < 1)
@@ -105,23 +138,77 @@ void Shake::shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::
             delta = _shake_width / 20;
         }
 
+        // recolor if the tracers may move out of the margin in this loop
+        //  each axis moves by at most delta per loop
+        if (_is_gauss_seidel && loop > 0 && getColorShift(tr3d_list) + _shift_px_per_mm * delta > _color_margin)
+        {
+            colorTracers(tr3d_list);
+        }
+
         // shake each tracer
         if (_n_thread != 0)
         {
             omp_set_num_threads(_n_thread);
         }
-        #pragma omp parallel
+        if (!_is_gauss_seidel)
         {
-            #pragma omp for
-            for (int i = 0; i < n_tr3d; i ++)
+            #pragma omp parallel
             {
-                if (!is_ignore[i])
+                PatchArena& arena = _arena_list[omp_get_thread_num()];
+
+                #pragma omp for
+                for (int i = 0; i < n_tr3d; i ++)
                 {
-                    _score_list[i] = shakeOneTracer(tr3d_list[i], otf, delta, _score_list[i]);
-                    // _score_list[i] = shakeOneTracerGrad(tr3d_list[i], otf, delta, _score_list[i], delta*0.1);
+                    shakeActiveTracer(tr3d_list[i], i, otf, delta, is_active_set && loop > 0, arena);
+                    // _score_list[i] = shakeOneTracerGrad(tr3d_list[i], otf, delta, _score_list[i], arena, delta*0.1);
                 }
             }
         }
+        else
+        {
+            // shake one color at a time, then update residue around the shaken tracers
+            for (int color = 0; color < _n_color; color ++)
+            {
+                std::vector<int> const& tr_id_list = _color_class[color];
+                int n_tr_color = tr_id_list.size();
+
+                #pragma omp parallel
+                {
+                    PatchArena& arena = _arena_list[omp_get_thread_num()];
+
+                    #pragma omp for
+                    for (int k = 0; k < n_tr_color; k ++)
+                    {
+                        int i = tr_id_list[k];
+                        for (int id = 0; id < _n_cam_use; id ++)
+                        {
+                            _pt2d_prev[(i*_n_cam_use + id)*2]   = tr3d_list[i]._tr2d_list[id]._pt_center[0];
+                            _pt2d_prev[(i*_n_cam_use + id)*2+1] = tr3d_list[i]._tr2d_list[id]._pt_center[1];
+                        }
+
+                        shakeActiveTracer(tr3d_list[i], i, otf, delta, is_active_set && loop > 0, arena);
+                    }
+                }
+
+                updateResImgColor(tr3d_list, otf, tr_id_list);
+            }
+        }
+
+        // stop if all tracers are converged
+        if (is_active_set)
+        {
+            int n_converged = std::count(_is_converged.begin(), _is_converged.end(), 1);
+            _converge_ratio_list.push_back(double(n_converged) / n_tr3d);
+
+            #ifdef DEBUG
+            std::cout << "\tShake loop " << loop << ": " << n_converged << "/" << n_tr3d << " tracers converged." << std::endl;
+            #endif
+
+            if (n_converged == n_tr3d)
+            {
+                break;
+            }
+        }
     }
 
     // remove ghost tracers
@@ -129,25 +216,108 @@ void Shake::shakeTracers(std::vector<Tracer3D>& tr3d_list, OTF const& otf, std::
     // removeGhostResidue(tr3d_list);
 
     // update residue image
-    calResImg(tr3d_list, otf, imgOrig_list);
+    calResImg(tr3d_list, otf);
 
     // calculate absolute intensity value
     absResImg();
 }
 
 
-void Shake::calResImg(std::vector<Tracer3D> const& tr3d_list, OTF const& otf, std::vector<Image> const& imgOrig_list)
+void Shake::configArena(std::vector<Tracer3D> const& tr3d_list)
+{
+    // the augmented region has a half width of 2*r_px
+    //  findRegion gives at most int(2*half_width)+3 pixels in each direction
+    double r_px_max = 0;
+    for (int i = 0; i < tr3d_list.size(); i ++)
+    {
+        for (int id = 0; id < tr3d_list[i]._tr2d_list.size(); id ++)
+        {
+            r_px_max = std::max(r_px_max, tr3d_list[i]._tr2d_list[id]._r_px);
+        }
+    }
+    int n_side = int(std::ceil(2 * 2 * r_px_max)) + 3;
+
+    int n_arena = omp_get_max_threads();
+    if (_arena_list.size() < n_arena)
+    {
+        _arena_list.resize(n_arena);
+    }
+    for (int i = 0; i < _arena_list.size(); i ++)
+    {
+        _arena_list[i].config(_n_cam_use, n_side * n_side);
+    }
+}
+
+
+void Shake::initResImg()
+{
+    _orig_list.resize(_n_cam_use);
+    _is_saved_list.resize(_n_cam_use);
+    _saved_id_list.resize(_n_cam_use);
+
+    for (int id = 0; id < _n_cam_use; id ++)
+    {
+        size_t n_pix = size_t(_imgRes_list[id].getDimRow()) * _imgRes_list[id].getDimCol();
+        if (_is_saved_list[id].size() != n_pix)
+        {
+            _orig_list[id].resize(n_pix);
+            _is_saved_list[id].assign(n_pix, 0);
+        }
+        else
+        {
+            // the images are new, only forget the pixels saved by the last run
+            for (int pix_id : _saved_id_list[id])
+            {
+                _is_saved_list[id][pix_id] = 0;
+            }
+        }
+        _saved_id_list[id].clear();
+    }
+}
+
+
+void Shake::saveRegion(int id, PixelRange const& region)
+{
+    int n_col = _imgRes_list[id].getDimCol();
+    for (int row = region.row_min; row < region.row_max; row ++)
+    {
+        for (int col = region.col_min; col < region.col_max; col ++)
+        {
+            int pix_id = row * n_col + col;
+            if (!_is_saved_list[id][pix_id])
+            {
+                _is_saved_list[id][pix_id] = 1;
+                _orig_list[id][pix_id] = _imgRes_list[id][pix_id];
+                _saved_id_list[id].push_back(pix_id);
+            }
+        }
+    }
+}
+
+
+void Shake::restoreResImg()
+{
+    for (int id = 0; id < _n_cam_use; id ++)
+    {
+        for (int pix_id : _saved_id_list[id])
+        {
+            _imgRes_list[id][pix_id] = _orig_list[id][pix_id];
+            _is_saved_list[id][pix_id] = 0;
+        }
+        _saved_id_list[id].clear();
+    }
+}
+
+
+void Shake::calResImg(std::vector<Tracer3D> const& tr3d_list, OTF const& otf)
 {
     int n_tr3d = tr3d_list.size();
     int cam_id, row_min, row_max, col_min, col_max;
     double residue;
 
     // initialize residue image
-    for (int id = 0; id < _n_cam_use; id ++)
-    {
-        cam_id = _cam_list.useid_list[id];
-        _imgRes_list[id] = imgOrig_list[cam_id];
-    }
+    //  only the pixels changed by the last update are copied back
+    restoreResImg();
 
     // remove all tracers
     double ratio_region = 1;
@@ -176,11 +346,14 @@ void Shake::calResImg(std::vector<Tracer3D> const& tr3d_list, OTF const& otf, st
             col_min = res_region.col_min;
             col_max = res_region.col_max;
 
+            saveRegion(id, res_region);
+            int n_col = _imgRes_list[id].getDimCol();
+
             for (int row = row_min; row < row_max; row ++)
             {
                 for (int col = col_min; col < col_max; col ++)
                 {
-                    residue = imgOrig_list[cam_id](row, col) - gaussIntensity(col, row, tr3d_list[i]._tr2d_list[id]._pt_center, otf_param);
+                    residue = _orig_list[id][row * n_col + col] - gaussIntensity(col, row, tr3d_list[i]._tr2d_list[id]._pt_center, otf_param);
                     
                     if (!std::isfinite(residue))
                     {
@@ -218,11 +391,313 @@ void Shake::calResImg(std::vector<Tracer3D> const& tr3d_list, OTF const& otf, st
 }
 
 
+void Shake::colorTracers(std::vector<Tracer3D> const& tr3d_list)
+{
+    int n_tr3d = tr3d_list.size();
+
+    // two augmented regions (half width = 2*r_px) overlap if the centers are closer than 2*half_width+2
+    //  1 more pixel is added since tracers move during shaking,
+    //  and both tracers may move by _color_margin before the next coloring
+    //  r_px is the same one used by findRegion
+    double r_px_max = 0;
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            r_px_max = std::max(r_px_max, tr3d_list[i]._tr2d_list[id]._r_px);
+        }
+    }
+    double dist_max = 2 * (2 * r_px_max) + 3 + 2 * _color_margin;
+    int cell_size = std::max(1, int(std::ceil(dist_max)));
+
+    // bucket tracers in each camera: cell_start[cell]...cell_start[cell+1] in cell_item
+    std::vector<int> n_grid_row(_n_cam_use), n_grid_col(_n_cam_use);
+    std::vector<std::vector<int>> cell_start(_n_cam_use), cell_item(_n_cam_use);
+    std::vector<int> cell_id(n_tr3d);
+    for (int id = 0; id < _n_cam_use; id ++)
+    {
+        int cam_id = _cam_list.useid_list[id];
+        n_grid_row[id] = _cam_list.cam_list[cam_id].getNRow() / cell_size + 1;
+        n_grid_col[id] = _cam_list.cam_list[cam_id].getNCol() / cell_size + 1;
+        int n_cell = n_grid_row[id] * n_grid_col[id];
+
+        cell_start[id].assign(n_cell+1, 0);
+        for (int i = 0; i < n_tr3d; i ++)
+        {
+            int row = int(tr3d_list[i]._tr2d_list[id]._pt_center[1]) / cell_size;
+            int col = int(tr3d_list[i]._tr2d_list[id]._pt_center[0]) / cell_size;
+            row = std::min(std::max(row, 0), n_grid_row[id]-1);
+            col = std::min(std::max(col, 0), n_grid_col[id]-1);
+            cell_id[i] = row * n_grid_col[id] + col;
+            cell_start[id][cell_id[i]+1] ++;
+        }
+        for (int c = 0; c < n_cell; c ++)
+        {
+            cell_start[id][c+1] += cell_start[id][c];
+        }
+        cell_item[id].resize(n_tr3d);
+        std::vector<int> cell_fill(cell_start[id].begin(), cell_start[id].end()-1);
+        for (int i = 0; i < n_tr3d; i ++)
+        {
+            cell_item[id][cell_fill[cell_id[i]] ++] = i;
+        }
+    }
+
+    // find neighbors in the adjacent cells of all cameras
+    _neighbor_list.resize(n_tr3d);
+    if (_n_thread > 0)
+    {
+        omp_set_num_threads(_n_thread);
+    }
+    #pragma omp parallel for
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        std::vector<int>& neighbor = _neighbor_list[i];
+        neighbor.clear();
+
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            double x = tr3d_list[i]._tr2d_list[id]._pt_center[0];
+            double y = tr3d_list[i]._tr2d_list[id]._pt_center[1];
+            int row = std::min(std::max(int(y) / cell_size, 0), n_grid_row[id]-1);
+            int col = std::min(std::max(int(x) / cell_size, 0), n_grid_col[id]-1);
+
+            for (int r = std::max(row-1, 0); r <= std::min(row+1, n_grid_row[id]-1); r ++)
+            {
+                for (int c = std::max(col-1, 0); c <= std::min(col+1, n_grid_col[id]-1); c ++)
+                {
+                    int cell = r * n_grid_col[id] + c;
+                    for (int k = cell_start[id][cell]; k < cell_start[id][cell+1]; k ++)
+                    {
+                        int j = cell_item[id][k];
+                        if (j == i)
+                        {
+                            continue;
+                        }
+
+                        double dx = tr3d_list[j]._tr2d_list[id]._pt_center[0] - x;
+                        double dy = tr3d_list[j]._tr2d_list[id]._pt_center[1] - y;
+                        if (std::fabs(dx) < dist_max && std::fabs(dy) < dist_max)
+                        {
+                            neighbor.push_back(j);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::sort(neighbor.begin(), neighbor.end());
+        neighbor.erase(std::unique(neighbor.begin(), neighbor.end()), neighbor.end());
+    }
+
+    // greedy coloring in index order: use the smallest color not used by colored neighbors
+    std::vector<int>& color_list = _color_list;
+    color_list.assign(n_tr3d, -1);
+    std::vector<int> color_used; // color_used[c] == i: color c is used by a neighbor of i
+    _n_color = 0;
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        for (int j : _neighbor_list[i])
+        {
+            if (color_list[j] >= 0)
+            {
+                color_used[color_list[j]] = i;
+            }
+        }
+
+        int color = 0;
+        while (color < _n_color && color_used[color] == i)
+        {
+            color ++;
+        }
+        if (color == _n_color)
+        {
+            _n_color ++;
+            color_used.push_back(-1);
+        }
+        color_list[i] = color;
+    }
+
+    _color_class.resize(_n_color);
+    for (int c = 0; c < _n_color; c ++)
+    {
+        _color_class[c].clear();
+    }
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        _color_class[color_list[i]].push_back(i);
+    }
+
+    _pt2d_prev.resize(n_tr3d * _n_cam_use * 2);
+    _pt2d_color.resize(n_tr3d * _n_cam_use * 2);
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            _pt2d_color[(i*_n_cam_use + id)*2]   = tr3d_list[i]._tr2d_list[id]._pt_center[0];
+            _pt2d_color[(i*_n_cam_use + id)*2+1] = tr3d_list[i]._tr2d_list[id]._pt_center[1];
+        }
+    }
+
+    #ifdef DEBUG
+    std::cout << "\tShake::colorTracers: " << n_tr3d << " tracers in " << _n_color << " colors." << std::endl;
+    #endif
+}
+
+
+void Shake::calShiftScale(std::vector<Tracer3D> const& tr3d_list)
+{
+    int n_tr3d = tr3d_list.size();
+    double h = _shake_width > 0 ? _shake_width : 1; // [mm]
+
+    // 2D shift of each row/col is at most sum_k |d(row/col)/dx_k| * delta
+    std::vector<double> scale_list(n_tr3d, 0);
+    if (_n_thread > 0)
+    {
+        omp_set_num_threads(_n_thread);
+    }
+    #pragma omp parallel for
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            Camera const& cam = _cam_list.cam_list[_cam_list.useid_list[id]];
+            Pt2D pt2d = cam.project(tr3d_list[i]._pt_center);
+
+            double scale_x = 0, scale_y = 0;
+            for (int k = 0; k < 3; k ++)
+            {
+                Pt3D pt3d = tr3d_list[i]._pt_center;
+                pt3d[k] += h;
+                Pt2D pt2d_shift = cam.project(pt3d);
+                scale_x += std::fabs(pt2d_shift[0] - pt2d[0]) / h;
+                scale_y += std::fabs(pt2d_shift[1] - pt2d[1]) / h;
+            }
+            scale_list[i] = std::max(scale_list[i], std::max(scale_x, scale_y));
+        }
+    }
+
+    _shift_px_per_mm = n_tr3d > 0 ? *std::max_element(scale_list.begin(), scale_list.end()) : 0;
+}
+
+
+double Shake::getColorShift(std::vector<Tracer3D> const& tr3d_list)
+{
+    double shift_max = 0;
+    for (int i = 0; i < tr3d_list.size(); i ++)
+    {
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            shift_max = std::max(shift_max, std::fabs(tr3d_list[i]._tr2d_list[id]._pt_center[0] - _pt2d_color[(i*_n_cam_use + id)*2]));
+            shift_max = std::max(shift_max, std::fabs(tr3d_list[i]._tr2d_list[id]._pt_center[1] - _pt2d_color[(i*_n_cam_use + id)*2+1]));
+        }
+    }
+    return shift_max;
+}
+
+
+void Shake::updateResImgColor(std::vector<Tracer3D> const& tr3d_list, OTF const& otf, std::vector<int> const& tr_id_list)
+{
+    int n_tr_color = tr_id_list.size();
+
+    // keep the original value of the updated pixels before the parallel update
+    //  saveRegion is not thread-safe
+    for (int k = 0; k < n_tr_color; k ++)
+    {
+        int i = tr_id_list[k];
+        if (_is_ghost[i])
+        {
+            continue;
+        }
+
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            double r_px = tr3d_list[i]._tr2d_list[id]._r_px;
+            saveRegion(id, findRegion(id, _pt2d_prev[(i*_n_cam_use + id)*2+1], _pt2d_prev[(i*_n_cam_use + id)*2], r_px));
+            saveRegion(id, findRegion(id, tr3d_list[i]._tr2d_list[id]._pt_center[1], tr3d_list[i]._tr2d_list[id]._pt_center[0], r_px));
+        }
+    }
+
+    if (_n_thread > 0)
+    {
+        omp_set_num_threads(_n_thread);
+    }
+    #pragma omp parallel for
+    for (int k = 0; k < n_tr_color; k ++)
+    {
+        int i = tr_id_list[k];
+        if (_is_ghost[i])
+        {
+            continue;
+        }
+
+        for (int id = 0; id < _n_cam_use; id ++)
+        {
+            int cam_id = _cam_list.useid_list[id];
+            double r_px = tr3d_list[i]._tr2d_list[id]._r_px;
+
+            // pixels covered before and after shaking
+            PixelRange region_list[2] = {
+                findRegion(id, _pt2d_prev[(i*_n_cam_use + id)*2+1], _pt2d_prev[(i*_n_cam_use + id)*2], r_px),
+                findRegion(id, tr3d_list[i]._tr2d_list[id]._pt_center[1], tr3d_list[i]._tr2d_list[id]._pt_center[0], r_px)
+            };
+
+            // the tracer itself and all its neighbors may cover these pixels
+            std::vector<int> tr_id_cover(1, i);
+            tr_id_cover.insert(tr_id_cover.end(), _neighbor_list[i].begin(), _neighbor_list[i].end());
+            std::vector<PixelRange> region_cover(tr_id_cover.size());
+            std::vector<std::vector<double>> otf_param_cover(tr_id_cover.size());
+            for (int n = 0; n < tr_id_cover.size(); n ++)
+            {
+                int j = tr_id_cover[n];
+                region_cover[n] = findRegion(
+                    id, 
+                    tr3d_list[j]._tr2d_list[id]._pt_center[1], 
+                    tr3d_list[j]._tr2d_list[id]._pt_center[0], 
+                    tr3d_list[j]._tr2d_list[id]._r_px
+                );
+                otf_param_cover[n] = otf.getOTFParam(cam_id, tr3d_list[j]._pt_center);
+            }
+
+            int n_col = _imgRes_list[id].getDimCol();
+            for (PixelRange const& region : region_list)
+            {
+                for (int row = region.row_min; row < region.row_max; row ++)
+                {
+                    for (int col = region.col_min; col < region.col_max; col ++)
+                    {
+                        // same as calResImg: the min residue of all tracers
+                        double orig = _orig_list[id][row * n_col + col];
+                        double residue = orig;
+                        for (int n = 0; n < tr_id_cover.size(); n ++)
+                        {
+                            int j = tr_id_cover[n];
+                            bool judge = !_is_ghost[j] &&
+                                         row >= region_cover[n].row_min && 
+                                         row < region_cover[n].row_max && 
+                                         col >= region_cover[n].col_min && 
+                                         col < region_cover[n].col_max;
+                            if (judge)
+                            {
+                                residue = std::min(
+                                    residue, 
+                                    orig - gaussIntensity(col, row, tr3d_list[j]._tr2d_list[id]._pt_center, otf_param_cover[n])
+                                );
+                            }
+                        }
+                        _imgRes_list[id](row, col) = residue;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
 PixelRange Shake::findRegion(int id, double row, double col, double half_width_px)
 {
     int cam_id = _cam_list.useid_list[id];
-    int n_row = _cam_list.cam_list[cam_id].getNRow();
-    int n_col = _cam_list.cam_list[cam_id].getNCol();
+    PixelRange roi = _cam_list.getROI(cam_id);
 
     PixelRange region;
 
@@ -234,13 +709,14 @@ PixelRange Shake::findRegion(int id, double row, double col, double half_width_p
 
     // region.col_max = std::max(std::min(n_col, col+half_width_px+1), 1);
 
-    region.row_min = std::max(0, int(std::floor(row-half_width_px)));
+    // the image is only loaded inside the roi
+    region.row_min = std::max(roi.row_min, int(std::floor(row-half_width_px)));
 
-    region.col_min = std::max(0, int(std::floor(col-half_width_px)));
+    region.col_min = std::max(roi.col_min, int(std::floor(col-half_width_px)));
 
-    region.row_max = std::min(n_row, int(std::ceil(row+half_width_px+1)));
+    region.row_max = std::min(roi.row_max, int(std::ceil(row+half_width_px+1)));
 
-    region.col_max = std::min(n_col, int(std::ceil(col+half_width_px+1)));
+    region.col_max = std::min(roi.col_max, int(std::ceil(col+half_width_px+1)));
 
     return region;
 }
@@ -257,9 +733,38 @@ double Shake::gaussIntensity(int x, int y, Pt2D const& pt2d, std::vector<double>
 }
 
 
-double Shake::shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, double score_old)
+void Shake::shakeActiveTracer(Tracer3D& tr3d, int i, OTF const& otf, double delta, bool is_check_conv, PatchArena& arena)
+{
+    // a frozen tracer keeps its position and score
+    if (_is_converged[i])
+    {
+        return;
+    }
+
+    double x_prev = tr3d._pt_center[0];
+    double y_prev = tr3d._pt_center[1];
+    double z_prev = tr3d._pt_center[2];
+    double residue_prev = _residue_list[i];
+
+    _score_list[i] = shakeOneTracer(tr3d, otf, delta, _score_list[i], arena, _residue_list[i]);
+
+    // freeze the tracer if both its position and residue are converged
+    if (is_check_conv)
+    {
+        double dx = tr3d._pt_center[0] - x_prev;
+        double dy = tr3d._pt_center[1] - y_prev;
+        double dz = tr3d._pt_center[2] - z_prev;
+        double shift = std::sqrt(dx*dx + dy*dy + dz*dz);
+        double res_change = std::fabs(_residue_list[i] - residue_prev);
+
+        _is_converged[i] = shift < _tol_conv_pos && res_change < _tol_conv_res * residue_prev;
+    }
+}
+
+
+double Shake::shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, double score_old, PatchArena& arena, double& residue)
 {
-    ImgAugList imgAug_list; // augmented image list
+    ImgAugList& imgAug_list = arena._imgAug_list; // augmented image list
     
     // calculate augmented image for each camera 
     // pixel range radius: _r_px
@@ -276,7 +781,7 @@ double Shake::shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, doubl
             tr3d._tr2d_list[id]._pt_center[0], // col
             tr3d._tr2d_list[id]._r_px * ratio_region
         );
-        imgAug_list.region_list.push_back(region);
+        imgAug_list.region_list[id] = region;
 
         // Get the range to calculate the projection intensity
         PixelRange int_region = findRegion(
@@ -295,11 +800,8 @@ double Shake::shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, doubl
             n_row = 1;
             n_col = 1;
         }
-        Image aug_img(
-            n_row,
-            n_col, 
-            0
-        );
+        ImgPatch aug_img = arena.getPatch(id, n_row, n_col);
+        aug_img(0, 0) = 0;
 
         std::vector<double> otf_para = otf.getOTFParam(cam_id, tr3d._pt_center);
 
@@ -335,30 +837,29 @@ double Shake::shakeOneTracer(Tracer3D& tr3d, OTF const& otf, double delta, doubl
             i++;
         }
 
-        imgAug_list.img_list.push_back(aug_img);
+        imgAug_list.img_list[id] = aug_img;
     }
 
     // Update the particle position, imgAug and search range
-    double residue = updateTracer(tr3d, imgAug_list, otf, delta);
+    updateTracer(tr3d, imgAug_list, otf, delta);
 
-    // update the tracer score
+    // update the tracer score and final residue in one pass
     // sum up the score of all cam 
     // to delete ghost tracer 
     double tr_score = calTracerScore(
         tr3d,
         imgAug_list, 
         otf,
-        score_old
+        score_old,
+        residue
     );
     return tr_score;
-
-    // return residue;
 }
 
 
-double Shake::shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, double score_old, double lr)
+double Shake::shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, double score_old, PatchArena& arena, double lr)
 {
-    ImgAugList imgAug_list; // augmented image list
+    ImgAugList& imgAug_list = arena._imgAug_list; // augmented image list
     
     int cam_id;
     double ratio_region = 2;
@@ -374,20 +875,15 @@ double Shake::shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, d
         );
 
         // create a particle reproj image (I_p) matrix in the pixel range
-        // Image aug_img(
-        //     region.getNumOfRow(),
-        //     region.getNumOfCol(), 
-        //     0
-        // );
-        Image aug_img;
-        if (region.getNumOfRow() > 0 && region.getNumOfCol() > 0)
-        {
-            aug_img = Image(
-                region.getNumOfRow(),
-                region.getNumOfCol(), 
-                0
-            );
+        int n_row = region.getNumOfRow();
+        int n_col = region.getNumOfCol();
+        if (n_row <= 0 || n_col <= 0)
+        {
+            n_row = 1;
+            n_col = 1;
         }
+        ImgPatch aug_img = arena.getPatch(id, n_row, n_col);
+        aug_img(0, 0) = 0;
         
         std::vector<double> otf_para = otf.getOTFParam(cam_id, tr3d._pt_center);
 
@@ -414,8 +910,8 @@ double Shake::shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, d
             i++;
         }
 
-        imgAug_list.region_list.push_back(region);
-        imgAug_list.img_list.push_back(aug_img);
+        imgAug_list.region_list[id] = region;
+        imgAug_list.img_list[id] = aug_img;
     }
 
     // Update the particle position, imgAug and search range
@@ -428,7 +924,8 @@ double Shake::shakeOneTracerGrad(Tracer3D& tr3d, OTF const& otf, double delta, d
         tr3d,
         imgAug_list, 
         otf,
-        score_old
+        score_old,
+        residue
     );
     return tr_score;
 
@@ -639,7 +1136,7 @@ double Shake::updateTracerGrad(Tracer3D& tr3d, ImgAugList& imgAug_list, OTF cons
 }
 
 
-void Shake::updateImgAugList (ImgAugList& imgAug_list, Tracer3D const& tr3d)
+void Shake::updateImgAugList (ImgAugList& imgAug_list, Tracer3D const& tr3d, PatchArena& arena)
 {
     double ratio_region = 2;
 
@@ -658,8 +1155,14 @@ void Shake::updateImgAugList (ImgAugList& imgAug_list, Tracer3D const& tr3d)
         int n_col_old = imgAug_list.region_list[id].getNumOfCol();
         int n_row_old = imgAug_list.region_list[id].getNumOfRow();
 
-        // save the orig imgAug and update imgAug based on new range
-        Image imgAug_old = imgAug_list.img_list[id];
+        // save the orig imgAug into the scratch slot and update imgAug based on new range
+        ImgPatch imgAug_old = imgAug_list.img_list[id];
+        imgAug_old.data = arena.getScratch();
+        std::copy(
+            imgAug_list.img_list[id].data, 
+            imgAug_list.img_list[id].data + imgAug_old.n_row * imgAug_old.n_col, 
+            imgAug_old.data
+        );
         if (n_col_new != n_col_old || 
             n_row_new != n_row_old)
         {
@@ -669,7 +1172,8 @@ void Shake::updateImgAugList (ImgAugList& imgAug_list, Tracer3D const& tr3d)
                 n_row_new = 1;
             }
 
-            imgAug_list.img_list[id] = Image(n_row_new, n_col_new, 0);
+            imgAug_list.img_list[id] = arena.getPatch(id, n_row_new, n_col_new);
+            imgAug_list.img_list[id](0, 0) = 0;
         }
         
         // record the old range
@@ -780,144 +1284,130 @@ double Shake::calPointResidue (Tracer3D const& tr3d, ImgAugList const& imgAug_li
 }
 
 
-double Shake::calTracerScore (Tracer3D const& tr3d, ImgAugList const& imgAug_list, OTF const& otf, double score)
+double Shake::calTracerScore (Tracer3D const& tr3d, ImgAugList const& imgAug_list, OTF const& otf, double score, double& residue)
 {
+    // Single pass over each augmented patch:
+    //  residue: sum((I_aug - I_p)^2) over the patch, same as calPointResidue
+    //  score: per camera peak, numerator and denominator in the score region (radius = r_px)
+    // the camera with highest local peak intensity is removed afterwards 
+    //  by subtracting its partial sums, no rescan is needed
     int cam_id;
+    int n_outRange = 0;
+    residue = 0;
+    std::vector<int> is_select(_n_cam_use, 1);
+    std::vector<double> peakInt_list(_n_cam_use, 0);
+    std::vector<double> numerator_list(_n_cam_use, 0);
+    std::vector<double> denominator_list(_n_cam_use, 0);
 
-
-    // get range for calculating score (radius = r_px)
-    std::vector<PixelRange> score_region(_n_cam_use);
     for (int id = 0; id < _n_cam_use; id ++)
     {
         cam_id = _cam_list.useid_list[id];
+        Pt2D const& pt_center = tr3d._tr2d_list[id]._pt_center;
+        PixelRange const& aug_region = imgAug_list.region_list[id];
+        ImgPatch const& aug_img = imgAug_list.img_list[id];
 
-        // Get the actual pixel range   
-        score_region[id] = findRegion(
+        // get range for calculating score and projection intensity
+        PixelRange score_region = findRegion(
             id, 
-            tr3d._tr2d_list[id]._pt_center[1], // row
-            tr3d._tr2d_list[id]._pt_center[0], // col
+            pt_center[1], // row
+            pt_center[0], // col
             tr3d._tr2d_list[id]._r_px
         );
-    }
 
-
-    // update particle intensity 
-    // (ignoring the camera with highest local peak intensity)
-    // Calculate intensity for each camera: 
-    //  if the tracer is out of the image, directly set the intensity as 0
-    //  then calculate the new score without the outlier
-    int n_outRange = 0;
-    std::vector<int> is_select(_n_cam_use, 1);
-
-    std::vector<double> peakInt_list(_n_cam_use, 0);
-    for (int id = 0; id < _n_cam_use; id ++)
-    {
         // if the tracer is out of the image, do not select this camera
-        bool judge = score_region[id].getNumOfRow() <= 0 || 
-                     score_region[id].getNumOfCol() <= 0;
-        if (judge)
+        bool is_outRange = score_region.getNumOfRow() <= 0 || 
+                           score_region.getNumOfCol() <= 0;
+        if (is_outRange)
         {
             n_outRange ++;
             is_select[id] = 0;
+        }
 
-            if (_n_cam_use-n_outRange < 2)
-            {
-                return score * 0.1;
-            } 
+        std::vector<double> otf_param = otf.getOTFParam(cam_id, tr3d._pt_center);
 
-            continue;
-        }
-        
-        // find the peak intensity in score region
-        for (int row = score_region[id].row_min; 
-                 row < score_region[id].row_max; 
-                 row ++)
+        // pixels inside the augmented patch
+        for (int row = aug_region.row_min; row < aug_region.row_max; row ++)
         {
-            for (int col = score_region[id].col_min; 
-                     col < score_region[id].col_max; 
-                     col ++)
+            int i = row - aug_region.row_min;
+            bool is_row_in = !is_outRange && 
+                             row >= score_region.row_min && 
+                             row < score_region.row_max;
+
+            for (int col = aug_region.col_min; col < aug_region.col_max; col ++)
             {
-                int i = row - imgAug_list.region_list[id].row_min;
-                int j = col - imgAug_list.region_list[id].col_min;
+                int j = col - aug_region.col_min;
+                double intensity = aug_img(i, j);
 
-                bool judge = i >= 0 && 
-                             i < imgAug_list.region_list[id].getNumOfRow() &&
-                             j >= 0 && 
-                             j < imgAug_list.region_list[id].getNumOfCol();
-                
-                if (judge)
+                if (is_row_in && 
+                    col >= score_region.col_min && 
+                    col < score_region.col_max)
                 {
-                    peakInt_list[id] = std::max(peakInt_list[id], imgAug_list.img_list[id](i, j));
+                    double value = gaussIntensity(col, row, pt_center, otf_param);
+                    residue += (intensity - value) * (intensity - value);
+
+                    peakInt_list[id] = std::max(peakInt_list[id], intensity);
+                    numerator_list[id] += intensity;
+                    denominator_list[id] += value;
                 }
                 else
                 {
-                    peakInt_list[id] = std::max(peakInt_list[id], _imgRes_list[id](row, col));
+                    residue += intensity * intensity;
                 }
             }
         }
-    }
 
-    // ignore the camera with highest local peak intensity
-    if (_n_cam_use - n_outRange > 2)
-    {
-        int cam_id_ignore = std::max_element(peakInt_list.begin(), peakInt_list.end()) - peakInt_list.begin();
-        is_select[cam_id_ignore] = 0;
-    }
-
-
-    // update score
-    std::vector<double> numerator_list(_n_cam_use, 0);
-    std::vector<double> denominator_list(_n_cam_use, 0);
-    for (int id = 0; id < _n_cam_use; id ++)
-    {
-        if (!is_select[id])
+        // score region pixels outside the patch (tracer moved near the patch edge)
+        bool is_inside = score_region.row_min >= aug_region.row_min &&
+                         score_region.row_max <= aug_region.row_max &&
+                         score_region.col_min >= aug_region.col_min &&
+                         score_region.col_max <= aug_region.col_max;
+        if (is_outRange || is_inside)
         {
             continue;
         }
-
-        std::vector<double> otf_param = otf.getOTFParam(
-            _cam_list.useid_list[id],
-            tr3d._pt_center
-        );
-
-        for (int row = score_region[id].row_min; 
-                 row < score_region[id].row_max; 
-                 row ++)
+        for (int row = score_region.row_min; row < score_region.row_max; row ++)
         {
-            for (int col = score_region[id].col_min; 
-                     col < score_region[id].col_max; 
-                     col ++)
+            for (int col = score_region.col_min; col < score_region.col_max; col ++)
             {
-                int i = row - imgAug_list.region_list[id].row_min;
-                int j = col - imgAug_list.region_list[id].col_min;
-
-                bool judge = i >= 0 && 
-                             i < imgAug_list.region_list[id].getNumOfRow() &&
-                             j >= 0 && 
-                             j < imgAug_list.region_list[id].getNumOfCol();
-
+                bool judge = row >= aug_region.row_min && 
+                             row < aug_region.row_max &&
+                             col >= aug_region.col_min && 
+                             col < aug_region.col_max;
                 if (judge)
                 {
-                    numerator_list[id] += imgAug_list.img_list[id](i, j); 
-                }
-                else
-                {
-                    numerator_list[id] += _imgRes_list[id](row, col);
-                
+                    continue;
                 }
-                
-                denominator_list[id] += gaussIntensity(col, row, tr3d._tr2d_list[id]._pt_center, otf_param);
+
+                double intensity = _imgRes_list[id](row, col);
+                peakInt_list[id] = std::max(peakInt_list[id], intensity);
+                numerator_list[id] += intensity;
+                denominator_list[id] += gaussIntensity(col, row, pt_center, otf_param);
             }
         }
     }
 
+    if (_n_cam_use-n_outRange < 2)
+    {
+        return score * 0.1;
+    }
+
+    // ignore the camera with highest local peak intensity
+    if (_n_cam_use - n_outRange > 2)
+    {
+        int cam_id_ignore = std::max_element(peakInt_list.begin(), peakInt_list.end()) - peakInt_list.begin();
+        is_select[cam_id_ignore] = 0;
+    }
+
     // calculate numerator and denominator
     double numerator = 0.0;     
     double denominator = 0.0;
     for (int id = 0; id < _n_cam_use; id ++)
     {
-        numerator += numerator_list[id];
-        denominator += denominator_list[id];   
+        if (is_select[id])
+        {
+            numerator += numerator_list[id];
+            denominator += denominator_list[id];   
+        }
     }    
     
     if (denominator > SMALLNUMBER)
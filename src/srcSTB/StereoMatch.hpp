@@ -88,14 +88,13 @@ void StereoMatch::saveObjIDMatchList (std::string path)
     std::ofstream file;
     file.open(path, std::ios::out);
 
-    for (int i = 0; i < _objID_match_list.size(); i ++)
-    {
+    writeTextParallel(file, _objID_match_list.size(), [&](TextBuffer& buffer, int i){
         for (int j = 0; j < _n_cam_use-1; j ++)
         {
-            file << _objID_match_list[i][j] << ",";
+            buffer << _objID_match_list[i][j] << ",";
         }
-        file << _objID_match_list[i][_n_cam_use-1] << "\n";
-    }
+        buffer << _objID_match_list[i][_n_cam_use-1] << "\n";
+    });
 
     file.close();
 }
@@ -150,19 +149,19 @@ void StereoMatch::updateObjIDMap (std::vector<std::vector<T2D>> const& obj2d_lis
     int row_id, col_id;
     for (int i = 0; i < _n_cam_use; i ++)
     {  
+        // objects on masked pixels are not put into the map, they are never matched
+        PixelMask const* mask = _cam_list.getMask(_cam_list.useid_list[i]);
         for (int j = 0; j < obj2d_list[i].size(); j ++)
         {
             row_id = obj2d_list[i][j]._pt_center[1]; // img_y
             col_id = obj2d_list[i][j]._pt_center[0]; // img_x
 
-            if (_objID_map_list[i](row_id, col_id)[0] == -1)
+            if (mask != nullptr && (*mask)(row_id, col_id))
             {
-                _objID_map_list[i](row_id, col_id)[0] = j;
-            }
-            else
-            {
-                _objID_map_list[i](row_id, col_id).push_back(j);
+                continue;
             }
+
+            _objID_map_list[i].insert(row_id, col_id, j);
         }
     }
 }
@@ -205,9 +204,16 @@ void StereoMatch::tracerMatch (std::vector<std::vector<Tracer2D>> const& tr2d_li
         // then project 2 line of sights from each particle pair of 1st & 2nd cam onto 3rd cam.
         // particles within torlerance are candidate matches from 3rd cam.
         // repeat similarly for subsequent cams
+        PixelMask const* mask = _cam_list.getMask(_cam_list.useid_list[0]);
+
         #pragma omp for 
         for (int tr_id = 0; tr_id < tr2d_list[0].size(); tr_id ++)
         {
+            if (mask != nullptr && (*mask)(int(tr2d_list[0][tr_id]._pt_center[1]), int(tr2d_list[0][tr_id]._pt_center[0])))
+            {
+                continue;
+            }
+
             std::deque<std::vector<int>> trID_match_list; // match list for the particle i in the first camera
 
             std::vector<int> trID_match; 
@@ -685,10 +691,9 @@ void StereoMatch::saveTracerInfo (std::string path, std::vector<Tracer3D> const&
 
     file.precision(SAVEPRECISION);
 
-    for (int i = 0; i < tr3d_list.size(); i ++)
-    {
-        tr3d_list[i].saveObject3D(file, n_cam_all);
-    }
+    writeTextParallel(file, tr3d_list.size(), [&](TextBuffer& buffer, int i){
+        tr3d_list[i].saveObject3D(buffer, n_cam_all);
+    });
 
     file.close();
 
@@ -903,12 +908,22 @@ void StereoMatch::findTracerMatch (
             return;
         }
 
-        // iterate every pixel in the search region
+        // iterate every pixel in the search region, masked pixels are skipped
         PixelRange search_region = search_output.first;
+        PixelMask const* mask = _cam_list.getMask(_cam_list.useid_list[id]);
         for (int i = search_region.row_min; i < search_region.row_max; i ++)
         {
             for (int j = search_region.col_min; j < search_region.col_max; j ++)
             {
+                if (mask != nullptr)
+                {
+                    j = mask->nextUnmasked(i, j, search_region.col_max);
+                    if (j >= search_region.col_max)
+                    {
+                        break;
+                    }
+                }
+
                 // judge whether the distances between the candidate
                 // and all the lines are all within the range 
                 iterOnObjIDMap (
@@ -1111,14 +1126,12 @@ std::pair<PixelRange, bool> StereoMatch::findSearchRegion (int id, std::vector<L
 {
     PixelRange search_region;
 
-    int n_row = _cam_list.cam_list[_cam_list.useid_list[id]].getNRow();
-    int n_col = _cam_list.cam_list[_cam_list.useid_list[id]].getNCol();
+    // objects are only found inside the roi
+    PixelRange roi = _cam_list.getROI(_cam_list.useid_list[id]);
 
     if (sight2D_list.size() == 1)
     {
-        search_region.row_max = n_row;
-        search_region.col_max = n_col;
-        return std::pair(search_region, true);
+        return std::pair(roi, true);
     }
 
     // Find all crossing points
@@ -1184,10 +1197,10 @@ std::pair<PixelRange, bool> StereoMatch::findSearchRegion (int id, std::vector<L
     // search_region.row_max = std::min(std::max(search_region.row_max, 1), n_row);
     // search_region.col_min = std::min(std::max(search_region.col_min, 0), n_col-1);
     // search_region.col_max = std::min(std::max(search_region.col_max, 1), n_col);
-    search_region.row_min = std::max(search_region.row_min, 0);
-    search_region.row_max = std::min(search_region.row_max, n_row);
-    search_region.col_min = std::max(search_region.col_min, 0);
-    search_region.col_max = std::min(search_region.col_max, n_col);
+    search_region.row_min = std::max(search_region.row_min, roi.row_min);
+    search_region.row_max = std::min(search_region.row_max, roi.row_max);
+    search_region.col_min = std::max(search_region.col_min, roi.col_min);
+    search_region.col_max = std::min(search_region.col_max, roi.col_max);
 
     return std::pair(search_region, true);
 }
@@ -4,52 +4,133 @@
 #include "Track.h"
 
 template<class T3D>
-Track<T3D>::Track(const T3D& obj3d, int t) : _n_obj3d(1) 
+Track<T3D>::Track(const T3D& obj3d, int t)
 { 
-    _obj3d_list.push_back(obj3d); 
-    _t_list.push_back(t); 
+    addNext(obj3d, t);
 }
 
 template<class T3D>
 Track<T3D>::Track(const Track& track) 
-    : _obj3d_list(track._obj3d_list), _t_list(track._t_list), _n_obj3d(track._n_obj3d), _active(track._active) {}
+    : _obj3d_list(track._obj3d_list), _t_list(track._t_list), _n_obj3d(track._n_obj3d), _active(track._active), _track_id(track._track_id),
+      _pt_list(track._pt_list), _error_list(track._error_list), _obs_start(track._obs_start), _obs_camid_list(track._obs_camid_list), _obs_pt_list(track._obs_pt_list) {}
 
 
 template<class T3D>
 void Track<T3D>::addNext(const T3D& obj, int t)
 {
     _obj3d_list.push_back(obj);
+    if (_obj3d_list.size() > LEN_TRACK_LIVE)
+    {
+        _obj3d_list.erase(_obj3d_list.begin());
+    }
     _t_list.push_back(t);
     _n_obj3d ++;
+
+    // compact history
+    _pt_list.push_back(obj._pt_center[0]);
+    _pt_list.push_back(obj._pt_center[1]);
+    _pt_list.push_back(obj._pt_center[2]);
+    _error_list.push_back(obj._error);
+    for (int i = 0; i < obj._n_2d; i ++)
+    {
+        _obs_camid_list.push_back(obj._camid_list[i]);
+        _obs_pt_list.push_back(obj._tr2d_list[i]._pt_center[0]);
+        _obs_pt_list.push_back(obj._tr2d_list[i]._pt_center[1]);
+    }
+    _obs_start.push_back(_obs_camid_list.size());
 }
 
 template<class T3D>
 void Track<T3D>::addNext(const Track& track)
 {
     _obj3d_list.insert(_obj3d_list.end(), track._obj3d_list.begin(), track._obj3d_list.end());
+    if (_obj3d_list.size() > LEN_TRACK_LIVE)
+    {
+        _obj3d_list.erase(_obj3d_list.begin(), _obj3d_list.end() - LEN_TRACK_LIVE);
+    }
     _t_list.insert(_t_list.end(), track._t_list.begin(), track._t_list.end());
-    _n_obj3d = _obj3d_list.size();
+    _n_obj3d += track._n_obj3d;
+
+    _pt_list.insert(_pt_list.end(), track._pt_list.begin(), track._pt_list.end());
+    _error_list.insert(_error_list.end(), track._error_list.begin(), track._error_list.end());
+    int n_obs = _obs_camid_list.size();
+    for (size_t i = 1; i < track._obs_start.size(); i ++)
+    {
+        _obs_start.push_back(n_obs + track._obs_start[i]);
+    }
+    _obs_camid_list.insert(_obs_camid_list.end(), track._obs_camid_list.begin(), track._obs_camid_list.end());
+    _obs_pt_list.insert(_obs_pt_list.end(), track._obs_pt_list.begin(), track._obs_pt_list.end());
+}
+
+template<class T3D>
+T3D Track<T3D>::getObj3D(int i) const
+{
+    T3D obj3d(getPt3D(i));
+    obj3d._error = _error_list[i];
+    for (int k = _obs_start[i]; k < _obs_start[i+1]; k ++)
+    {
+        Tracer2D tr2d(Pt2D(_obs_pt_list[2*k], _obs_pt_list[2*k+1]));
+        tr2d._r_px = obj3d._r2d_px;
+        obj3d.addTracer2D(tr2d, _obs_camid_list[k]);
+    }
+    return obj3d;
 }
 
 template<class T3D>
 void Track<T3D>::saveTrack(std::ofstream& output, int track_id, float fps, int n_cam_all)
+{
+    TextBuffer buffer(output);
+    saveTrack(buffer, track_id, fps, n_cam_all);
+    output << buffer._str;
+}
+
+template<class T3D>
+void Track<T3D>::saveTrack(TextBuffer& output, int track_id, float fps, int n_cam_all)
 {    
-    if (_n_obj3d != _obj3d_list.size())
+    if (size_t(_n_obj3d) != _t_list.size() || size_t(3*_n_obj3d) != _pt_list.size())
     {
-        std::cerr << "Track<Tracer3D>::saveTrack error at line " << __LINE__ << ": _n_obj3d != _obj3d_list.size()" << std::endl;
+        std::cerr << "Track<Tracer3D>::saveTrack error at line " << __LINE__ << ": _n_obj3d != _t_list.size()" << std::endl;
         std::cerr << "track_id: " << track_id << std::endl;
         std::cerr << "_n_obj3d: " << _n_obj3d << std::endl;
-        std::cerr << "_obj3d_list.size(): " << _obj3d_list.size() << std::endl;
+        std::cerr << "_t_list.size(): " << _t_list.size() << std::endl;
         return;
     }
 
+    // same layout as Tracer3D::saveObject3D
+    std::vector<double> pt2d_list(n_cam_all*2);
     for (int i = 0; i < _n_obj3d; i ++)
     {
         output << track_id << "," << _t_list[i]/fps << ",";
 
+        int n_2d = _obs_start[i+1] - _obs_start[i];
+        output << _pt_list[3*i] << "," << _pt_list[3*i+1] << "," << _pt_list[3*i+2] << "," << _error_list[i] << "," << n_2d;
+
         // print 2d info
-        _obj3d_list[i].saveObject3D(output, n_cam_all);
+        std::fill(pt2d_list.begin(), pt2d_list.end(), IMGPTINIT);
+        for (int k = _obs_start[i]; k < _obs_start[i+1]; k ++)
+        {
+            pt2d_list[_obs_camid_list[k]*2] = _obs_pt_list[2*k];
+            pt2d_list[_obs_camid_list[k]*2+1] = _obs_pt_list[2*k+1];
+        }
+        for (int j = 0; j < n_cam_all; j ++)
+        {
+            output << "," << pt2d_list[j*2] << "," << pt2d_list[j*2+1];
+        }
+        output << "\n";
+    }
+}
+
+template<class T3D>
+void Track<T3D>::saveTrack(TrackFileWriter& output, int track_id)
+{
+    if (size_t(_n_obj3d) != _t_list.size() || size_t(3*_n_obj3d) != _pt_list.size())
+    {
+        std::cerr << "Track<Tracer3D>::saveTrack error at line " << __LINE__ << ": _n_obj3d != _t_list.size()" << std::endl;
+        std::cerr << "track_id: " << track_id << std::endl;
+        return;
     }
+
+    output.addTrack(track_id, _n_obj3d, _t_list.data(), _pt_list.data(), _error_list.data(), _obs_start.data(), _obs_camid_list.data(), _obs_pt_list.data());
 }
 
 template<class T3D>
@@ -59,6 +140,12 @@ Track<T3D>& Track<T3D>::operator=(const Track<T3D>& track)
     _t_list = track._t_list;
     _n_obj3d = track._n_obj3d;
     _active = track._active;
+    _track_id = track._track_id;
+    _pt_list = track._pt_list;
+    _error_list = track._error_list;
+    _obs_start = track._obs_start;
+    _obs_camid_list = track._obs_camid_list;
+    _obs_pt_list = track._obs_pt_list;
     return *this;
 }
 
@@ -75,103 +162,464 @@ void Track<T3D>::predictNext(T3D& obj3d)
     }
 }
 
+inline double predWienerAxis (double const* x, int stride, int order)
+{
+    // Wiener filter does badly near zero
+    // Make a shift to avoid zero-plane prediction
+    double shift = std::fabs(x[order*stride]) < 1 ? 10 : 0;
+
+    // The LMS update with step 1/|x|^2 starting from zero converges in one step
+    //  to the minimum norm solution: filter_param = x * x[order] / |x|^2
+    double sum = 0;
+    double cross = 0;
+    for (int j = 0; j < order; j ++)
+    {
+        double xj = x[j*stride] + shift;
+        sum += xj * xj;
+        cross += xj * (x[(j+1)*stride] + shift);
+    }
+
+    double prediction = cross * (x[order*stride] + shift) / sum;
+    return prediction - shift;
+}
+
+
 template<class T3D>
 void Track<T3D>::predLMSWiener(T3D& obj3d)
 {
-    int order = 0;
-
     if (_n_obj3d < 3)
     {
         std::cerr << "Track<T3D>::predLMSWiener error at line " << __LINE__ << ": no enough points to predict " << _n_obj3d << "<" << 3 << std::endl;
         return;
     }
-    else if (_n_obj3d < 4)
+    int order = std::min(_n_obj3d-1, 5);
+
+    // predict at each direction
+    std::vector<double> series (order+1, 0);
+    for (int i = 0; i < 3; i ++)
+    {
+        for (int j = 0; j < order+1; j ++)
+        {
+            series[j] = _pt_list[3*(_n_obj3d-1-order + j) + i];
+        }
+        obj3d._pt_center[i] = predWienerAxis(series.data(), 1, order);
+    } 
+
+    if (typeid(T3D) == typeid(Tracer3D))
+    {
+        obj3d._r2d_px = _obj3d_list.back()._r2d_px;
+    } 
+    else
+    {
+        std::cerr << "Error: predictNext not implemented for this type" << std::endl;
+    }
+
+}
+
+
+//                   //
+// TrackPredictor    //
+//                   //
+
+template<class T3D>
+void TrackPredictor<T3D>::predict (std::vector<T3D>& obj3d_list_pred, std::deque<Track<T3D>> const& track_list, bool is_cal_stats)
+{
+    if (typeid(T3D) != typeid(Tracer3D))
+    {
+        std::cerr << "TrackPredictor<T3D>::predict error at line " << __LINE__ << ":\n"
+                  << "predict not implemented for this type" << std::endl;
+        throw error_type;
+    }
+
+    _n_track = track_list.size();
+    _n_hist = std::max(6, _param.n_hist); // Wiener uses up to 6 points
+    if (_param.type == PRED_POLY && int(_poly_coeff.size()) != _n_hist+1)
     {
-        order = 3;
+        calPolyCoeff();
+    }
+
+    // hindcast residual statistics
+    if (is_cal_stats)
+    {
+        gather(track_list, 1);
+        run();
+
+        _stats = TrackPredStats();
+        double sum = 0, sum2 = 0;
+        for (int i = 0; i < _n_track; i ++)
+        {
+            if (_len_list[i] < 3)
+            {
+                continue;
+            }
+
+            double const* pt_last = &track_list[i]._pt_list[3*(track_list[i]._n_obj3d-1)];
+            double dx = _pred[i] - pt_last[0];
+            double dy = _pred[_n_track + i] - pt_last[1];
+            double dz = _pred[2*_n_track + i] - pt_last[2];
+            double res = std::sqrt(dx*dx + dy*dy + dz*dz);
+
+            _stats.n_track ++;
+            sum += res;
+            sum2 += res * res;
+            _stats.max = std::max(_stats.max, res);
+        }
+        if (_stats.n_track > 0)
+        {
+            _stats.mean = sum / _stats.n_track;
+            _stats.rms = std::sqrt(sum2 / _stats.n_track);
+        }
     }
-    else if (_n_obj3d < 6)
+
+    // prediction
+    gather(track_list, 0);
+    run();
+
+    obj3d_list_pred.resize(_n_track);
+    for (int i = 0; i < _n_track; i ++)
     {
-        order = _n_obj3d - 1;
+        if (_len_list[i] < 3)
+        {
+            std::cerr << "TrackPredictor<T3D>::predict error at line " << __LINE__ << ": no enough points to predict " << _len_list[i] << "<" << 3 << std::endl;
+            continue;
+        }
+        obj3d_list_pred[i]._pt_center[0] = _pred[i];
+        obj3d_list_pred[i]._pt_center[1] = _pred[_n_track + i];
+        obj3d_list_pred[i]._pt_center[2] = _pred[2*_n_track + i];
+        obj3d_list_pred[i]._r2d_px = track_list[i]._obj3d_list.back()._r2d_px;
     }
-    else 
+}
+
+
+template<class T3D>
+void TrackPredictor<T3D>::gather (std::deque<Track<T3D>> const& track_list, int n_skip)
+{
+    _len_list.resize(_n_track);
+    _hist.assign(3 * _n_hist * _n_track, 0);
+
+    #pragma omp parallel for
+    for (int i = 0; i < _n_track; i ++)
     {
-        order = 5;
+        int n_obj3d = track_list[i]._n_obj3d - n_skip;
+        int len = std::max(0, std::min(n_obj3d, _n_hist));
+        _len_list[i] = len;
+
+        double const* pt = &track_list[i]._pt_list[3*(n_obj3d-len)];
+        for (int k = 0; k < len; k ++)
+        {
+            int kk = _n_hist - len + k;
+            _hist[kk*_n_track + i] = pt[3*k];
+            _hist[(_n_hist + kk)*_n_track + i] = pt[3*k+1];
+            _hist[(2*_n_hist + kk)*_n_track + i] = pt[3*k+2];
+        }
     }
+}
 
-    // predict at each direction
-    std::vector<double> series (order+1, 0);
-    std::vector<double> filter_param (order, 0);
-    for (int i = 0; i < 3; i ++)
+
+template<class T3D>
+void TrackPredictor<T3D>::run ()
+{
+    _pred.assign(3 * _n_track, 0);
+
+    switch (_param.type)
     {
-        for (int j = 0; j < order+1; j ++)
+    case PRED_POLY:
+        predPoly();
+        break;
+    case PRED_KALMAN:
+        predKalman();
+        break;
+    default:
+        predWiener();
+        break;
+    }
+}
+
+
+template<class T3D>
+void TrackPredictor<T3D>::predWiener ()
+{
+    for (int axis = 0; axis < 3; axis ++)
+    {
+        #pragma omp parallel for
+        for (int i = 0; i < _n_track; i ++)
         {
-            series[j] = _obj3d_list[_n_obj3d-1-order + j]._pt_center[i];
+            int len = _len_list[i];
+            if (len < 3)
+            {
+                continue;
+            }
+            int order = std::min(len-1, 5);
+            double const* x = &_hist[(axis*_n_hist + _n_hist-1-order)*_n_track + i];
+            _pred[axis*_n_track + i] = predWienerAxis(x, _n_track, order);
         }
-        
-        // Wiener filter does badly near zero
-        // Make a shift to avoid zero-plane prediction
-        bool shift_label = false;
-        double shift = 10;
-        if (std::fabs(series[order]) < 1)
+    }
+}
+
+
+template<class T3D>
+void TrackPredictor<T3D>::calPolyCoeff ()
+{
+    // Least-squares fit of order p on t = -(n-1),...,0, evaluated at t = 1
+    //  the prediction is linear in the history: pred = sum(coeff[k] * x[k])
+    _poly_coeff.assign(_n_hist+1, std::vector<double>());
+    for (int n = 2; n <= _n_hist; n ++)
+    {
+        int p = std::max(1, std::min(_param.poly_order, n-1));
+        Matrix<double> mtx_t(n, p+1, 0);
+        for (int k = 0; k < n; k ++)
         {
-            shift_label = true;
-            for (int j = 0; j < order+1; j ++)
+            double t = k - (n-1);
+            for (int j = 0; j <= p; j ++)
             {
-                series[j] += shift;
+                mtx_t(k, j) = std::pow(t, j);
             }
         }
-        
-        // calculate the step
-        double sum = 0;
-        for (int j = 0; j < order; j ++)
+        Matrix<double> mtx_tt = mtx_t.transpose();
+        Matrix<double> mtx_inv = myMATH::inverse(mtx_tt * mtx_t);
+        Matrix<double> t_next(1, p+1, 1);
+        Matrix<double> coeff = t_next * mtx_inv * mtx_tt;
+
+        _poly_coeff[n].resize(n);
+        for (int k = 0; k < n; k ++)
         {
-            sum += (series[j] * series[j]);
+            _poly_coeff[n][k] = coeff(0, k);
         }
-        double step = 1 / sum;
+    }
+}
 
-        // initialize the filter param
-        std::fill(filter_param.begin(), filter_param.end(), 0);
-        double prediction = 0;
-        double error = series[order] - prediction;
 
-        int iter = 0;
-        while (std::fabs(error) > SMALLNUMBER && iter < WIENER_MAX_ITER)
-        // while (std::fabs(error) > SMALLNUMBER)
+template<class T3D>
+void TrackPredictor<T3D>::predPoly ()
+{
+    int n_use = std::max(3, std::min(_param.n_hist, _n_hist));
+    for (int axis = 0; axis < 3; axis ++)
+    {
+        #pragma omp parallel for
+        for (int i = 0; i < _n_track; i ++)
         {
-            // Update parameters and calculate the prediction using the new filter param
-            prediction = 0;
-            for (int j = 0; j < order; j ++)
+            int len = std::min(_len_list[i], n_use);
+            if (len < 3)
             {
-                filter_param[j] += (step * series[j] * error);
-                prediction += (filter_param[j] * series[j]);
+                continue;
             }
 
-            error = series[order] - prediction;
-            iter ++;
+            std::vector<double> const& coeff = _poly_coeff[len];
+            double const* x = &_hist[(axis*_n_hist + _n_hist-len)*_n_track + i];
+            double prediction = 0;
+            for (int k = 0; k < len; k ++)
+            {
+                prediction += coeff[k] * x[k*_n_track];
+            }
+            _pred[axis*_n_track + i] = prediction;
         }
-        // std::cout << "Prediction iter: " << iter << std::endl;
+    }
+}
 
-        prediction = 0;
-        for (int j = 0; j < order; j ++)
+
+template<class T3D>
+void TrackPredictor<T3D>::predKalman ()
+{
+    // state s = [x, v, a], dt = 1 frame
+    //  F = [1 1 0.5; 0 1 1; 0 0 1], H = [1 0 0], Q = q * g * g^T, g = [1/6 1/2 1]
+    double const q = _param.kalman_q;
+    double const r = _param.kalman_r;
+    double const g[3] = {1.0/6, 0.5, 1};
+    int n_use = std::max(3, std::min(_param.n_hist, _n_hist));
+
+    for (int axis = 0; axis < 3; axis ++)
+    {
+        #pragma omp parallel for
+        for (int i = 0; i < _n_track; i ++)
         {
-            prediction += (filter_param[j] * series[j+1]);
+            int len = std::min(_len_list[i], n_use);
+            if (len < 3)
+            {
+                continue;
+            }
+            double const* x = &_hist[(axis*_n_hist + _n_hist-len)*_n_track + i];
+
+            // initialize from the first three points (second order differences)
+            double s[3] = {
+                x[2*_n_track], 
+                1.5*x[2*_n_track] - 2*x[_n_track] + 0.5*x[0], 
+                x[2*_n_track] - 2*x[_n_track] + x[0]
+            };
+            double P[3][3] = {
+                {r, 1.5*r, r}, 
+                {1.5*r, 6.5*r, 6*r}, 
+                {r, 6*r, 6*r}
+            };
+
+            for (int k = 3; k < len; k ++)
+            {
+                // predict: s = F s, P = F P F^T + Q
+                double sp[3] = {s[0] + s[1] + 0.5*s[2], s[1] + s[2], s[2]};
+                double FP[3][3];
+                for (int c = 0; c < 3; c ++)
+                {
+                    FP[0][c] = P[0][c] + P[1][c] + 0.5*P[2][c];
+                    FP[1][c] = P[1][c] + P[2][c];
+                    FP[2][c] = P[2][c];
+                }
+                double Pp[3][3];
+                for (int rr = 0; rr < 3; rr ++)
+                {
+                    Pp[rr][0] = FP[rr][0] + FP[rr][1] + 0.5*FP[rr][2] + q*g[rr]*g[0];
+                    Pp[rr][1] = FP[rr][1] + FP[rr][2] + q*g[rr]*g[1];
+                    Pp[rr][2] = FP[rr][2] + q*g[rr]*g[2];
+                }
+
+                // update with measurement x[k]
+                double innov = x[k*_n_track] - sp[0];
+                double S = Pp[0][0] + r;
+                double K[3] = {Pp[0][0]/S, Pp[1][0]/S, Pp[2][0]/S};
+                for (int rr = 0; rr < 3; rr ++)
+                {
+                    s[rr] = sp[rr] + K[rr] * innov;
+                    for (int c = 0; c < 3; c ++)
+                    {
+                        P[rr][c] = Pp[rr][c] - K[rr] * Pp[0][c];
+                    }
+                }
+            }
+
+            _pred[axis*_n_track + i] = s[0] + s[1] + 0.5*s[2];
         }
-        if (shift_label)
+    }
+}
+
+
+template<class T3D>
+void TrackWriter<T3D>::open (std::string const& file, float fps, int n_cam_all)
+{
+    close();
+
+    _file = file;
+    _fps = fps;
+    _n_cam_all = n_cam_all;
+    _n_track = 0;
+
+    _is_bin = isTrackFileBin(file);
+    if (_is_bin)
+    {
+        _output_bin.open(file, fps, n_cam_all);
+        _is_stop = false;
+        _is_open = true;
+        _thread = std::thread(&TrackWriter<T3D>::run, this);
+        return;
+    }
+
+    _output.open(file, std::ios::out);
+    if (!_output.is_open())
+    {
+        std::cerr << "TrackWriter<T3D>::open error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << file << std::endl;
+        throw error_io;
+    }
+
+    _output << "TrackID,FrameID,WorldX,WorldY,WorldZ,Error,Ncam";
+    for (int i = 0; i < _n_cam_all; i ++)
+    {
+        _output << ",cam" << i << "_x(col),cam" << i << "_y(row)";
+    }
+    _output << "\n";
+    _output.flush();
+
+    _is_stop = false;
+    _is_open = true;
+    _thread = std::thread(&TrackWriter<T3D>::run, this);
+}
+
+template<class T3D>
+void TrackWriter<T3D>::push (std::deque<Track<T3D>>& track_list)
+{
+    if (!_is_open)
+    {
+        std::cerr << "TrackWriter<T3D>::push error at line " << __LINE__ << ":\n"
+                  << "Writer is not open." << std::endl;
+        throw error_io;
+    }
+
+    if (track_list.empty())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = 0; i < track_list.size(); i ++)
         {
-            prediction -= shift;
+            _queue.push_back(std::move(track_list[i]));
         }
-        obj3d._pt_center[i] = prediction;
-    } 
+    }
+    _n_track += track_list.size();
+    track_list.clear();
+    _cv.notify_one();
+}
 
-    if (typeid(T3D) == typeid(Tracer3D))
+template<class T3D>
+void TrackWriter<T3D>::close ()
+{
+    if (!_is_open)
     {
-        obj3d._r2d_px = _obj3d_list[_n_obj3d-1]._r2d_px;
-    } 
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _is_stop = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+
+    if (_is_bin)
+    {
+        _output_bin.close();
+    }
     else
     {
-        std::cerr << "Error: predictNext not implemented for this type" << std::endl;
+        _output.close();
     }
+    _is_open = false;
+}
+
+template<class T3D>
+void TrackWriter<T3D>::run ()
+{
+    std::deque<Track<T3D>> batch;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this]{ return _is_stop || !_queue.empty(); });
+            if (_queue.empty())
+            {
+                // _is_stop and nothing left to write
+                return;
+            }
+            batch.swap(_queue);
+        }
 
+        if (_is_bin)
+        {
+            for (size_t i = 0; i < batch.size(); i ++)
+            {
+                batch[i].saveTrack(_output_bin, batch[i]._track_id);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < batch.size(); i ++)
+            {
+                batch[i].saveTrack(_output, batch[i]._track_id, _fps, _n_cam_all);
+            }
+            _output.flush();
+        }
+
+        // release track memory
+        batch.clear();
+    }
 }
 
 #endif
\ No newline at end of file
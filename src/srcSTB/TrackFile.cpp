@@ -0,0 +1,482 @@
+#include "TrackFile.h"
+#include "TextIO.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+static_assert(sizeof(TrackFileHeader) == 64, "TrackFileHeader must be 64 bytes");
+static_assert(sizeof(TrackChunkInfo) == 56, "TrackChunkInfo must be 56 bytes");
+static_assert(sizeof(TrackChunkHeader) == 64, "TrackChunkHeader must be 64 bytes");
+
+// size of a block padded to 8 bytes
+static inline uint64_t alignBlock (uint64_t n_byte)
+{
+    return (n_byte + 7) / 8 * 8;
+}
+
+// size of the chunk columns
+static uint64_t getChunkSize (TrackChunkInfo const& info)
+{
+    return alignBlock(info.n_track * sizeof(int64_t))
+         + alignBlock((info.n_track+1) * sizeof(int64_t))
+         + alignBlock(info.n_pt * sizeof(int32_t))
+         + 4 * info.n_pt * sizeof(double)
+         + alignBlock((info.n_pt+1) * sizeof(int32_t))
+         + alignBlock(info.n_obs * sizeof(int32_t))
+         + 2 * info.n_obs * sizeof(double);
+}
+
+// true if the counts fit TrackChunk and the chunk columns end before data_end
+static bool isChunkInRange (TrackChunkInfo const& info, uint64_t data_end)
+{
+    uint64_t n_max = std::numeric_limits<int32_t>::max();
+    if (info.n_track > n_max || info.n_pt > n_max || info.n_obs > n_max)
+    {
+        return false;
+    }
+    return info.offset >= sizeof(TrackFileHeader) + sizeof(TrackChunkHeader) 
+        && info.offset <= data_end 
+        && getChunkSize(info) <= data_end - info.offset;
+}
+
+
+bool isTrackFileBin (std::string const& file)
+{
+    std::string ext = ".lpt";
+    return file.size() >= ext.size() && file.compare(file.size()-ext.size(), ext.size(), ext) == 0;
+}
+
+
+//////////////////////////////////////////////////
+// TrackFileWriter
+//////////////////////////////////////////////////
+
+void TrackFileWriter::open (std::string const& file, float fps, int n_cam_all, int chunk_size)
+{
+    close();
+
+    _output.open(file, std::ios::out | std::ios::binary);
+    if (!_output.is_open())
+    {
+        std::cerr << "TrackFileWriter::open error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << file << std::endl;
+        throw error_io;
+    }
+
+    _header = TrackFileHeader();
+    _header.n_cam_all = n_cam_all;
+    _header.fps = fps;
+    _index.clear();
+    _chunk_size = std::max(chunk_size, 1);
+
+    // header is rewritten by close()
+    _offset = 0;
+    writeBlock(&_header, sizeof(TrackFileHeader));
+    _output.flush();
+}
+
+
+void TrackFileWriter::addTrack (int64_t track_id, int n_pt, int const* t_list, double const* pt_list, double const* error_list, int const* obs_start, int const* obs_camid_list, double const* obs_pt_list)
+{
+    if (!_output.is_open())
+    {
+        std::cerr << "TrackFileWriter::addTrack error at line " << __LINE__ << ":\n"
+                  << "Writer is not open." << std::endl;
+        throw error_io;
+    }
+
+    _track_id.push_back(track_id);
+    _track_start.push_back(_track_start.back() + n_pt);
+
+    int obs_offset = _obs_cam.size() - obs_start[0];
+    for (int i = 0; i < n_pt; i ++)
+    {
+        _frame.push_back(t_list[i]);
+        _x.push_back(pt_list[3*i]);
+        _y.push_back(pt_list[3*i+1]);
+        _z.push_back(pt_list[3*i+2]);
+        _error.push_back(error_list[i]);
+        _obs_start.push_back(obs_start[i+1] + obs_offset);
+    }
+    for (int k = obs_start[0]; k < obs_start[n_pt]; k ++)
+    {
+        _obs_cam.push_back(obs_camid_list[k]);
+        _obs_x.push_back(obs_pt_list[2*k]);
+        _obs_y.push_back(obs_pt_list[2*k+1]);
+    }
+
+    if (_frame.size() >= size_t(_chunk_size))
+    {
+        flush();
+    }
+}
+
+
+void TrackFileWriter::flush ()
+{
+    if (!_output.is_open())
+    {
+        return;
+    }
+
+    if (!_track_id.empty())
+    {
+        TrackChunkInfo info;
+        info.offset = _offset + sizeof(TrackChunkHeader);
+        info.n_track = _track_id.size();
+        info.n_pt = _frame.size();
+        info.n_obs = _obs_cam.size();
+        info.track_id_min = *std::min_element(_track_id.begin(), _track_id.end());
+        info.track_id_max = *std::max_element(_track_id.begin(), _track_id.end());
+        if (info.n_pt > 0)
+        {
+            info.frame_min = *std::min_element(_frame.begin(), _frame.end());
+            info.frame_max = *std::max_element(_frame.begin(), _frame.end());
+        }
+
+        // the chunk header lets the reader recover a file that was not closed
+        TrackChunkHeader chunk_header;
+        chunk_header.info = info;
+        writeBlock(&chunk_header, sizeof(TrackChunkHeader));
+
+        writeBlock(_track_id.data(), _track_id.size() * sizeof(int64_t));
+        writeBlock(_track_start.data(), _track_start.size() * sizeof(int64_t));
+        writeBlock(_frame.data(), _frame.size() * sizeof(int32_t));
+        writeBlock(_x.data(), _x.size() * sizeof(double));
+        writeBlock(_y.data(), _y.size() * sizeof(double));
+        writeBlock(_z.data(), _z.size() * sizeof(double));
+        writeBlock(_error.data(), _error.size() * sizeof(double));
+        writeBlock(_obs_start.data(), _obs_start.size() * sizeof(int32_t));
+        writeBlock(_obs_cam.data(), _obs_cam.size() * sizeof(int32_t));
+        writeBlock(_obs_x.data(), _obs_x.size() * sizeof(double));
+        writeBlock(_obs_y.data(), _obs_y.size() * sizeof(double));
+
+        _index.push_back(info);
+        _header.n_chunk ++;
+        _header.n_track += info.n_track;
+        _header.n_pt += info.n_pt;
+
+        _track_id.clear();
+        _track_start.assign(1, 0);
+        _frame.clear();
+        _x.clear(); _y.clear(); _z.clear(); _error.clear();
+        _obs_start.assign(1, 0);
+        _obs_cam.clear();
+        _obs_x.clear(); _obs_y.clear();
+    }
+
+    _output.flush();
+}
+
+
+void TrackFileWriter::close ()
+{
+    if (!_output.is_open())
+    {
+        return;
+    }
+
+    flush();
+
+    _header.index_offset = _offset;
+    writeBlock(_index.data(), _index.size() * sizeof(TrackChunkInfo));
+
+    _output.seekp(0);
+    _output.write(reinterpret_cast<char const*>(&_header), sizeof(TrackFileHeader));
+    _output.close();
+}
+
+
+void TrackFileWriter::writeBlock (void const* data, size_t n_byte)
+{
+    static char const zeros[8] = {0};
+    uint64_t n_pad = alignBlock(n_byte) - n_byte;
+
+    if (n_byte > 0)
+    {
+        _output.write(reinterpret_cast<char const*>(data), n_byte);
+    }
+    _output.write(zeros, n_pad);
+    _offset += n_byte + n_pad;
+
+    if (!_output.good())
+    {
+        std::cerr << "TrackFileWriter::writeBlock error at line " << __LINE__ << ":\n"
+                  << "Fail to write " << n_byte << " bytes." << std::endl;
+        throw error_io;
+    }
+}
+
+
+//////////////////////////////////////////////////
+// TrackFileReader
+//////////////////////////////////////////////////
+
+TrackFileReader::TrackFileReader (std::string const& file) : _file(file), _map(file)
+{
+    _data = _map.data();
+    _size = _map.size();
+
+    // header
+    if (_size < sizeof(TrackFileHeader))
+    {
+        std::cerr << "TrackFileReader::TrackFileReader error at line " << __LINE__ << ":\n"
+                  << file << " is too small to be a track file." << std::endl;
+        throw error_io;
+    }
+    std::memcpy(&_header, _data, sizeof(TrackFileHeader));
+
+    if (std::strncmp(_header.magic, TRACKFILE_MAGIC, 8) != 0 || _header.version != TRACKFILE_VERSION)
+    {
+        std::cerr << "TrackFileReader::TrackFileReader error at line " << __LINE__ << ":\n"
+                  << file << " is not a track file of version " << TRACKFILE_VERSION << "." << std::endl;
+        throw error_type;
+    }
+
+    if (_header.index_offset == 0)
+    {
+        scanChunk();
+    }
+    else
+    {
+        if (_header.index_offset > _size || _header.n_chunk > (_size - _header.index_offset) / sizeof(TrackChunkInfo))
+        {
+            std::cerr << "TrackFileReader::TrackFileReader error at line " << __LINE__ << ":\n"
+                      << "Chunk index of " << file << " is out of range." << std::endl;
+            throw error_range;
+        }
+
+        // chunk index
+        _index.resize(_header.n_chunk);
+        std::memcpy(_index.data(), _data + _header.index_offset, _header.n_chunk * sizeof(TrackChunkInfo));
+    }
+
+    uint64_t data_end = _header.index_offset == 0 ? _size : _header.index_offset;
+    for (size_t i = 0; i < _index.size(); i ++)
+    {
+        TrackChunkInfo const& info = _index[i];
+        if (!isChunkInRange(info, data_end) 
+            || std::strncmp(_data + info.offset - sizeof(TrackChunkHeader), TRACKFILE_CHUNK_MAGIC, 8) != 0)
+        {
+            std::cerr << "TrackFileReader::TrackFileReader error at line " << __LINE__ << ":\n"
+                      << "Chunk " << i << " of " << file << " is out of range." << std::endl;
+            throw error_range;
+        }
+    }
+}
+
+
+void TrackFileReader::scanChunk ()
+{
+    _index.clear();
+    _header.n_track = 0;
+    _header.n_pt = 0;
+
+    uint64_t offset = sizeof(TrackFileHeader);
+    while (offset + sizeof(TrackChunkHeader) <= _size)
+    {
+        TrackChunkHeader chunk_header;
+        std::memcpy(&chunk_header, _data + offset, sizeof(TrackChunkHeader));
+        TrackChunkInfo const& info = chunk_header.info;
+
+        // the last chunk can be partly written
+        if (std::strncmp(chunk_header.magic, TRACKFILE_CHUNK_MAGIC, 8) != 0 
+            || info.offset != offset + sizeof(TrackChunkHeader) 
+            || !isChunkInRange(info, _size))
+        {
+            break;
+        }
+
+        _index.push_back(info);
+        _header.n_track += info.n_track;
+        _header.n_pt += info.n_pt;
+        offset = info.offset + getChunkSize(info);
+    }
+    _header.n_chunk = _index.size();
+
+    std::cout << "TrackFileReader::scanChunk warning: " << _file << " was not closed, " 
+              << _index.size() << " chunks are recovered." << std::endl;
+}
+
+
+TrackChunk TrackFileReader::getChunk (int chunk_id) const
+{
+    if (chunk_id < 0 || chunk_id >= int(_index.size()))
+    {
+        std::cerr << "TrackFileReader::getChunk error at line " << __LINE__ << ":\n"
+                  << "Chunk ID " << chunk_id << " is out of range: 0 ~ " << int(_index.size())-1 << std::endl;
+        throw error_range;
+    }
+
+    TrackChunkInfo const& info = _index[chunk_id];
+    TrackChunk chunk;
+    chunk.n_track = info.n_track;
+    chunk.n_pt = info.n_pt;
+    chunk.n_obs = info.n_obs;
+
+    char const* ptr = _data + info.offset;
+    chunk.track_id = reinterpret_cast<int64_t const*>(ptr);
+    ptr += alignBlock(info.n_track * sizeof(int64_t));
+    chunk.track_start = reinterpret_cast<int64_t const*>(ptr);
+    ptr += alignBlock((info.n_track+1) * sizeof(int64_t));
+    chunk.frame = reinterpret_cast<int32_t const*>(ptr);
+    ptr += alignBlock(info.n_pt * sizeof(int32_t));
+    chunk.x = reinterpret_cast<double const*>(ptr);
+    ptr += info.n_pt * sizeof(double);
+    chunk.y = reinterpret_cast<double const*>(ptr);
+    ptr += info.n_pt * sizeof(double);
+    chunk.z = reinterpret_cast<double const*>(ptr);
+    ptr += info.n_pt * sizeof(double);
+    chunk.error = reinterpret_cast<double const*>(ptr);
+    ptr += info.n_pt * sizeof(double);
+    chunk.obs_start = reinterpret_cast<int32_t const*>(ptr);
+    ptr += alignBlock((info.n_pt+1) * sizeof(int32_t));
+    chunk.obs_cam = reinterpret_cast<int32_t const*>(ptr);
+    ptr += alignBlock(info.n_obs * sizeof(int32_t));
+    chunk.obs_x = reinterpret_cast<double const*>(ptr);
+    ptr += info.n_obs * sizeof(double);
+    chunk.obs_y = reinterpret_cast<double const*>(ptr);
+
+    // the arrays index each other, a corrupt chunk must not be read out of range
+    bool is_valid = chunk.track_start[0] == 0 && chunk.track_start[chunk.n_track] == chunk.n_pt 
+                 && chunk.obs_start[0] == 0 && chunk.obs_start[chunk.n_pt] == chunk.n_obs;
+    for (int i = 0; is_valid && i < chunk.n_track; i ++)
+    {
+        is_valid = chunk.track_start[i] <= chunk.track_start[i+1];
+    }
+    for (int j = 0; is_valid && j < chunk.n_pt; j ++)
+    {
+        is_valid = chunk.obs_start[j] <= chunk.obs_start[j+1];
+    }
+    for (int k = 0; is_valid && k < chunk.n_obs; k ++)
+    {
+        is_valid = chunk.obs_cam[k] >= 0 && chunk.obs_cam[k] < int(_header.n_cam_all);
+    }
+    if (!is_valid)
+    {
+        std::cerr << "TrackFileReader::getChunk error at line " << __LINE__ << ":\n"
+                  << "Chunk " << chunk_id << " of " << _file << " has inconsistent track, point or camera indices." << std::endl;
+        throw error_range;
+    }
+
+    return chunk;
+}
+
+
+//////////////////////////////////////////////////
+// csv converter
+//////////////////////////////////////////////////
+
+void convertTrackBinToCSV (std::string const& file_bin, std::string const& file_csv)
+{
+    TrackFileReader reader(file_bin);
+
+    std::ofstream output(file_csv, std::ios::out);
+    if (!output.is_open())
+    {
+        std::cerr << "convertTrackBinToCSV error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << file_csv << std::endl;
+        throw error_io;
+    }
+
+    int n_cam_all = reader.getNumOfCam();
+    float fps = reader.getFPS();
+
+    output << "TrackID,FrameID,WorldX,WorldY,WorldZ,Error,Ncam";
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        output << ",cam" << i << "_x(col),cam" << i << "_y(row)";
+    }
+    output << "\n";
+
+    std::vector<double> pt2d_list(n_cam_all*2);
+    for (int c = 0; c < reader.getNumOfChunk(); c ++)
+    {
+        TrackChunk chunk = reader.getChunk(c);
+        for (int i = 0; i < chunk.n_track; i ++)
+        {
+            for (int64_t j = chunk.track_start[i]; j < chunk.track_start[i+1]; j ++)
+            {
+                output << chunk.track_id[i] << "," << chunk.frame[j]/fps << ",";
+                output << chunk.x[j] << "," << chunk.y[j] << "," << chunk.z[j] << "," << chunk.error[j] << "," << chunk.obs_start[j+1] - chunk.obs_start[j];
+
+                std::fill(pt2d_list.begin(), pt2d_list.end(), IMGPTINIT);
+                for (int k = chunk.obs_start[j]; k < chunk.obs_start[j+1]; k ++)
+                {
+                    pt2d_list[chunk.obs_cam[k]*2] = chunk.obs_x[k];
+                    pt2d_list[chunk.obs_cam[k]*2+1] = chunk.obs_y[k];
+                }
+                for (int k = 0; k < n_cam_all; k ++)
+                {
+                    output << "," << pt2d_list[k*2] << "," << pt2d_list[k*2+1];
+                }
+                output << "\n";
+            }
+        }
+    }
+
+    output.close();
+}
+
+
+void convertTrackCSVToBin (std::string const& file_csv, std::string const& file_bin, float fps)
+{
+    std::ifstream input(file_csv, std::ios::in);
+    if (!input.is_open())
+    {
+        std::cerr << "convertTrackCSVToBin error at line " << __LINE__ << ":\n"
+                  << "Cannot open file " << file_csv << std::endl;
+        throw error_io;
+    }
+
+    // number of cameras from the header: 7 columns + 2 per camera
+    std::string line;
+    std::getline(input, line);
+    input.close();
+    int n_col = std::count(line.begin(), line.end(), ',') + 1;
+    int n_cam_all = std::max((n_col - 7) / 2, 0);
+
+    std::vector<double> data;
+    int n_row = readCSV(data, n_col, file_csv, 1);
+
+    TrackFileWriter writer;
+    writer.open(file_bin, fps, n_cam_all);
+
+    // one track at a time
+    std::vector<int> t_list, obs_start = {0}, obs_camid_list;
+    std::vector<double> pt_list, error_list, obs_pt_list;
+    for (int i = 0; i < n_row; i ++)
+    {
+        double const* row = data.data() + size_t(i) * n_col;
+
+        t_list.push_back(std::lround(row[1] * fps));
+        pt_list.push_back(row[2]);
+        pt_list.push_back(row[3]);
+        pt_list.push_back(row[4]);
+        error_list.push_back(row[5]);
+        for (int k = 0; k < n_cam_all; k ++)
+        {
+            double x = row[7+2*k];
+            double y = row[8+2*k];
+            if (x != IMGPTINIT || y != IMGPTINIT)
+            {
+                obs_camid_list.push_back(k);
+                obs_pt_list.push_back(x);
+                obs_pt_list.push_back(y);
+            }
+        }
+        obs_start.push_back(obs_camid_list.size());
+
+        // last point of the track
+        if (i == n_row-1 || row[n_col] != row[0])
+        {
+            writer.addTrack(int64_t(row[0]), t_list.size(), t_list.data(), pt_list.data(), error_list.data(), obs_start.data(), obs_camid_list.data(), obs_pt_list.data());
+            t_list.clear(); pt_list.clear(); error_list.clear();
+            obs_start.assign(1, 0); obs_camid_list.clear(); obs_pt_list.clear();
+        }
+    }
+
+    writer.close();
+}
@@ -23,15 +23,11 @@ tracks_code = table2array(...
     readtable('../../results/test_STB/Tracer_0/LongTrackActive_49.csv'));
 
 tracks_code_inactive = table2array(...
-    readtable('../../results/test_STB/Tracer_0/LongTrackInactive_49.csv'));
-tracks_code_inactive(:,1) = tracks_code_inactive(:,1) + ...
-                            size(unique(tracks_code(:,1)),1);
+    readtable('../../results/test_STB/Tracer_0/LongTrackInactive_0_49.csv'));
 tracks_code = [tracks_code; tracks_code_inactive];
 
 tracks_code_exit = table2array(...
-    readtable('../../results/test_STB/Tracer_0/ExitTrack_49.csv'));
-tracks_code_exit(:,1) = tracks_code_exit(:,1) + ...
-                        size(unique(tracks_code(:,1)),1);
+    readtable('../../results/test_STB/Tracer_0/ExitTrack_0_49.csv'));
 tracks_code = [tracks_code; tracks_code_exit];
 
 
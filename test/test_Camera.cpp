@@ -367,6 +367,61 @@ bool test_function_6 ()
 }
 
 
+// test roi of a volume
+bool test_function_7 ()
+{
+    CamList cam_list;
+    cam_list.cam_list.push_back(Camera("../test/inputs/test_Camera/cam1.txt"));
+    Camera const& c = cam_list.cam_list[0];
+    AxisLimit axis_limit(-5, 5, -5, 5, -5, 5);
+
+    // whole image without roi
+    PixelRange roi = cam_list.getROI(0);
+    if (roi.row_min != 0 || roi.row_max != c.getNRow() || roi.col_min != 0 || roi.col_max != c.getNCol())
+    {
+        std::cout << "test_function_7 (line " << __LINE__ << "): wrong default roi" << std::endl;
+        return false;
+    }
+
+    cam_list.setROI(axis_limit, 0);
+    roi = cam_list.getROI(0);
+    if (roi.row_min < 0 || roi.row_max > c.getNRow() || roi.col_min < 0 || roi.col_max > c.getNCol() || roi.getNumOfRow() <= 0 || roi.getNumOfCol() <= 0)
+    {
+        std::cout << "test_function_7 (line " << __LINE__ << "): roi out of image (" << roi.row_min << "," << roi.row_max << "," << roi.col_min << "," << roi.col_max << ")" << std::endl;
+        return false;
+    }
+    if (roi.getNumOfRow() == c.getNRow() && roi.getNumOfCol() == c.getNCol())
+    {
+        std::cout << "test_function_7 (line " << __LINE__ << "): roi is the whole image" << std::endl;
+        return false;
+    }
+
+    // every point of the volume is inside the roi
+    for (int i = 0; i < 1000; i ++)
+    {
+        Pt3D pt_world(-5 + 10 * ((i * 37) % 101) / 100.0, -5 + 10 * ((i * 53) % 103) / 102.0, -5 + 10 * ((i * 71) % 107) / 106.0);
+        Pt2D pt_img = c.project(pt_world);
+        if (pt_img[1] < roi.row_min || pt_img[1] >= roi.row_max || pt_img[0] < roi.col_min || pt_img[0] >= roi.col_max)
+        {
+            std::cout << "test_function_7 (line " << __LINE__ << "): point outside roi" << std::endl;
+            pt_img.print(8);
+            return false;
+        }
+    }
+
+    // margin
+    PixelRange roi_margin = c.projectROI(axis_limit, 5);
+    if (roi_margin.row_min != std::max(0, roi.row_min-5) || roi_margin.row_max != std::min(c.getNRow(), roi.row_max+5) || 
+        roi_margin.col_min != std::max(0, roi.col_min-5) || roi_margin.col_max != std::min(c.getNCol(), roi.col_max+5))
+    {
+        std::cout << "test_function_7 (line " << __LINE__ << "): wrong margin" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
 int main()
 {
     fs::create_directories("../test/results/test_Camera/");
@@ -378,6 +433,7 @@ int main()
     IS_TRUE(test_function_4());
     IS_TRUE(test_function_5());
     IS_TRUE(test_function_6());
+    IS_TRUE(test_function_7());
 
     return 0;
 }
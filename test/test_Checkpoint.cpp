@@ -0,0 +1,326 @@
+#include "test.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <deque>
+
+#include "Checkpoint.h"
+#include "Track.h"
+#include "Matrix.h"
+#include "ObjectInfo.h"
+#include "Camera.h"
+#include "OTF.h"
+#include "STB.h"
+
+// tracks with different length, a varying number of 2D observations and full live objects
+void makeTracks (std::deque<Track<Tracer3D>>& track_list, int n_track, int n_cam_all)
+{
+    track_list.clear();
+    for (int i = 0; i < n_track; i ++)
+    {
+        Track<Tracer3D> track;
+        for (int t = 0; t < 3 + i % 11; t ++)
+        {
+            Tracer3D obj3d;
+            obj3d._pt_center = Pt3D(i + 0.125*t, -0.5*i + 0.25*t, 1.0/(1+t));
+            obj3d._error = 1e-3 * (i + t);
+            obj3d._r2d_px = 1.5 + 0.1 * i;
+            for (int cam_id = 0; cam_id < n_cam_all; cam_id ++)
+            {
+                if ((i + t + cam_id) % 3 != 0)
+                {
+                    Tracer2D tr2d(Pt2D(10.5*t + cam_id, 20.25*i - cam_id));
+                    tr2d._r_px = 2 + 0.01 * cam_id;
+                    obj3d.addTracer2D(tr2d, cam_id);
+                }
+            }
+            track.addNext(obj3d, 100 + i + t);
+        }
+        track._track_id = i % 2 == 0 ? 2*i + 1 : -1;
+        track._active = i % 3 != 0;
+        track_list.push_back(track);
+    }
+}
+
+std::string readFile (std::string const& file)
+{
+    std::ifstream input(file, std::ios::in | std::ios::binary);
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    return buffer.str();
+}
+
+// test stream round trip
+bool test_function_1 ()
+{
+    std::string folder = "../test/results/test_Checkpoint/";
+    int n_cam_all = 3;
+
+    std::deque<Track<Tracer3D>> track_list;
+    makeTracks(track_list, 40, n_cam_all);
+
+    std::vector<std::vector<Tracer3D>> obj3d_list_all(3);
+    for (int i = 0; i < 3; i ++)
+    {
+        obj3d_list_all[i] = track_list[i]._obj3d_list;
+        for (int j = 0; j < obj3d_list_all[i].size(); j ++)
+        {
+            obj3d_list_all[i][j]._is_tracked = j % 2;
+        }
+    }
+
+    OTF otf(n_cam_all, 2, 2, 2, AxisLimit(-20, 20, -10, 10, -5, 5));
+    otf._param.a(1,3) = 97.5;
+    otf._param.b(2,0) = 0.75;
+
+    CheckpointWriter output;
+    output.open(folder + "test_function_1.bin");
+    output.write(int(7));
+    output.write(std::string("tracer"));
+    output.write(otf._param);
+    output.write(obj3d_list_all);
+    output.write(track_list);
+    output.close();
+    IS_TRUE(!fs::exists(folder + "test_function_1.bin.tmp"));
+
+    CheckpointReader input(folder + "test_function_1.bin");
+    int frame;
+    std::string name;
+    OTFParam otf_param;
+    std::vector<std::vector<Tracer3D>> obj3d_list_all_load;
+    std::deque<Track<Tracer3D>> track_list_load;
+    input.read(frame);
+    input.read(name);
+    input.read(otf_param);
+    input.read(obj3d_list_all_load);
+    input.read(track_list_load);
+    input.close();
+
+    IS_TRUE(frame == 7);
+    IS_TRUE(name == "tracer");
+    IS_TRUE(otf_param.n_grid == otf._param.n_grid);
+    IS_TRUE(otf_param.a(1,3) == 97.5);
+    IS_TRUE(otf_param.b(2,0) == 0.75);
+    IS_TRUE(otf_param.grid_z == otf._param.grid_z);
+    IS_TRUE(otf_param.boundary.y_min == -10);
+
+    IS_TRUE(obj3d_list_all_load.size() == 3);
+    IS_TRUE(obj3d_list_all_load[2].size() == obj3d_list_all[2].size());
+    IS_TRUE(obj3d_list_all_load[2][1]._is_tracked);
+    IS_TRUE(obj3d_list_all_load[2][1]._camid_list == obj3d_list_all[2][1]._camid_list);
+    IS_TRUE(obj3d_list_all_load[2][1]._tr2d_list[0]._pt_center[1] == obj3d_list_all[2][1]._tr2d_list[0]._pt_center[1]);
+
+    IS_TRUE(track_list_load.size() == track_list.size());
+    for (int i = 0; i < track_list.size(); i ++)
+    {
+        Track<Tracer3D> const& track = track_list[i];
+        Track<Tracer3D> const& track_load = track_list_load[i];
+        IS_TRUE(track_load._n_obj3d == track._n_obj3d);
+        IS_TRUE(track_load._track_id == track._track_id);
+        IS_TRUE(track_load._active == track._active);
+        IS_TRUE(track_load._t_list == track._t_list);
+        IS_TRUE(track_load._pt_list == track._pt_list);
+        IS_TRUE(track_load._error_list == track._error_list);
+        IS_TRUE(track_load._obs_start == track._obs_start);
+        IS_TRUE(track_load._obs_camid_list == track._obs_camid_list);
+        IS_TRUE(track_load._obs_pt_list == track._obs_pt_list);
+        IS_TRUE(track_load._obj3d_list.size() == track._obj3d_list.size());
+
+        Tracer3D const& obj3d = track._obj3d_list.back();
+        Tracer3D const& obj3d_load = track_load._obj3d_list.back();
+        IS_TRUE(obj3d_load._pt_center[0] == obj3d._pt_center[0]);
+        IS_TRUE(obj3d_load._error == obj3d._error);
+        IS_TRUE(obj3d_load._r2d_px == obj3d._r2d_px);
+        IS_TRUE(obj3d_load._n_2d == obj3d._n_2d);
+        IS_TRUE(obj3d_load._tr2d_list.back()._r_px == obj3d._tr2d_list.back()._r_px);
+    }
+
+    // the restored state is saved to the same bytes
+    output.open(folder + "test_function_1_load.bin");
+    output.write(frame);
+    output.write(name);
+    output.write(otf_param);
+    output.write(obj3d_list_all_load);
+    output.write(track_list_load);
+    output.close();
+    IS_TRUE(readFile(folder + "test_function_1_load.bin") == readFile(folder + "test_function_1.bin"));
+
+    return true;
+}
+
+// test invalid files
+bool test_function_2 ()
+{
+    std::string folder = "../test/results/test_Checkpoint/";
+    std::string data = readFile(folder + "test_function_1.bin");
+
+    // truncated file
+    std::ofstream output(folder + "test_function_2.bin", std::ios::out | std::ios::binary);
+    output.write(data.data(), data.size() - 20);
+    output.close();
+
+    bool is_throw = false;
+    try
+    {
+        CheckpointReader input(folder + "test_function_2.bin");
+        int frame;
+        std::string name;
+        OTFParam otf_param;
+        std::vector<std::vector<Tracer3D>> obj3d_list_all;
+        std::deque<Track<Tracer3D>> track_list;
+        input.read(frame);
+        input.read(name);
+        input.read(otf_param);
+        input.read(obj3d_list_all);
+        input.read(track_list);
+        input.close();
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+
+    // not a checkpoint file
+    is_throw = false;
+    try
+    {
+        CheckpointReader input("../test/inputs/test_STB/config.txt");
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+
+    // an unfinished checkpoint keeps the previous one
+    {
+        CheckpointWriter writer;
+        writer.open(folder + "test_function_1.bin");
+        writer.write(int(8));
+    }
+    IS_TRUE(!fs::exists(folder + "test_function_1.bin.tmp"));
+    IS_TRUE(readFile(folder + "test_function_1.bin") == data);
+
+    return true;
+}
+
+// test STB save/load
+bool test_function_3 ()
+{
+    std::string folder = "../test/results/test_Checkpoint/";
+
+    CamList cam_list;
+    int n_cam_all = 4;
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        cam_list.cam_list.push_back(Camera("../test/inputs/test_STB/camFile/cam" + std::to_string(i+1) + ".txt"));
+        cam_list.intensity_max.push_back(255);
+        cam_list.useid_list.push_back(i);
+    }
+    AxisLimit axis_limit(-20, 20, -20, 20, -20, 20);
+
+    STB<Tracer3D> stb(0, 49, 1, 0.04, 2, folder + "STB/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    makeTracks(stb._long_track_active, 30, n_cam_all);
+    makeTracks(stb._short_track_active, 12, n_cam_all);
+    stb._ipr_matched.resize(2);
+    stb._ipr_matched[1] = stb._long_track_active[4]._obj3d_list;
+    stb.saveCheckpoint(folder + "test_function_3.bin", 11);
+
+    STB<Tracer3D> stb_load(0, 49, 1, 0.04, 2, folder + "STB_load/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    IS_TRUE(stb_load.loadCheckpoint(folder + "test_function_3.bin") == 11);
+    IS_TRUE(stb_load._long_track_active.size() == 30);
+    IS_TRUE(stb_load._short_track_active.size() == 12);
+    IS_TRUE(stb_load._ipr_matched[1].size() == stb._ipr_matched[1].size());
+    IS_TRUE(stb_load._long_track_active[7]._obs_pt_list == stb._long_track_active[7]._obs_pt_list);
+
+    stb_load.saveCheckpoint(folder + "test_function_3_load.bin", 11);
+    IS_TRUE(readFile(folder + "test_function_3_load.bin") == readFile(folder + "test_function_3.bin"));
+
+    return true;
+}
+
+// a broken checkpoint keeps the STB state, the frame range comes from the config
+bool test_function_4 ()
+{
+    std::string folder = "../test/results/test_Checkpoint/";
+    std::string data = readFile(folder + "test_function_3.bin");
+
+    CamList cam_list;
+    int n_cam_all = 4;
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        cam_list.cam_list.push_back(Camera("../test/inputs/test_STB/camFile/cam" + std::to_string(i+1) + ".txt"));
+        cam_list.intensity_max.push_back(255);
+        cam_list.useid_list.push_back(i);
+    }
+    AxisLimit axis_limit(-20, 20, -20, 20, -20, 20);
+
+    // truncated file
+    std::ofstream output(folder + "test_function_4.bin", std::ios::out | std::ios::binary);
+    output.write(data.data(), data.size() - 20);
+    output.close();
+
+    STB<Tracer3D> stb(0, 49, 1, 0.04, 2, folder + "STB_load/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    makeTracks(stb._long_track_active, 5, n_cam_all);
+    stb.saveCheckpoint(folder + "test_function_4_before.bin", 3);
+
+    bool is_throw = false;
+    try
+    {
+        stb.loadCheckpoint(folder + "test_function_4.bin");
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+    IS_TRUE(stb._long_track_active.size() == 5 && stb._short_track_active.size() == 0);
+    stb.saveCheckpoint(folder + "test_function_4_after.bin", 3);
+    IS_TRUE(readFile(folder + "test_function_4_after.bin") == readFile(folder + "test_function_4_before.bin"));
+
+    // different frame range
+    STB<Tracer3D> stb_range(5, 30, 1, 0.04, 2, folder + "STB_load/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    IS_TRUE(stb_range.loadCheckpoint(folder + "test_function_3.bin") == 11);
+    IS_TRUE(stb_range._long_track_active.size() == 30);
+    stb_range.saveCheckpoint(folder + "test_function_4_range.bin", 11);
+    {
+        CheckpointReader input(folder + "test_function_4_range.bin");
+        int frame, n_cam, first, last;
+        input.read(frame);
+        input.read(n_cam);
+        input.read(first);
+        input.read(last);
+        IS_TRUE(first == 5 && last == 30);
+    }
+
+    // checkpoint frame out of the frame range
+    STB<Tracer3D> stb_out(20, 49, 1, 0.04, 2, folder + "STB_load/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    is_throw = false;
+    try
+    {
+        stb_out.loadCheckpoint(folder + "test_function_3.bin");
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+    IS_TRUE(stb_out._long_track_active.size() == 0);
+
+    return true;
+}
+
+int main ()
+{
+    fs::create_directories("../test/results/test_Checkpoint/");
+
+    IS_TRUE(test_function_1());
+    IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
+    IS_TRUE(test_function_4());
+
+    return 0;
+}
@@ -11,6 +11,7 @@
 #include "IPR.h"
 
 #include <time.h>
+#include <tuple>
 
 bool test_function_1 ()
 {
@@ -247,12 +248,89 @@ bool test_function_2 ()
 }
 
 
+// test IPR reused for several frames: same result as a new IPR for each frame
+bool test_function_3 ()
+{
+    std::cout << "test_function_3" << std::endl;
+
+    CamList cam_list;
+    for (int i = 0; i < 4; i ++)
+    {
+        Camera cam("../test/inputs/test_IPR/cam" + std::to_string(i+1) + ".txt");
+        cam_list.cam_list.push_back(cam);
+        cam_list.intensity_max.push_back(255); // default
+        cam_list.useid_list.push_back(i);
+    }
+
+    // load image
+    std::vector<Image> img_list;
+    for (int i = 0; i < 4; i ++)
+    {
+        ImageIO imgio;
+        imgio.loadImgPath("../test/inputs/test_IPR/", "cam" + std::to_string(i+1) + "ImageNames" + ".txt");
+        img_list.push_back(imgio.loadImg(0));
+    }
+
+    AxisLimit boundary(-20, 20, -20, 20, -20, 20);
+    OTF otf;
+    otf.loadParam(4, 2, 2, 2, boundary);
+
+    std::vector<double> tr2d_properties = {255, 30, 2};
+
+    // new IPR
+    std::vector<Tracer3D> tr3d_list_new;
+    IPR ipr_new(cam_list, img_list, IPRParam());
+    ipr_new.runIPR(tr3d_list_new, tr2d_properties, otf, 1);
+    IS_TRUE(tr3d_list_new.size() > 0);
+
+    // the order of the matches depends on the threads
+    auto sortTracer = [](std::vector<Tracer3D>& tr3d_list){
+        std::sort(tr3d_list.begin(), tr3d_list.end(), [](Tracer3D const& a, Tracer3D const& b){
+            return std::make_tuple(a._pt_center[0], a._pt_center[1], a._pt_center[2]) < std::make_tuple(b._pt_center[0], b._pt_center[1], b._pt_center[2]);
+        });
+    };
+    sortTracer(tr3d_list_new);
+
+    // IPR with workspaces kept across frames
+    IPR ipr(cam_list, IPRParam());
+    for (int frame = 0; frame < 3; frame ++)
+    {
+        // the last frame rebuilds the workspaces with a changed parameter
+        if (frame == 2)
+        {
+            ipr._param.n_thread = 2;
+        }
+
+        std::vector<Tracer3D> tr3d_list;
+        ipr._imgRes_list = img_list;
+        ipr.runIPR(tr3d_list, tr2d_properties, otf, 1);
+        sortTracer(tr3d_list);
+
+        IS_TRUE(tr3d_list.size() == tr3d_list_new.size());
+        for (int i = 0; i < tr3d_list.size() && i < tr3d_list_new.size(); i ++)
+        {
+            IS_TRUE(myMATH::dist(tr3d_list[i]._pt_center, tr3d_list_new[i]._pt_center) < 1e-10);
+        }
+        for (int i = 0; i < 4; i ++)
+        {
+            IS_TRUE(ipr._imgRes_list[i] == ipr_new._imgRes_list[i]);
+        }
+        IS_TRUE(cam_list.useid_list.size() == 4);
+    }
+
+    std::cout << "test_function_3 passed\n" << std::endl;
+
+    return true;
+}
+
+
 int main ()
 {
     fs::create_directories("../test/results/test_IPR/");
 
     IS_TRUE(test_function_1());
     IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
 
     return 0;
 }
\ No newline at end of file
@@ -81,6 +81,557 @@ bool test_function_3 ()
     return true;
 }
 
+// test background frame loader
+bool test_function_4 ()
+{
+    std::vector<ImageIO> imgio_list(2);
+    imgio_list[0].loadImgPath("../test/inputs/test_ImageIO/", "test_function_1.txt");
+    imgio_list[1].loadImgPath("../test/inputs/test_ImageIO/", "test_function_1.txt");
+
+    ImageIO img_io("../test/inputs/test_ImageIO/", "test_function_1.txt");
+    std::vector<Image> img_ans_list = {img_io.loadImg(0), img_io.loadImg(1)};
+
+    // frames of all cameras, requested again from the cache
+    FrameLoader loader;
+    loader.start(imgio_list, 0, 1, 1, 2);
+    std::vector<Image> img_list;
+    for (int frame_id : {0, 1, 0, 1})
+    {
+        loader.getFrame(frame_id, img_list);
+        if (img_list.size() != 2 || img_list[0] != img_ans_list[frame_id] || img_list[1] != img_ans_list[frame_id])
+        {
+            std::cout << "frame " << frame_id << " is not loaded correctly" << std::endl;
+            return false;
+        }
+    }
+    if (loader.getNumOfLoad() != 2)
+    {
+        std::cout << "n_load = " << loader.getNumOfLoad() << std::endl;
+        return false;
+    }
+    loader.stop();
+
+    // frames outside the cache are reloaded
+    loader.start(imgio_list, 0, 1, 0, 1);
+    for (int frame_id : {0, 1, 0})
+    {
+        loader.getFrame(frame_id, img_list);
+        if (img_list[0] != img_ans_list[frame_id])
+        {
+            std::cout << "frame " << frame_id << " is not reloaded correctly" << std::endl;
+            return false;
+        }
+    }
+    if (loader.getNumOfLoad() != 3)
+    {
+        std::cout << "n_load = " << loader.getNumOfLoad() << std::endl;
+        return false;
+    }
+    loader.stop();
+
+    // a failed load is rethrown when the frame is requested
+    loader.start(imgio_list, 1, 2);
+    loader.getFrame(1, img_list);
+    bool is_error = false;
+    try
+    {
+        loader.getFrame(2, img_list);
+    }
+    catch (ErrorTypeID)
+    {
+        is_error = true;
+    }
+    if (!is_error)
+    {
+        std::cout << "failed load is not rethrown" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// write a 16-bit test image with multi-row strips or tiles
+//  is_bottom_up: rows are stored from the bottom (ORIENTATION_BOTLEFT)
+void writeTestTiff (std::string const& file, Image const& img_disp, bool is_tiled, bool is_bottom_up = false)
+{
+    int n_row = img_disp.getDimRow();
+    int n_col = img_disp.getDimCol();
+
+    // image in file order
+    Image img(img_disp);
+    if (is_bottom_up)
+    {
+        for (int i = 0; i < n_row; i ++)
+        {
+            for (int j = 0; j < n_col; j ++)
+            {
+                img(i, j) = img_disp(n_row-1-i, j);
+            }
+        }
+    }
+
+    TIFF* tif = TIFFOpen(file.c_str(), "w");
+    TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, n_col);
+    TIFFSetField(tif, TIFFTAG_IMAGELENGTH, n_row);
+    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 16);
+    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+    TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+    if (is_bottom_up)
+    {
+        TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_BOTLEFT);
+    }
+
+    if (is_tiled)
+    {
+        int n = 16;
+        TIFFSetField(tif, TIFFTAG_TILEWIDTH, n);
+        TIFFSetField(tif, TIFFTAG_TILELENGTH, n);
+        std::vector<uint16> tile(n*n);
+        for (int row = 0; row < n_row; row += n)
+        {
+            for (int col = 0; col < n_col; col += n)
+            {
+                std::fill(tile.begin(), tile.end(), 0);
+                for (int i = 0; i < n && row+i < n_row; i ++)
+                {
+                    for (int j = 0; j < n && col+j < n_col; j ++)
+                    {
+                        tile[i*n+j] = uint16(img(row+i, col+j));
+                    }
+                }
+                TIFFWriteEncodedTile(tif, TIFFComputeTile(tif, col, row, 0, 0), tile.data(), tile.size()*sizeof(uint16));
+            }
+        }
+    }
+    else
+    {
+        int n = 8;
+        TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, n);
+        std::vector<uint16> strip(n*n_col);
+        for (int row = 0, strip_id = 0; row < n_row; row += n, strip_id ++)
+        {
+            int n_row_strip = std::min(n, n_row-row);
+            for (int i = 0; i < n_row_strip; i ++)
+            {
+                for (int j = 0; j < n_col; j ++)
+                {
+                    strip[i*n_col+j] = uint16(img(row+i, j));
+                }
+            }
+            TIFFWriteEncodedStrip(tif, strip_id, strip.data(), n_row_strip*n_col*sizeof(uint16));
+        }
+    }
+    TIFFClose(tif);
+}
+
+// test bulk strip/tile decode into reused buffers
+bool test_function_5 ()
+{
+    std::string folder = "../test/results/test_ImageIO/";
+    Image img_ans(37, 45, 0);
+    for (int i = 0; i < 37; i ++)
+    {
+        for (int j = 0; j < 45; j ++)
+        {
+            img_ans(i,j) = i*100 + j;
+        }
+    }
+    writeTestTiff(folder + "test_strip.tif", img_ans, false);
+    writeTestTiff(folder + "test_tile.tif", img_ans, true);
+    std::ofstream file_path(folder + "test_function_5.txt");
+    file_path << "test_strip.tif\ntest_tile.tif\n";
+    file_path.close();
+
+    ImageIO img_io(folder, "test_function_5.txt");
+    ImageBuffer buffer;
+    Image img;
+    for (int img_id = 0; img_id < 2; img_id ++)
+    {
+        img_io.loadImgInto(img_id, buffer);
+        if (buffer.n_row != 37 || buffer.n_col != 45 || buffer.bits_per_sample != 16 || buffer.row_stride != 45*2)
+        {
+            std::cout << "image " << img_id << ": wrong buffer size" << std::endl;
+            return false;
+        }
+        if (reinterpret_cast<uint16 const*>(buffer.row(36))[44] != 3644)
+        {
+            std::cout << "image " << img_id << ": wrong pixel value" << std::endl;
+            return false;
+        }
+
+        // the storage of the image is reused
+        double const* data = img_id > 0 ? img.data() : nullptr;
+        img_io.loadImgInto(img_id, img);
+        if (img != img_ans || (img_id > 0 && img.data() != data))
+        {
+            std::cout << "image " << img_id << " is not loaded correctly" << std::endl;
+            return false;
+        }
+    }
+
+    // the buffer is not reallocated for an image of the same size
+    uchar const* data = buffer.data.data();
+    img_io.loadImgInto(0, buffer);
+    if (buffer.data.data() != data)
+    {
+        std::cout << "buffer is reallocated" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// test multi-page tiff and raw stack input
+bool test_function_6 ()
+{
+    std::string folder = "../test/results/test_ImageIO/";
+    int n_frame = 3;
+    std::vector<Image> img_ans_list(n_frame, Image(37, 45, 0));
+    for (int k = 0; k < n_frame; k ++)
+    {
+        for (int i = 0; i < 37; i ++)
+        {
+            for (int j = 0; j < 45; j ++)
+            {
+                img_ans_list[k](i,j) = k*10000 + i*100 + j;
+            }
+        }
+    }
+
+    // multi-page tiff, the last page is compressed
+    TIFF* tif = TIFFOpen((folder + "test_stack.tif").c_str(), "w");
+    for (int k = 0; k < n_frame; k ++)
+    {
+        TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, 45);
+        TIFFSetField(tif, TIFFTAG_IMAGELENGTH, 37);
+        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 16);
+        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+        TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+        TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, 8);
+        TIFFSetField(tif, TIFFTAG_COMPRESSION, k == n_frame-1 ? COMPRESSION_PACKBITS : COMPRESSION_NONE);
+        std::vector<uint16> row(45);
+        for (int i = 0; i < 37; i ++)
+        {
+            for (int j = 0; j < 45; j ++)
+            {
+                row[j] = uint16(img_ans_list[k](i,j));
+            }
+            TIFFWriteScanline(tif, row.data(), i, 0);
+        }
+        TIFFWriteDirectory(tif);
+    }
+    TIFFClose(tif);
+
+    // raw stack with a padded header and padded frames
+    ImageStackHeader header;
+    header.bits_per_sample = 16;
+    header.n_row = 37;
+    header.n_col = 45;
+    header.n_frame = n_frame;
+    header.frame_offset = 128;
+    header.frame_stride = 37*45*2 + 6;
+    std::ofstream output(folder + "test_stack.stk", std::ios::out | std::ios::binary);
+    output.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    std::vector<char> pad(header.frame_offset - sizeof(header) + 6, 0);
+    output.write(pad.data(), header.frame_offset - sizeof(header));
+    for (int k = 0; k < n_frame; k ++)
+    {
+        std::vector<uint16> data(37*45);
+        for (int i = 0; i < 37*45; i ++)
+        {
+            data[i] = uint16(img_ans_list[k][i]);
+        }
+        output.write(reinterpret_cast<char const*>(data.data()), data.size()*sizeof(uint16));
+        output.write(pad.data(), 6);
+    }
+    output.close();
+
+    std::vector<std::string> file_list = {"test_stack.tif", "test_stack.stk"};
+    std::vector<ImageSourceID> source_list = {IMG_TIFF_STACK, IMG_RAW_STACK};
+    for (int s = 0; s < 2; s ++)
+    {
+        ImageIO img_io(folder, file_list[s]);
+        if (img_io.getSource() != source_list[s] || img_io.getNumOfImg() != n_frame)
+        {
+            std::cout << file_list[s] << ": source = " << img_io.getSource() << ", n_img = " << img_io.getNumOfImg() << std::endl;
+            return false;
+        }
+
+        // random access
+        ImageBuffer buffer;
+        for (int k : {2, 0, 1})
+        {
+            img_io.loadImgInto(k, buffer);
+            bool is_view = s == 1 || k != n_frame-1;
+            if ((buffer.view != nullptr) != is_view)
+            {
+                std::cout << file_list[s] << ": frame " << k << " is_view = " << (buffer.view != nullptr) << std::endl;
+                return false;
+            }
+
+            Image img;
+            buffer.toImage(img);
+            if (img != img_ans_list[k] || img_io.loadImg(k) != img_ans_list[k])
+            {
+                std::cout << file_list[s] << ": frame " << k << " is not loaded correctly" << std::endl;
+                return false;
+            }
+        }
+
+        // a copy shares the mapped file
+        ImageIO img_io_copy(img_io);
+        if (img_io_copy.loadImg(2) != img_ans_list[2])
+        {
+            std::cout << file_list[s] << ": copy is not loaded correctly" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// test roi loading
+bool test_function_7 ()
+{
+    // files of test_function_5 and test_function_6
+    std::string folder = "../test/results/test_ImageIO/";
+    PixelRange roi;
+    roi.row_min = 9;
+    roi.row_max = 20;
+    roi.col_min = 17;
+    roi.col_max = 40;
+
+    std::vector<std::string> file_list = {"test_function_5.txt", "test_stack.tif", "test_stack.stk"};
+    for (int k = 0; k < 2*file_list.size(); k ++)
+    {
+        // strip, tile / view, compressed page / view
+        std::string file = file_list[k/2];
+        ImageIO img_io(folder, file);
+        int img_id = k % 2 == 0 ? 0 : img_io.getNumOfImg()-1;
+        Image img_ans = img_io.loadImg(img_id);
+        img_io.setROI(roi);
+        Image img = img_io.loadImg(img_id);
+        for (int i = 0; i < img.getDimRow(); i ++)
+        {
+            for (int j = 0; j < img.getDimCol(); j ++)
+            {
+                bool is_in = i >= roi.row_min && i < roi.row_max && j >= roi.col_min && j < roi.col_max;
+                if (img(i,j) != (is_in ? img_ans(i,j) : 0))
+                {
+                    std::cout << file << ": wrong pixel (" << i << "," << j << ")" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// streaming background subtraction
+bool test_function_8 ()
+{
+    // 8 bit raw stack: static background + a tracer moving one pixel per frame
+    std::string folder = "../test/results/test_ImageIO/";
+    int n_frame = 12, n_row = 20, n_col = 24;
+    ImageStackHeader header;
+    header.bits_per_sample = 8;
+    header.n_row = n_row;
+    header.n_col = n_col;
+    header.n_frame = n_frame;
+    header.frame_stride = n_row * n_col;
+    std::ofstream output(folder + "test_background.stk", std::ios::out | std::ios::binary);
+    output.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    for (int k = 0; k < n_frame; k ++)
+    {
+        std::vector<uint8> data(n_row * n_col);
+        for (int i = 0; i < n_row; i ++)
+        {
+            for (int j = 0; j < n_col; j ++)
+            {
+                data[i*n_col+j] = 10 + (3*i+j) % 20;
+            }
+        }
+        data[5*n_col + 2+k] += 100;
+        output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    }
+    output.close();
+
+    // tracer intensity after subtraction, window of 5 frames
+    //  mean: the tracer is in 1 of 5 frames of the window
+    std::vector<BackgroundTypeID> type_list = {BG_MIN, BG_MEDIAN, BG_MEAN, BG_MIN, BG_MIN};
+    std::vector<double> threshold_list = {0, 0, 0, 120, 0};
+    std::vector<double> clip_list = {-1, -1, -1, -1, 50};
+    std::vector<double> ans_list = {100, 100, 80, 0, 50};
+    for (int t = 0; t < type_list.size(); t ++)
+    {
+        PreprocParam param;
+        param.bg_type = type_list[t];
+        param.n_window = 5;
+        param.threshold = threshold_list[t];
+        param.clip_max = clip_list[t];
+
+        ImageIO img_io(folder, "test_background.stk");
+        Preprocessor preproc(param);
+        Image img;
+        for (int k = 0; k < n_frame; k ++)
+        {
+            preproc.process(img_io, k, img);
+            for (int i = 0; i < n_row; i ++)
+            {
+                for (int j = 0; j < n_col; j ++)
+                {
+                    double ans = (i == 5 && j == 2+k) ? ans_list[t] : 0;
+                    if (img(i,j) != ans)
+                    {
+                        std::cout << "type " << type_list[t] << ", frame " << k << ": pixel (" << i << "," << j << ") = " << img(i,j) << ", expect " << ans << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+
+        // frames in order are decoded once
+        if (preproc.getNumOfDecode() != n_frame)
+        {
+            std::cout << "type " << type_list[t] << ": " << preproc.getNumOfDecode() << " frames decoded, expect " << n_frame << std::endl;
+            return false;
+        }
+    }
+
+    // frame loader with preprocessing, frames out of order reload the window
+    PreprocParam param;
+    param.bg_type = BG_MEAN;
+    param.n_window = 5;
+    std::vector<ImageIO> imgio_list(2, ImageIO(folder, "test_background.stk"));
+    FrameLoader loader;
+    loader.setPreproc(std::vector<PreprocParam>(2, param));
+    loader.start(imgio_list, 0, n_frame-1, 2, 4);
+    std::vector<Image> img_list;
+    for (int k : {7, 2, 3, 11})
+    {
+        loader.getFrame(k, img_list);
+        if (img_list.size() != 2 || img_list[0](5, 2+k) != 80 || img_list[1](5, 2+k) != 80 || img_list[1](5, 3+k) != 0)
+        {
+            std::cout << "FrameLoader: wrong preprocessed frame " << k << std::endl;
+            return false;
+        }
+    }
+    loader.stop();
+
+    return true;
+}
+
+// test bottom-up tiff, the rows are flipped to the top-down image
+bool test_function_9 ()
+{
+    std::string folder = "../test/results/test_ImageIO/";
+    Image img_ans(37, 45, 0);
+    for (int i = 0; i < 37; i ++)
+    {
+        for (int j = 0; j < 45; j ++)
+        {
+            img_ans(i,j) = i*100 + j;
+        }
+    }
+    writeTestTiff(folder + "test_strip_botleft.tif", img_ans, false, true);
+    writeTestTiff(folder + "test_tile_botleft.tif", img_ans, true, true);
+    std::ofstream file_path(folder + "test_function_9.txt");
+    file_path << "test_strip_botleft.tif\ntest_tile_botleft.tif\n";
+    file_path.close();
+
+    ImageIO img_io(folder, "test_function_9.txt");
+    ImageBuffer buffer;
+    for (int img_id = 0; img_id < 2; img_id ++)
+    {
+        img_io.loadImgInto(img_id, buffer);
+        if (buffer.row_stride != -45*2 || reinterpret_cast<uint16 const*>(buffer.row(36))[44] != 3644 || reinterpret_cast<uint16 const*>(buffer.row(0))[1] != 1)
+        {
+            std::cout << "image " << img_id << ": wrong row order" << std::endl;
+            return false;
+        }
+
+        Image img = img_io.loadImg(img_id);
+        if (img != img_ans)
+        {
+            std::cout << "image " << img_id << " is not flipped" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// test bottom-up pages of a multi-page tiff, mapped and decoded pages are flipped alike
+bool test_function_10 ()
+{
+    std::string folder = "../test/results/test_ImageIO/";
+    int n_frame = 3;
+    std::vector<Image> img_ans_list(n_frame, Image(37, 45, 0));
+    for (int k = 0; k < n_frame; k ++)
+    {
+        for (int i = 0; i < 37; i ++)
+        {
+            for (int j = 0; j < 45; j ++)
+            {
+                img_ans_list[k](i,j) = k*10000 + i*100 + j;
+            }
+        }
+    }
+
+    // page 0: bottom-up, page 1: bottom-up and compressed, page 2: top-down
+    std::vector<int> is_bottom_up = {1, 1, 0};
+    TIFF* tif = TIFFOpen((folder + "test_stack_botleft.tif").c_str(), "w");
+    for (int k = 0; k < n_frame; k ++)
+    {
+        TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, 45);
+        TIFFSetField(tif, TIFFTAG_IMAGELENGTH, 37);
+        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 16);
+        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+        TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+        TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, 8);
+        TIFFSetField(tif, TIFFTAG_COMPRESSION, k == 1 ? COMPRESSION_PACKBITS : COMPRESSION_NONE);
+        TIFFSetField(tif, TIFFTAG_ORIENTATION, is_bottom_up[k] ? ORIENTATION_BOTLEFT : ORIENTATION_TOPLEFT);
+        std::vector<uint16> row(45);
+        for (int i = 0; i < 37; i ++)
+        {
+            int i_disp = is_bottom_up[k] ? 36-i : i;
+            for (int j = 0; j < 45; j ++)
+            {
+                row[j] = uint16(img_ans_list[k](i_disp,j));
+            }
+            TIFFWriteScanline(tif, row.data(), i, 0);
+        }
+        TIFFWriteDirectory(tif);
+    }
+    TIFFClose(tif);
+
+    ImageIO img_io(folder, "test_stack_botleft.tif");
+    ImageBuffer buffer;
+    for (int k = 0; k < n_frame; k ++)
+    {
+        img_io.loadImgInto(k, buffer);
+        if ((buffer.view != nullptr) != (k != 1) || (buffer.row_stride < 0) != bool(is_bottom_up[k]))
+        {
+            std::cout << "frame " << k << ": is_view = " << (buffer.view != nullptr) << ", row_stride = " << buffer.row_stride << std::endl;
+            return false;
+        }
+
+        Image img;
+        buffer.toImage(img);
+        if (img != img_ans_list[k] || img_io.loadImg(k) != img_ans_list[k])
+        {
+            std::cout << "frame " << k << " is not flipped correctly" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
 int main ()
 {
     fs::create_directories("../test/results/test_ImageIO/");
@@ -88,6 +639,13 @@ int main ()
     IS_TRUE(test_function_1());
     IS_TRUE(test_function_2());
     IS_TRUE(test_function_3());
+    IS_TRUE(test_function_4());
+    IS_TRUE(test_function_5());
+    IS_TRUE(test_function_6());
+    IS_TRUE(test_function_7());
+    IS_TRUE(test_function_8());
+    IS_TRUE(test_function_9());
+    IS_TRUE(test_function_10());
 
     return 0;
 }
\ No newline at end of file
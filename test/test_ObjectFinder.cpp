@@ -86,12 +86,95 @@ bool test_function_2 ()
     return true;
 }
 
+// synthetic gaussian tracer
+void addTracer (Image& img, double row_c, double col_c, double intensity)
+{
+    for (int row = std::max(0, int(row_c)-4); row < std::min(img.getDimRow(), int(row_c)+5); row ++)
+    {
+        for (int col = std::max(0, int(col_c)-4); col < std::min(img.getDimCol(), int(col_c)+5); col ++)
+        {
+            double dist2 = (row-row_c)*(row-row_c) + (col-col_c)*(col-col_c);
+            img(row, col) += intensity * std::exp(-dist2 / 2);
+        }
+    }
+}
+
+// static pixel mask: persistent peak is masked, moving tracers are kept
+bool test_function_3 ()
+{
+    // 10 frames, 5 tracers moving 7 px per frame, 1 reflection at the same place
+    int n_frame = 10;
+    std::vector<Image> img_list;
+    for (int f = 0; f < n_frame; f ++)
+    {
+        Image img(128, 128, 0);
+        for (int k = 0; k < 5; k ++)
+        {
+            addTracer(img, 20.3 + 20*k, 20.2 + 7*f, 200);
+        }
+        addTracer(img, 64.1 + 0.2*(f%2), 100.4, 200);
+        img_list.push_back(img);
+    }
+
+    ObjectFinder2D objfinder;
+    std::vector<double> properties = {255, 30, 2};
+    PixelMask mask;
+    objfinder.findMask<Tracer2D>(mask, img_list, properties, 0.5);
+
+    if (mask.n_row != 128 || mask.n_col != 128 || !mask(64, 100) || mask(40, 41))
+    {
+        std::cerr << "test_function_3() failed: reflection is not masked or a tracer is masked!" << std::endl;
+        return false;
+    }
+    if (mask.getNumOfMasked() > 9)
+    {
+        std::cerr << "test_function_3() failed: " << mask.getNumOfMasked() << " pixels are masked, expect <= 9" << std::endl;
+        return false;
+    }
+
+    PixelRange region;
+    region.row_max = 128;
+    region.col_max = 128;
+    std::vector<Tracer2D> tr2d_list, tr2d_list_mask;
+    objfinder.findObject2D(tr2d_list, img_list[3], properties, region);
+    objfinder.findObject2D(tr2d_list_mask, img_list[3], properties, region, &mask);
+    if (tr2d_list.size() != 6 || tr2d_list_mask.size() != 5)
+    {
+        std::cerr << "test_function_3() failed: found " << tr2d_list.size() << " tracers without mask and " << tr2d_list_mask.size() << " with mask, expect 6 and 5" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < tr2d_list_mask.size(); i ++)
+    {
+        if (std::fabs(tr2d_list_mask[i]._pt_center[0] - 100.4) < 2 && std::fabs(tr2d_list_mask[i]._pt_center[1] - 64) < 2)
+        {
+            std::cerr << "test_function_3() failed: masked reflection is found!" << std::endl;
+            return false;
+        }
+    }
+
+    // masked runs longer than 8 pixels
+    PixelMask mask_row;
+    mask_row.config(2, 40);
+    for (int col = 3; col < 30; col ++)
+    {
+        mask_row.set(1, col);
+    }
+    if (mask_row.nextUnmasked(1, 3, 40) != 30 || mask_row.nextUnmasked(1, 0, 40) != 0 || mask_row.nextUnmasked(1, 5, 20) != 20 || mask_row.nextUnmasked(0, 3, 40) != 3)
+    {
+        std::cerr << "test_function_3() failed: nextUnmasked is not correct!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 int main ()
 {
     fs::create_directories("../test/results/test_ObjectFinder/");
 
     IS_TRUE(test_function_1());
     IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
 
     return 0;
 }
\ No newline at end of file
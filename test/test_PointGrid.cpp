@@ -0,0 +1,139 @@
+#include <random>
+
+#include "test.h"
+#include "Matrix.h"
+#include "myMATH.h"
+#include "PointGrid.h"
+
+// random points with some near duplicates
+void makePoints (std::vector<Pt3D>& pt_list, int n_pt, double box, int seed)
+{
+    std::default_random_engine generator(seed);
+    std::uniform_real_distribution<double> uni(-box, box);
+    std::normal_distribution<double> noise(0, 1e-3);
+
+    pt_list.clear();
+    for (int i = 0; i < n_pt; i ++)
+    {
+        if (i > 0 && i % 7 == 0)
+        {
+            Pt3D pt = pt_list[i/2];
+            pt[0] += noise(generator);
+            pt[1] += noise(generator);
+            pt[2] += noise(generator);
+            pt_list.push_back(pt);
+        }
+        else
+        {
+            pt_list.push_back(Pt3D(uni(generator), uni(generator), uni(generator)));
+        }
+    }
+}
+
+// test findNeighbor and findNearest against brute force
+bool test_function_1 ()
+{
+    std::vector<Pt3D> pt_list;
+    makePoints(pt_list, 2000, 20, 1234);
+    int n_pt = pt_list.size();
+
+    double radius = 1.5;
+    PointGrid grid(pt_list, radius);
+    IS_TRUE(grid.getNumOfPt() == n_pt);
+
+    std::vector<Pt3D> query_list;
+    makePoints(query_list, 200, 25, 4321);
+
+    std::vector<int> id_list;
+    for (int q = 0; q < query_list.size(); q ++)
+    {
+        Pt3D const& pt = query_list[q];
+
+        // brute force
+        std::vector<int> id_list_sol;
+        int nearest_sol = -1;
+        double min_dist2 = radius * radius;
+        for (int i = 0; i < n_pt; i ++)
+        {
+            double dist2 = myMATH::dist2(pt_list[i], pt);
+            if (dist2 < radius * radius)
+            {
+                id_list_sol.push_back(i);
+            }
+            if (i % 3 != 0 && dist2 < min_dist2)
+            {
+                min_dist2 = dist2;
+                nearest_sol = i;
+            }
+        }
+
+        grid.findNeighbor(id_list, pt, radius);
+        if (id_list != id_list_sol)
+        {
+            std::cout << "test_function_1: findNeighbor failed at query " << q << std::endl;
+            return false;
+        }
+
+        int nearest = grid.findNearest(pt, radius, [](int id){ return id % 3 == 0; });
+        if (nearest != nearest_sol)
+        {
+            std::cout << "test_function_1: findNearest failed at query " << q << std::endl;
+            std::cout << "nearest = " << nearest << ", nearest_sol = " << nearest_sol << std::endl;
+            return false;
+        }
+    }
+
+    // search radius larger than cell size
+    grid.findNeighbor(id_list, Pt3D(0,0,0), 100);
+    IS_TRUE(id_list.size() == n_pt);
+
+    return true;
+}
+
+// test findRepeat against the sequential O(N^2) check
+bool test_function_2 ()
+{
+    std::vector<Pt3D> pt_list;
+    makePoints(pt_list, 3000, 10, 5678);
+    int n_pt = pt_list.size();
+    double tol_3d = 0.05;
+
+    std::vector<int> is_repeat_sol(n_pt, 0);
+    for (int i = 0; i < n_pt-1; i ++)
+    {
+        if (is_repeat_sol[i])
+        {
+            continue;
+        }
+        for (int j = i+1; j < n_pt; j ++)
+        {
+            if (myMATH::dist2(pt_list[i], pt_list[j]) < tol_3d*tol_3d)
+            {
+                is_repeat_sol[j] = 1;
+            }
+        }
+    }
+
+    PointGrid grid(pt_list, tol_3d);
+    std::vector<int> is_repeat;
+    int n_repeat = grid.findRepeat(is_repeat, tol_3d);
+
+    IS_TRUE(is_repeat == is_repeat_sol);
+    IS_TRUE(n_repeat == std::count(is_repeat_sol.begin(), is_repeat_sol.end(), 1));
+    IS_TRUE(n_repeat > 0);
+
+    // empty grid
+    PointGrid grid_empty(std::vector<Pt3D>(), tol_3d);
+    IS_TRUE(grid_empty.findRepeat(is_repeat, tol_3d) == 0);
+    IS_TRUE(grid_empty.findNearest(Pt3D(0,0,0), 1) == -1);
+
+    return true;
+}
+
+int main ()
+{
+    IS_TRUE(test_function_1());
+    IS_TRUE(test_function_2());
+
+    return 0;
+}
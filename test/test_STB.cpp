@@ -5,11 +5,15 @@
 #include <iostream>
 #include <fstream>
 #include <variant>
+#include <algorithm>
+#include <cmath>
 
 #include "Matrix.h"
 #include "Camera.h"
 #include "ObjectInfo.h"
 #include "STB.h"
+#include "ImageIO.h"
+#include "TextIO.h"
 
 bool test_function_1 ()
 {
@@ -407,10 +411,170 @@ bool test_function_2 ()
     return true;
 }
 
+// test track IDs of loaded track files
+//  old csv files number the tracks 0,1,2,... in each file
+bool test_function_3 ()
+{
+    std::cout << "test_function_3" << std::endl;
+
+    std::string folder = "../test/results/test_STB/test_function_3/";
+    fs::create_directories(folder);
+
+    CamList cam_list;
+    int n_cam_all = 4;
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        cam_list.cam_list.push_back(Camera("../test/inputs/test_STB/camFile/cam" + std::to_string(i+1) + ".txt"));
+        cam_list.intensity_max.push_back(255);
+        cam_list.useid_list.push_back(i);
+    }
+    AxisLimit axis_limit(-20, 20, -20, 20, -20, 20);
+
+    // two old files with 3 and 4 tracks
+    int n_track_list[2] = {3, 4};
+    for (int k = 0; k < 2; k ++)
+    {
+        std::ofstream output(folder + "old_" + std::to_string(k) + ".csv");
+        output << "TrackID,FrameID,WorldX,WorldY,WorldZ,Error,Ncam\n";
+        for (int i = 0; i < n_track_list[k]; i ++)
+        {
+            for (int t = 0; t < 4; t ++)
+            {
+                output << i << "," << t << "," << k << "," << i << "," << t << ",0,0\n";
+            }
+        }
+        output.close();
+    }
+
+    STB<Tracer3D> stb(0, 49, 1, 0.04, 2, folder + "STB/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    stb.loadTracks(folder + "old_0.csv", LONG_ACTIVE);
+    stb.loadTracks(folder + "old_1.csv", LONG_INACTIVE);
+    IS_TRUE(stb._long_track_active.size() == 3);
+    IS_TRUE(stb._long_track_inactive.size() == 4);
+
+    std::vector<int> id_list;
+    for (Track<Tracer3D> const& track : stb._long_track_active)
+    {
+        id_list.push_back(track._track_id);
+    }
+    for (Track<Tracer3D> const& track : stb._long_track_inactive)
+    {
+        id_list.push_back(track._track_id);
+    }
+    std::vector<int> id_list_sol = {0, 1, 2, 3, 4, 5, 6};
+    IS_TRUE(id_list == id_list_sol);
+
+    // global IDs are kept
+    stb._long_track_active[0]._track_id = 10;
+    stb._long_track_active[1]._track_id = 4;
+    stb._long_track_active[2]._track_id = 8;
+    stb.saveTracks(folder + "new.csv", stb._long_track_active);
+
+    STB<Tracer3D> stb_new(0, 49, 1, 0.04, 2, folder + "STB_new/", cam_list, axis_limit, "../test/inputs/test_STB/tracerConfig.txt");
+    stb_new.loadTracks(folder + "old_0.csv", LONG_INACTIVE);
+    stb_new.loadTracks(folder + "new.csv", LONG_ACTIVE);
+    IS_TRUE(stb_new._long_track_active[0]._track_id == 10);
+    IS_TRUE(stb_new._long_track_active[1]._track_id == 4);
+    IS_TRUE(stb_new._long_track_active[2]._track_id == 8);
+    IS_TRUE(stb_new._long_track_inactive[2]._track_id == 2);
+
+    std::cout << "test_function_3 passed\n" << std::endl;
+    return true;
+}
+
+
+// IPR only: frames processed in parallel give the same objects as one frame at a time
+bool test_function_4 ()
+{
+    std::cout << "test_function_4" << std::endl;
+
+    std::string folder = "../test/results/test_STB/test_function_4/";
+    fs::create_directories(folder);
+
+    CamList cam_list;
+    int n_cam_all = 4;
+    std::vector<ImageIO> imgio_list(n_cam_all);
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        cam_list.cam_list.push_back(Camera("../test/inputs/test_STB/camFile/cam" + std::to_string(i+1) + ".txt"));
+        cam_list.intensity_max.push_back(255);
+        cam_list.useid_list.push_back(i);
+        imgio_list[i].loadImgPath("", "../test/inputs/test_STB/imgFile/cam" + std::to_string(i+1) + "ImageNames.txt");
+    }
+    AxisLimit axis_limit(-20, 20, -20, 20, -20, 20);
+
+    // IPR only (option 2) with the optional values up to the number of parallel frames
+    std::ifstream input("../test/inputs/test_STB/tracerConfig.txt");
+    std::stringstream config;
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (line.find("Triangulation/IPR Only") != std::string::npos)
+        {
+            line = "2";
+        }
+        config << line << "\n";
+    }
+    input.close();
+
+    int frame_start = 0, frame_end = 3;
+    int n_frame_parallel_list[2] = {1, 3};
+    for (int k = 0; k < 2; k ++)
+    {
+        std::string file = folder + "config_" + std::to_string(k) + ".txt";
+        std::ofstream output(file);
+        output << config.str() << "0 # shake mode\n0 0 # convergence tolerance\n0 # prediction\n0 # track format\n0 # checkpoint\n"
+               << n_frame_parallel_list[k] << " # frames in parallel\n";
+        output.close();
+
+        STB<Tracer3D> stb(frame_start, frame_end, 1, 0.04, 3, folder + "STB_" + std::to_string(k) + "/", cam_list, axis_limit, file);
+        IS_TRUE(stb.isIPROnly() && stb.isIPREnabled());
+        IS_TRUE(stb.getNumOfFrameParallel() == n_frame_parallel_list[k]);
+
+        FrameLoader frame_loader;
+        frame_loader.start(imgio_list, frame_start, frame_end, stb.getNumOfFrameParallel(), stb.getNumOfFrameParallel() + 1);
+        stb.runIPROnly(frame_loader, frame_start, frame_end);
+    }
+
+    // same objects, the row order may differ
+    for (int frame = frame_start; frame <= frame_end; frame ++)
+    {
+        std::vector<std::vector<double>> row_list[2];
+        for (int k = 0; k < 2; k ++)
+        {
+            std::vector<double> data;
+            int n_col = 0;
+            int n_row = readCSV(data, n_col, folder + "STB_" + std::to_string(k) + "/InitialTrack/IPR_" + std::to_string(frame) + ".csv", 1);
+            for (int i = 0; i < n_row; i ++)
+            {
+                row_list[k].push_back(std::vector<double>(data.begin() + i*n_col, data.begin() + (i+1)*n_col));
+            }
+            std::sort(row_list[k].begin(), row_list[k].end());
+        }
+        IS_TRUE(row_list[0].size() > 0 && row_list[0].size() == row_list[1].size());
+
+        bool is_equal = true;
+        for (int i = 0; i < row_list[0].size(); i ++)
+        {
+            for (int j = 0; j < row_list[0][i].size(); j ++)
+            {
+                is_equal = is_equal && std::fabs(row_list[0][i][j] - row_list[1][i][j]) < 1e-6;
+            }
+        }
+        IS_TRUE(is_equal);
+    }
+
+    std::cout << "test_function_4 passed\n" << std::endl;
+    return true;
+}
+
+
 int main()
 {
     fs::create_directories("../test/results/test_STB/");
 
+    IS_TRUE(test_function_3());
+    IS_TRUE(test_function_4());
     IS_TRUE(test_function_1());
     // IS_TRUE(test_function_2());
 
@@ -11,6 +11,7 @@
 
 #include <time.h>
 #include <random>
+#include <algorithm>
 
 // test stereomatch from image with deleting ghost
 bool test_function_1 ()
@@ -217,11 +218,397 @@ bool test_function_1 ()
 }
 
 
+// cameras, images and stereo-matched tracers of the first test frame
+//  noise_std: [mm], gaussian noise added to the tracer positions
+void loadShakeInput (CamList& cam_list, std::vector<Image>& img_list, std::vector<Tracer3D>& tr3d_list, OTF& otf, double noise_std)
+{
+    cam_list = CamList();
+    img_list.clear();
+    for (int i = 0; i < 4; i ++)
+    {
+        Camera cam("../test/inputs/test_Shake/cam" + std::to_string(i+1) + ".txt");
+        cam_list.cam_list.push_back(cam);
+        cam_list.intensity_max.push_back(255); // default
+        cam_list.useid_list.push_back(i);
+
+        ImageIO imgio;
+        imgio.loadImgPath("../test/inputs/test_Shake/", "cam" + std::to_string(i+1) + "ImageNames" + ".txt");
+        img_list.push_back(imgio.loadImg(0));
+    }
+
+    // find 2d tracer
+    std::vector<std::vector<Tracer2D>> tr2d_list_all;
+    std::vector<double> properties = {255, 30, 2};
+    ObjectFinder2D objfinder;
+    for (int i = 0; i < 4; i ++)
+    {
+        std::vector<Tracer2D> tr2d_list;
+        objfinder.findObject2D(tr2d_list, img_list[i], properties);
+        tr2d_list_all.push_back(tr2d_list);
+    }
+
+    // stereo match
+    SMParam param;
+    param.tor_2d = 1.;
+    param.tor_3d = 2.4e-2;
+    param.n_thread = 6;
+    param.check_id = 3;
+    param.check_radius = 3;
+    param.is_delete_ghost = true;
+    param.is_update_inner_var = false;
+    StereoMatch stereo_match(param, cam_list);
+
+    tr3d_list.clear();
+    stereo_match.match(tr3d_list, tr2d_list_all);
+
+    // add noise
+    if (noise_std > 0)
+    {
+        std::default_random_engine generator(1234);
+        std::normal_distribution<double> dist(0, noise_std);
+        for (int i = 0; i < tr3d_list.size(); i ++)
+        {
+            tr3d_list[i]._pt_center[0] += dist(generator);
+            tr3d_list[i]._pt_center[1] += dist(generator);
+            tr3d_list[i]._pt_center[2] += dist(generator);
+        }
+    }
+
+    AxisLimit boundary(-20, 20, -20, 20, -20, 20);
+    otf.loadParam(4, 2, 2, 2, boundary);
+}
+
+// number of true tracers without a shaken tracer within tor [mm]
+int countMismatch (std::vector<Tracer3D> const& tr3d_list, double tor)
+{
+    Matrix<double> pt3d_list_sol("../test/solutions/test_Shake/pt3d_list_img.csv");
+    int n_tr3d_real = pt3d_list_sol.getDimRow();
+    int n_tr3d_find = tr3d_list.size();
+    std::vector<int> is_mismatch(n_tr3d_real, 0);
+
+    #pragma omp parallel for
+    for (int i = 0; i < n_tr3d_real; i ++)
+    {
+        Pt3D pt3d(pt3d_list_sol(i, 0), pt3d_list_sol(i, 1), pt3d_list_sol(i, 2));
+        
+        double error_min = 1e10;
+        for (int j = 0; j < n_tr3d_find; j ++)
+        {
+            error_min = std::min(error_min, myMATH::dist(pt3d, tr3d_list[j]._pt_center));
+        }
+
+        if (error_min > tor)
+        {
+            is_mismatch[i] = 1;
+        }
+    }
+
+    int n_mismatch = 0;
+    for (int i = 0; i < n_tr3d_real; i ++)
+    {
+        n_mismatch += is_mismatch[i];
+    }
+    return n_mismatch;
+}
+
+
+// test Gauss-Seidel shake with graph coloring
+//  shake width 0.01 mm (0.25 vox), ghost threshold 0.1 as in the STB configs
+bool test_function_2 ()
+{
+    std::cout << "test_function_2" << std::endl;
+
+    CamList cam_list;
+    std::vector<Image> img_list;
+    std::vector<Tracer3D> tr3d_list;
+    OTF otf;
+    loadShakeInput(cam_list, img_list, tr3d_list, otf, 0.001);
+    int n_tr3d_real = Matrix<double>("../test/solutions/test_Shake/pt3d_list_img.csv").getDimRow();
+
+    // mismatches after n_loop loops
+    std::vector<int> n_loop_list = {1, 2, 4, 6};
+    std::vector<int> n_mismatch_list[2];
+    for (bool is_gauss_seidel : {false, true})
+    {
+        for (int n_loop : n_loop_list)
+        {
+            std::vector<Tracer3D> tr3d_list_shake(tr3d_list);
+            Shake s (cam_list, 0.01, 0.1, 0.1, n_loop, 0, is_gauss_seidel);
+            s.runShake(tr3d_list_shake, otf, img_list, false);
+            n_mismatch_list[is_gauss_seidel].push_back(countMismatch(tr3d_list_shake, 1e-3));
+
+            // residue image should be valid
+            for (int i = 0; i < 4; i ++)
+            {
+                IS_TRUE(s._imgRes_list[i].getDimRow() == img_list[i].getDimRow());
+                IS_TRUE(s._imgRes_list[i].getDimCol() == img_list[i].getDimCol());
+            }
+        }
+    }
+    std::cout << "n_tr3d_real = " << n_tr3d_real << ", n_tr3d_find = " << tr3d_list.size() << std::endl;
+    int n_mismatch_sum[2] = {0, 0};
+    for (int k = 0; k < n_loop_list.size(); k ++)
+    {
+        std::cout << "n_loop = " << n_loop_list[k] << ": n_mismatch (Jacobi) = " << n_mismatch_list[0][k] 
+                  << ", n_mismatch (Gauss-Seidel) = " << n_mismatch_list[1][k] << std::endl;
+        n_mismatch_sum[0] += n_mismatch_list[0][k];
+        n_mismatch_sum[1] += n_mismatch_list[1][k];
+    }
+
+    // Gauss-Seidel converges: fewer mismatches with more loops, about 26% left after 6 loops
+    //  about 1400 tracers are not found by the stereo match
+    for (int k = 1; k < n_loop_list.size(); k ++)
+    {
+        IS_TRUE(n_mismatch_list[1][k] <= n_mismatch_list[1][k-1]);
+    }
+    IS_TRUE(n_mismatch_list[1].back() < 0.28 * n_tr3d_real);
+
+    // same result as Jacobi, at least as good after the same number of loops
+    for (int k = 0; k < n_loop_list.size(); k ++)
+    {
+        IS_TRUE(n_mismatch_list[1][k] <= n_mismatch_list[0][k] + 0.002 * n_tr3d_real);
+    }
+    IS_TRUE(std::abs(n_mismatch_list[1].back() - n_mismatch_list[0].back()) <= 0.01 * n_tr3d_real);
+    IS_TRUE(n_mismatch_sum[1] < n_mismatch_sum[0]);
+
+    std::cout << "test_function_2 passed\n" << std::endl;
+
+    return true;
+}
+
+
+bool test_function_3 ()
+{
+    std::cout << "test_function_3" << std::endl;
+
+    CamList cam_list;
+    std::vector<Image> img_list;
+    std::vector<Tracer3D> tr3d_list;
+    OTF otf;
+    loadShakeInput(cam_list, img_list, tr3d_list, otf, 0.001);
+
+    // shake without the active set
+    std::vector<Tracer3D> tr3d_list_all(tr3d_list);
+    Shake s_all (cam_list, 0.01, 0.1, 0.1, 6, 0, false);
+    s_all.runShake(tr3d_list_all, otf, img_list, false);
+
+    clock_t start, end;
+    start = clock();
+    int n_tr3d_input = tr3d_list.size();
+    Shake s (cam_list, 0.01, 0.1, 0.1, 6, 0, false, 1e-4, 1e-2);
+    s.runShake(tr3d_list, otf, img_list, false);
+    end = clock();
+    std::cout << "shake time = " << double(end-start)/CLOCKS_PER_SEC << " [s]" << std::endl;
+
+    // active set: converged tracers stay frozen, ratio never decreases
+    IS_TRUE(s._is_converged.size() == n_tr3d_input);
+    IS_TRUE(s._converge_ratio_list.size() > 0);
+    for (int i = 0; i < s._converge_ratio_list.size(); i ++)
+    {
+        IS_TRUE(s._converge_ratio_list[i] >= 0 && s._converge_ratio_list[i] <= 1);
+        if (i > 0)
+        {
+            IS_TRUE(s._converge_ratio_list[i] >= s._converge_ratio_list[i-1]);
+        }
+        std::cout << "loop " << i << ": converge ratio = " << s._converge_ratio_list[i] << std::endl;
+    }
+
+    // freezing converged tracers keeps most of the accuracy of shaking all of them
+    //  about 2% more tracers are off by more than 1e-3 mm
+    int n_tr3d_real = Matrix<double>("../test/solutions/test_Shake/pt3d_list_img.csv").getDimRow();
+    int n_mismatch = countMismatch(tr3d_list, 1e-3);
+    int n_mismatch_all = countMismatch(tr3d_list_all, 1e-3);
+    std::cout << "n_tr3d_real = " << n_tr3d_real << std::endl;
+    std::cout << "n_tr3d_find = " << tr3d_list.size() << std::endl;
+    std::cout << "n_mismatch = " << n_mismatch << ", n_mismatch (all) = " << n_mismatch_all << std::endl;
+    IS_TRUE(n_mismatch - n_mismatch_all <= 0.03 * n_tr3d_real);
+
+    std::cout << "test_function_3 passed\n" << std::endl;
+
+    return true;
+}
+
+
+// test in-place shake: same result as runShake without copying the images
+bool test_function_4 ()
+{
+    std::cout << "test_function_4" << std::endl;
+
+    CamList cam_list;
+    std::vector<Image> img_list;
+    std::vector<Tracer3D> tr3d_list;
+    OTF otf;
+    loadShakeInput(cam_list, img_list, tr3d_list, otf, 0.001);
+    std::vector<Image> img_list_orig = img_list;
+
+    // moving an image hands over its pixels
+    Image img_move(img_list_orig[0]);
+    double const* data = img_move.data();
+    Image img_moved(std::move(img_move));
+    IS_TRUE(img_moved.data() == data);
+    IS_TRUE(img_move.getDimRow() == 0 && img_move.getDimCol() == 0);
+    img_move = std::move(img_moved);
+    IS_TRUE(img_move.data() == data);
+
+    // Jacobi and Gauss-Seidel shake
+    for (bool is_gauss_seidel : {false, true})
+    {
+        std::vector<Tracer3D> tr3d_list_copy(tr3d_list);
+        Shake s_copy (cam_list, 0.01, 0.1, 0.1, 3, 6, is_gauss_seidel);
+        s_copy.runShake(tr3d_list_copy, otf, img_list, false);
+
+        // the workspace of a reused shake is reset
+        std::vector<Tracer3D> tr3d_list_reuse(tr3d_list);
+        s_copy.runShake(tr3d_list_reuse, otf, img_list, false);
+
+        std::vector<Tracer3D> tr3d_list_inplace(tr3d_list);
+        std::vector<Image> img_list_inplace(img_list);
+        std::vector<double const*> data_list;
+        for (int i = 0; i < 4; i ++)
+        {
+            data_list.push_back(img_list_inplace[i].data());
+        }
+        Shake s_inplace (cam_list, 0.01, 0.1, 0.1, 3, 6, is_gauss_seidel);
+        s_inplace.runShakeInPlace(tr3d_list_inplace, otf, img_list_inplace, false);
+
+        IS_TRUE(s_inplace._is_ghost == s_copy._is_ghost);
+        for (int i = 0; i < tr3d_list.size(); i ++)
+        {
+            IS_TRUE(myMATH::dist(tr3d_list_inplace[i]._pt_center, tr3d_list_copy[i]._pt_center) < 1e-10);
+            IS_TRUE(myMATH::dist(tr3d_list_reuse[i]._pt_center, tr3d_list_copy[i]._pt_center) < 1e-10);
+        }
+        for (int i = 0; i < 4; i ++)
+        {
+            IS_TRUE(img_list_inplace[i].data() == data_list[i]);
+            IS_TRUE(img_list_inplace[i] == s_copy._imgRes_list[i]);
+            IS_TRUE(img_list[i] == img_list_orig[i]);
+        }
+    }
+
+    std::cout << "test_function_4 passed\n" << std::endl;
+    return true;
+}
+
+
+// test Gauss-Seidel coloring with per-tracer radius and large shifts
+//  tracers with the same color never have overlapping patches
+bool test_function_5 ()
+{
+    std::cout << "test_function_5" << std::endl;
+
+    CamList cam_list;
+    std::vector<Image> img_list;
+    std::vector<Tracer3D> tr3d_list;
+    OTF otf;
+    loadShakeInput(cam_list, img_list, tr3d_list, otf, 0);
+
+    // larger radius for every third tracer
+    for (int i = 0; i < tr3d_list.size(); i += 3)
+    {
+        tr3d_list[i]._r2d_px = 3;
+    }
+
+    // a large shake width moves tracers by several pixels
+    Shake s (cam_list, 0.1, 0.1, 0.1, 6, 0, true);
+    s.runShake(tr3d_list, otf, img_list, false);
+
+    int n_tr3d = tr3d_list.size();
+    IS_TRUE(s._color_list.size() == n_tr3d);
+
+    std::vector<std::vector<int>> color_class;
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        if (s._color_list[i] >= color_class.size())
+        {
+            color_class.resize(s._color_list[i]+1);
+        }
+        color_class[s._color_list[i]].push_back(i);
+    }
+
+    // augmented patches (half width 2*r_px) of the same color are apart in every camera
+    int n_overlap = 0;
+    for (std::vector<int> const& tr_id_list : color_class)
+    {
+        for (int m = 0; m < tr_id_list.size(); m ++)
+        {
+            Tracer3D const& tr_i = tr3d_list[tr_id_list[m]];
+            for (int n = m+1; n < tr_id_list.size(); n ++)
+            {
+                Tracer3D const& tr_j = tr3d_list[tr_id_list[n]];
+                for (int id = 0; id < 4; id ++)
+                {
+                    double dist = std::max(
+                        std::fabs(tr_i._tr2d_list[id]._pt_center[0] - tr_j._tr2d_list[id]._pt_center[0]), 
+                        std::fabs(tr_i._tr2d_list[id]._pt_center[1] - tr_j._tr2d_list[id]._pt_center[1])
+                    );
+                    if (dist < 2 * (tr_i._tr2d_list[id]._r_px + tr_j._tr2d_list[id]._r_px) + 3)
+                    {
+                        n_overlap ++;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "n_tr3d = " << n_tr3d << ", n_color = " << color_class.size() << ", n_overlap = " << n_overlap << std::endl;
+    IS_TRUE(n_overlap == 0);
+
+    std::cout << "test_function_5 passed\n" << std::endl;
+    return true;
+}
+
+
+// test final scores of the active set against shaking all tracers in every loop
+//  a frozen tracer keeps the score of its last shake
+bool test_function_6 ()
+{
+    std::cout << "test_function_6" << std::endl;
+
+    CamList cam_list;
+    std::vector<Image> img_list;
+    std::vector<Tracer3D> tr3d_list;
+    OTF otf;
+    loadShakeInput(cam_list, img_list, tr3d_list, otf, 0);
+
+    std::vector<Tracer3D> tr3d_list_all = tr3d_list;
+    Shake s_all (cam_list, 0.01, 0.1, 0.1, 8, 0, false);
+    s_all.runShake(tr3d_list_all, otf, img_list, false);
+
+    std::vector<Tracer3D> tr3d_list_active = tr3d_list;
+    Shake s_active (cam_list, 0.01, 0.1, 0.1, 8, 0, false, 1e-4, 1e-2);
+    s_active.runShake(tr3d_list_active, otf, img_list, false);
+
+    // frozen tracers keep their score, the same tracers are flagged as ghosts
+    int n_tr3d = tr3d_list.size();
+    int n_converged = std::count(s_active._is_converged.begin(), s_active._is_converged.end(), 1);
+    int n_diff = 0;
+    for (int i = 0; i < n_tr3d; i ++)
+    {
+        if (s_active._is_ghost[i] != s_all._is_ghost[i])
+        {
+            n_diff ++;
+        }
+    }
+    std::cout << "n_tr3d = " << n_tr3d << ", n_converged = " << n_converged << std::endl;
+    std::cout << "n_ghost (all) = " << s_all._n_ghost << ", n_ghost (active set) = " << s_active._n_ghost << std::endl;
+    std::cout << "number of different ghost flags = " << n_diff << std::endl;
+    IS_TRUE(n_converged > 0);
+    IS_TRUE(n_diff == 0);
+
+    std::cout << "test_function_6 passed\n" << std::endl;
+    return true;
+}
+
+
 int main ()
 {
     fs::create_directories("../test/results/test_Shake/");
 
     IS_TRUE(test_function_1());
+    IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
+    IS_TRUE(test_function_4());
+    IS_TRUE(test_function_5());
+    IS_TRUE(test_function_6());
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "test.h"
+
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+
+#include "TextIO.h"
+
+std::vector<double> makeValues ()
+{
+    return {0, -0, 1, -1, 0.1, 1.0/3, -2.5e-7, 123456789.125, 1e20, -3.75e-12, 1e-300, 42, 0.000123, 98765.4321};
+}
+
+// TextBuffer output is the same as std::ostream output
+bool test_function_1 ()
+{
+    std::vector<double> value_list = makeValues();
+
+    for (int k = 0; k < 3; k ++)
+    {
+        std::stringstream ss;
+        if (k == 1)
+        {
+            ss.precision(8);
+        }
+        else if (k == 2)
+        {
+            ss << std::scientific << std::setprecision(15);
+        }
+
+        TextBuffer buffer(ss);
+        for (int i = 0; i < value_list.size(); i ++)
+        {
+            ss << value_list[i] << "," << float(value_list[i]) << "," << i - 5 << "\n";
+            buffer << value_list[i] << "," << float(value_list[i]) << "," << i - 5 << '\n';
+        }
+        if (buffer._str != ss.str())
+        {
+            std::cout << "format " << k << ":\n" << buffer._str << "\n!=\n" << ss.str() << std::endl;
+            return false;
+        }
+    }
+
+    // parallel output keeps the item order
+    std::stringstream ss_serial, ss_parallel;
+    int n_item = 5000;
+    for (int i = 0; i < n_item; i ++)
+    {
+        ss_serial << i << "," << 0.5 * i << "\n";
+    }
+    writeTextParallel(ss_parallel, n_item, [](TextBuffer& buffer, int i)
+    {
+        buffer << i << "," << 0.5 * i << '\n';
+    }, 64);
+    IS_TRUE(ss_parallel.str() == ss_serial.str());
+
+    return true;
+}
+
+// csv parser
+bool test_function_2 ()
+{
+    std::vector<double> value_list = makeValues();
+
+    // header, blank rows, windows line endings and a missing last newline
+    std::string text = "a,b,c\r\n";
+    for (int i = 0; i < value_list.size(); i ++)
+    {
+        std::stringstream ss;
+        ss << std::scientific << std::setprecision(17) << value_list[i] << ", " << i << "," << -value_list[i];
+        text += ss.str();
+        text += (i % 4 == 0) ? "\r\n\r\n" : "\n";
+    }
+    text += "1,2";
+
+    std::vector<double> data;
+    int n_col = 0;
+    int n_row = parseCSV(data, n_col, text, 1);
+    IS_TRUE(n_col == 3);
+    IS_TRUE(n_row == value_list.size() + 1);
+    IS_TRUE(data.size() == n_row * n_col);
+    for (int i = 0; i < value_list.size(); i ++)
+    {
+        IS_TRUE(data[3*i] == value_list[i]);
+        IS_TRUE(data[3*i+1] == i);
+        IS_TRUE(data[3*i+2] == -value_list[i]);
+    }
+    IS_TRUE(data[3*value_list.size()] == 1);
+    IS_TRUE(data[3*value_list.size()+1] == 2);
+    IS_TRUE(data[3*value_list.size()+2] == 0);
+
+    // only keep the first 2 columns
+    n_col = 2;
+    n_row = parseCSV(data, n_col, text, 1);
+    IS_TRUE(n_row == value_list.size() + 1);
+    IS_TRUE(data[2*3+1] == 3);
+
+    // large file split into several chunks
+    std::stringstream ss;
+    ss.precision(10);
+    int n_item = 200000;
+    writeTextParallel(ss, n_item, [](TextBuffer& buffer, int i)
+    {
+        buffer << i << ',' << 0.25 * i << '\n';
+    });
+    n_col = 0;
+    n_row = parseCSV(data, n_col, ss.str());
+    IS_TRUE(n_row == n_item && n_col == 2);
+    bool is_equal = true;
+    for (int i = 0; i < n_item; i ++)
+    {
+        is_equal = is_equal && data[2*i] == i && data[2*i+1] == 0.25 * i;
+    }
+    IS_TRUE(is_equal);
+
+    // empty text
+    n_col = 0;
+    IS_TRUE(parseCSV(data, n_col, "\n\n", 0) == 0);
+
+    return true;
+}
+
+// readCSV parses the mapped file like parseCSV parses the text
+bool test_function_3 ()
+{
+    std::string folder = "../test/results/test_TextIO/";
+    std::filesystem::create_directories(folder);
+
+    std::string text = "TrackID,FrameID,WorldX\n0,1,0.5\n\n1,2,-2.5e-3\r\n2,3,4";
+    std::ofstream output(folder + "test_function_3.csv", std::ios::out | std::ios::binary);
+    output << text;
+    output.close();
+
+    std::vector<double> data, data_text;
+    int n_col = 0, n_col_text = 0;
+    int n_row = readCSV(data, n_col, folder + "test_function_3.csv", 1);
+    int n_row_text = parseCSV(data_text, n_col_text, text, 1);
+    IS_TRUE(n_row == 3 && n_col == 3);
+    IS_TRUE(n_row == n_row_text && n_col == n_col_text && data == data_text);
+    IS_TRUE(data[5] == -2.5e-3 && data[8] == 4);
+
+    // empty file
+    output.open(folder + "test_function_3_empty.csv", std::ios::out | std::ios::binary);
+    output.close();
+    n_col = 0;
+    IS_TRUE(readCSV(data, n_col, folder + "test_function_3_empty.csv", 1) == 0 && data.empty());
+
+    return true;
+}
+
+int main ()
+{
+    IS_TRUE(test_function_1());
+    IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
+
+    return 0;
+}
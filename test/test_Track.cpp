@@ -3,10 +3,12 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <sstream>
 
 #include "Track.h"
 #include "Matrix.h"
 #include "ObjectInfo.h"
+#include "myMATH.h"
 
 bool test_function_1 ()
 {
@@ -42,11 +44,357 @@ bool test_function_1 ()
 }
 
 
+// reference: iterative LMS Wiener filter on one axis
+double predLMSRef (std::vector<double> series)
+{
+    int order = series.size() - 1;
+    double shift = 10;
+    bool shift_label = std::fabs(series[order]) < 1;
+    if (shift_label)
+    {
+        for (int j = 0; j < order+1; j ++)
+        {
+            series[j] += shift;
+        }
+    }
+
+    double sum = 0;
+    for (int j = 0; j < order; j ++)
+    {
+        sum += series[j] * series[j];
+    }
+    double step = 1 / sum;
+
+    std::vector<double> filter_param(order, 0);
+    double prediction = 0;
+    double error = series[order];
+    int iter = 0;
+    while (std::fabs(error) > SMALLNUMBER && iter < 5000)
+    {
+        prediction = 0;
+        for (int j = 0; j < order; j ++)
+        {
+            filter_param[j] += step * series[j] * error;
+            prediction += filter_param[j] * series[j];
+        }
+        error = series[order] - prediction;
+        iter ++;
+    }
+
+    prediction = 0;
+    for (int j = 0; j < order; j ++)
+    {
+        prediction += filter_param[j] * series[j+1];
+    }
+    return shift_label ? prediction - shift : prediction;
+}
+
+Track<Tracer3D> makeTrack (int n, double x0, double v, double a)
+{
+    Track<Tracer3D> track;
+    for (int t = 0; t < n; t ++)
+    {
+        Tracer3D obj3d;
+        obj3d._pt_center[0] = x0 + v*t + 0.5*a*t*t;
+        obj3d._pt_center[1] = -x0 + 0.3*v*t;
+        obj3d._pt_center[2] = 0.1*x0 - 0.5*a*t*t;
+        obj3d._r2d_px = 2;
+        track.addNext(obj3d, t);
+    }
+    return track;
+}
+
+// test batch predictor
+bool test_function_2 ()
+{
+    std::deque<Track<Tracer3D>> track_list;
+    for (int n = 3; n < 10; n ++)
+    {
+        track_list.push_back(makeTrack(n, 0.2*n - 1, 0.05*n, 0.01));
+    }
+    int n_track = track_list.size();
+
+    // Wiener: closed form agrees with the iterative LMS filter
+    TrackPredictor<Tracer3D> predictor;
+    std::vector<Tracer3D> obj3d_list_pred;
+    predictor.predict(obj3d_list_pred, track_list, true);
+    IS_TRUE(obj3d_list_pred.size() == n_track);
+    IS_TRUE(predictor._stats.n_track == n_track-1); // track of length 3 has no hindcast
+
+    for (int i = 0; i < n_track; i ++)
+    {
+        int len = track_list[i]._n_obj3d;
+        int order = std::min(len-1, 5);
+        for (int axis = 0; axis < 3; axis ++)
+        {
+            std::vector<double> series(order+1);
+            for (int j = 0; j < order+1; j ++)
+            {
+                series[j] = track_list[i].getPt3D(len-1-order+j)[axis];
+            }
+            IS_TRUE(std::fabs(obj3d_list_pred[i]._pt_center[axis] - predLMSRef(series)) < 1e-6);
+        }
+
+        Tracer3D obj3d;
+        track_list[i].predictNext(obj3d);
+        IS_TRUE(myMATH::dist(obj3d._pt_center, obj3d_list_pred[i]._pt_center) < 1e-10);
+        IS_TRUE(obj3d_list_pred[i]._r2d_px == 2);
+    }
+
+    // polynomial and Kalman filters are exact on constant acceleration tracks
+    TrackPredParam param;
+    for (PredTypeID type : {PRED_POLY, PRED_KALMAN})
+    {
+        param.type = type;
+        TrackPredictor<Tracer3D> predictor_ca(param);
+        predictor_ca.predict(obj3d_list_pred, track_list, true);
+
+        for (int i = 0; i < n_track; i ++)
+        {
+            Track<Tracer3D> track_next = makeTrack(track_list[i]._n_obj3d+1, 0.2*(i+3) - 1, 0.05*(i+3), 0.01);
+            double err = myMATH::dist(obj3d_list_pred[i]._pt_center, track_next._obj3d_list.back()._pt_center);
+            IS_TRUE(err < 1e-8);
+        }
+        IS_TRUE(predictor_ca._stats.max < 1e-8);
+    }
+
+    // n_hist below 3 still fits the polynomial on the last 3 points
+    param.type = PRED_POLY;
+    param.n_hist = 2;
+    TrackPredictor<Tracer3D> predictor_short(param);
+    predictor_short.predict(obj3d_list_pred, track_list);
+    for (int i = 0; i < n_track; i ++)
+    {
+        Track<Tracer3D> track_next = makeTrack(track_list[i]._n_obj3d+1, 0.2*(i+3) - 1, 0.05*(i+3), 0.01);
+        double err = myMATH::dist(obj3d_list_pred[i]._pt_center, track_next._obj3d_list.back()._pt_center);
+        IS_TRUE(err < 1e-8);
+    }
+
+    return true;
+}
+
+// test compact storage: live window and saved output
+bool test_function_3 ()
+{
+    int n_cam_all = 3;
+    Track<Tracer3D> track;
+    std::vector<Tracer3D> obj3d_list;
+    for (int t = 0; t < 20; t ++)
+    {
+        Tracer3D obj3d;
+        obj3d._pt_center = Pt3D(0.1*t, 0.2*t, -0.3*t);
+        obj3d._error = 1e-3 * t;
+        obj3d._r2d_px = 2 + t;
+        for (int cam_id = 0; cam_id < n_cam_all; cam_id ++)
+        {
+            if ((t + cam_id) % 4 != 0)
+            {
+                obj3d.addTracer2D(Tracer2D(Pt2D(10*t + cam_id, 20*t - cam_id)), cam_id);
+            }
+        }
+        obj3d_list.push_back(obj3d);
+
+        if (t < 12)
+        {
+            track.addNext(obj3d, t);
+        }
+    }
+
+    // append another track
+    Track<Tracer3D> track_tail(obj3d_list[12], 12);
+    for (int t = 13; t < 20; t ++)
+    {
+        track_tail.addNext(obj3d_list[t], t);
+    }
+    track.addNext(track_tail);
+
+    IS_TRUE(track._n_obj3d == 20);
+    IS_TRUE(track._obj3d_list.size() == LEN_TRACK_LIVE);
+    IS_TRUE(track._obj3d_list.back()._r2d_px == obj3d_list.back()._r2d_px);
+    IS_TRUE(track._obj3d_list.front()._r2d_px == obj3d_list[20-LEN_TRACK_LIVE]._r2d_px);
+    IS_TRUE(myMATH::dist(track.getPt3D(5), obj3d_list[5]._pt_center) == 0);
+
+    // saved track is the same as saving each object
+    std::string file = "../test/results/test_Track/test_function_3.csv";
+    std::string file_sol = "../test/results/test_Track/test_function_3_sol.csv";
+    std::ofstream output(file);
+    output.precision(SAVEPRECISION);
+    track.saveTrack(output, 7, 1, n_cam_all);
+    output.close();
+
+    std::ofstream output_sol(file_sol);
+    output_sol.precision(SAVEPRECISION);
+    for (int t = 0; t < 20; t ++)
+    {
+        output_sol << 7 << "," << t/1.0f << ",";
+        obj3d_list[t].saveObject3D(output_sol, n_cam_all);
+    }
+    output_sol.close();
+
+    std::ifstream input(file), input_sol(file_sol);
+    std::stringstream buffer, buffer_sol;
+    buffer << input.rdbuf();
+    buffer_sol << input_sol.rdbuf();
+    IS_TRUE(buffer.str() == buffer_sol.str());
+    IS_TRUE(buffer.str().size() > 0);
+
+    return true;
+}
+
+// test background writer: batches are written in order with global track IDs
+bool test_function_4 ()
+{
+    int n_cam_all = 2;
+    std::deque<Track<Tracer3D>> track_list;
+    for (int i = 0; i < 5; i ++)
+    {
+        Track<Tracer3D> track;
+        for (int t = 0; t < 4 + i; t ++)
+        {
+            Tracer3D obj3d;
+            obj3d._pt_center = Pt3D(i + 0.1*t, 0.5*t, -0.2*t);
+            obj3d.addTracer2D(Tracer2D(Pt2D(t, i)), t % n_cam_all);
+            track.addNext(obj3d, 10 + t);
+        }
+        track._track_id = 100 + 3*i;
+        track_list.push_back(track);
+    }
+
+    std::string file = "../test/results/test_Track/test_function_4.csv";
+    std::string file_sol = "../test/results/test_Track/test_function_4_sol.csv";
+
+    std::ofstream output_sol(file_sol);
+    output_sol << "TrackID,FrameID,WorldX,WorldY,WorldZ,Error,Ncam";
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        output_sol << ",cam" << i << "_x(col),cam" << i << "_y(row)";
+    }
+    output_sol << "\n";
+    for (int i = 0; i < track_list.size(); i ++)
+    {
+        track_list[i].saveTrack(output_sol, track_list[i]._track_id, 2, n_cam_all);
+    }
+    output_sol.close();
+
+    TrackWriter<Tracer3D> writer;
+    writer.open(file, 2, n_cam_all);
+    IS_TRUE(writer.isOpen());
+
+    std::deque<Track<Tracer3D>> batch_1(track_list.begin(), track_list.begin()+2);
+    std::deque<Track<Tracer3D>> batch_2(track_list.begin()+2, track_list.end());
+    writer.push(batch_1);
+    IS_TRUE(batch_1.empty());
+    writer.push(batch_2);
+    IS_TRUE(batch_2.empty());
+    IS_TRUE(writer.getNumOfTrack() == 5);
+    writer.close();
+    IS_TRUE(!writer.isOpen());
+
+    std::ifstream input(file), input_sol(file_sol);
+    std::stringstream buffer, buffer_sol;
+    buffer << input.rdbuf();
+    buffer_sol << input_sol.rdbuf();
+    IS_TRUE(buffer.str() == buffer_sol.str());
+
+    return true;
+}
+
+// test removing flagged tracks in one pass
+bool test_function_5 ()
+{
+    std::deque<Track<Tracer3D>> track_list;
+    std::vector<Tracer3D> obj3d_list;
+    for (int i = 0; i < 20; i ++)
+    {
+        Tracer3D obj3d(Pt3D(i, 0, 0));
+        obj3d_list.push_back(obj3d);
+        track_list.push_back(Track<Tracer3D>(obj3d, i));
+        track_list.back()._track_id = i;
+    }
+
+    std::vector<int> is_remove(20, 0);
+    for (int i = 0; i < 20; i ++)
+    {
+        is_remove[i] = (i % 3 == 0) || (i > 15);
+    }
+    removeFlagged(track_list, is_remove);
+    removeFlagged(obj3d_list, is_remove);
+
+    std::vector<int> id_list;
+    for (int i = 0; i < 20; i ++)
+    {
+        if (!is_remove[i])
+        {
+            id_list.push_back(i);
+        }
+    }
+    IS_TRUE(track_list.size() == id_list.size());
+    IS_TRUE(obj3d_list.size() == id_list.size());
+    for (int i = 0; i < id_list.size(); i ++)
+    {
+        IS_TRUE(track_list[i]._track_id == id_list[i]);
+        IS_TRUE(track_list[i]._t_list[0] == id_list[i]);
+        IS_TRUE(track_list[i]._obj3d_list[0]._pt_center[0] == id_list[i]);
+        IS_TRUE(obj3d_list[i]._pt_center[0] == id_list[i]);
+    }
+
+    // nothing or everything removed
+    removeFlagged(track_list, std::vector<int>(track_list.size(), 0));
+    IS_TRUE(track_list.size() == id_list.size());
+    removeFlagged(track_list, std::vector<int>(track_list.size(), 1));
+    IS_TRUE(track_list.empty());
+
+    return true;
+}
+
+// full track is kept in the compact history, _obj3d_list only keeps the latest objects
+bool test_function_6 ()
+{
+    Track<Tracer3D> track;
+    int n_pt = LEN_TRACK_LIVE + 5;
+    for (int i = 0; i < n_pt; i ++)
+    {
+        Tracer3D obj3d(Pt3D(i, 2*i, 3*i));
+        obj3d._error = 0.1 * i;
+        obj3d.addTracer2D(Tracer2D(Pt2D(i, i+1)), 0);
+        obj3d.addTracer2D(Tracer2D(Pt2D(i+2, i+3)), 2);
+        track.addNext(obj3d, 10 + i);
+    }
+    IS_TRUE(track._n_obj3d == n_pt);
+    IS_TRUE(track._obj3d_list.size() == LEN_TRACK_LIVE);
+
+    for (int i = 0; i < n_pt; i ++)
+    {
+        Tracer3D obj3d = track.getObj3D(i);
+        IS_TRUE(obj3d._pt_center[0] == i && obj3d._pt_center[1] == 2*i && obj3d._pt_center[2] == 3*i);
+        IS_TRUE(std::fabs(obj3d._error - 0.1 * i) < SMALLNUMBER);
+        IS_TRUE(obj3d._n_2d == 2);
+        IS_TRUE(obj3d._camid_list[0] == 0 && obj3d._camid_list[1] == 2);
+        IS_TRUE(obj3d._tr2d_list[0]._pt_center[0] == i && obj3d._tr2d_list[0]._pt_center[1] == i+1);
+        IS_TRUE(obj3d._tr2d_list[1]._pt_center[0] == i+2 && obj3d._tr2d_list[1]._pt_center[1] == i+3);
+    }
+
+    // the live objects are the latest points of the history
+    for (int i = 0; i < LEN_TRACK_LIVE; i ++)
+    {
+        int j = n_pt - LEN_TRACK_LIVE + i;
+        IS_TRUE(track._obj3d_list[i]._pt_center[0] == track.getObj3D(j)._pt_center[0]);
+    }
+
+    return true;
+}
+
+
 int main ()
 {
     fs::create_directories("../test/results/test_Track/");
 
     IS_TRUE(test_function_1());
+    IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
+    IS_TRUE(test_function_4());
+    IS_TRUE(test_function_5());
+    IS_TRUE(test_function_6());
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "test.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <deque>
+
+#include "TrackFile.h"
+#include "Track.h"
+#include "Matrix.h"
+#include "ObjectInfo.h"
+
+// tracks with different length and a varying number of 2D observations
+void makeTracks (std::deque<Track<Tracer3D>>& track_list, int n_track, int n_cam_all)
+{
+    track_list.clear();
+    for (int i = 0; i < n_track; i ++)
+    {
+        Track<Tracer3D> track;
+        for (int t = 0; t < 3 + i % 5; t ++)
+        {
+            Tracer3D obj3d;
+            obj3d._pt_center = Pt3D(i + 0.125*t, -0.5*i + 0.25*t, 1.0/(1+t));
+            obj3d._error = 1e-3 * (i + t);
+            for (int cam_id = 0; cam_id < n_cam_all; cam_id ++)
+            {
+                if ((i + t + cam_id) % 3 != 0)
+                {
+                    obj3d.addTracer2D(Tracer2D(Pt2D(10.5*t + cam_id, 20.25*i - cam_id)), cam_id);
+                }
+            }
+            track.addNext(obj3d, 100 + i + t);
+        }
+        track._track_id = 2*i + 1;
+        track_list.push_back(track);
+    }
+}
+
+std::string readFile (std::string const& file)
+{
+    std::ifstream input(file);
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    return buffer.str();
+}
+
+// test writer and reader
+bool test_function_1 ()
+{
+    int n_cam_all = 3;
+    std::deque<Track<Tracer3D>> track_list;
+    makeTracks(track_list, 50, n_cam_all);
+
+    std::string file = "../test/results/test_TrackFile/test_function_1.lpt";
+    TrackFileWriter writer;
+    writer.open(file, 2, n_cam_all, 32);
+    for (size_t i = 0; i < track_list.size(); i ++)
+    {
+        track_list[i].saveTrack(writer, track_list[i]._track_id);
+    }
+    writer.close();
+
+    TrackFileReader reader(file);
+    IS_TRUE(reader.getNumOfTrack() == int64_t(track_list.size()));
+    IS_TRUE(reader.getNumOfCam() == n_cam_all);
+    IS_TRUE(reader.getFPS() == 2);
+    IS_TRUE(reader.getNumOfChunk() > 1);
+
+    // compare all tracks
+    int track_id = 0;
+    int64_t n_pt = 0;
+    for (int c = 0; c < reader.getNumOfChunk(); c ++)
+    {
+        TrackChunk chunk = reader.getChunk(c);
+        IS_TRUE(chunk.track_start[0] == 0);
+        IS_TRUE(reader.getChunkInfo(c).track_id_min == chunk.track_id[0]);
+
+        for (int i = 0; i < chunk.n_track; i ++, track_id ++)
+        {
+            Track<Tracer3D> const& track = track_list[track_id];
+            IS_TRUE(chunk.track_id[i] == track._track_id);
+            IS_TRUE(chunk.track_start[i+1] - chunk.track_start[i] == track._n_obj3d);
+
+            for (int j = 0; j < track._n_obj3d; j ++)
+            {
+                int64_t k = chunk.track_start[i] + j;
+                IS_TRUE(chunk.frame[k] == track._t_list[j]);
+                IS_TRUE(chunk.x[k] == track._pt_list[3*j]);
+                IS_TRUE(chunk.y[k] == track._pt_list[3*j+1]);
+                IS_TRUE(chunk.z[k] == track._pt_list[3*j+2]);
+                IS_TRUE(chunk.error[k] == track._error_list[j]);
+
+                int n_obs = track._obs_start[j+1] - track._obs_start[j];
+                IS_TRUE(chunk.obs_start[k+1] - chunk.obs_start[k] == n_obs);
+                for (int m = 0; m < n_obs; m ++)
+                {
+                    int m_chunk = chunk.obs_start[k] + m;
+                    int m_track = track._obs_start[j] + m;
+                    IS_TRUE(chunk.obs_cam[m_chunk] == track._obs_camid_list[m_track]);
+                    IS_TRUE(chunk.obs_x[m_chunk] == track._obs_pt_list[2*m_track]);
+                    IS_TRUE(chunk.obs_y[m_chunk] == track._obs_pt_list[2*m_track+1]);
+                }
+            }
+            n_pt += track._n_obj3d;
+        }
+    }
+    IS_TRUE(track_id == int(track_list.size()));
+    IS_TRUE(reader.getNumOfPt() == n_pt);
+
+    return true;
+}
+
+// test csv converter and invalid files
+bool test_function_2 ()
+{
+    int n_cam_all = 2;
+    float fps = 4;
+    std::deque<Track<Tracer3D>> track_list;
+    makeTracks(track_list, 20, n_cam_all);
+
+    std::string folder = "../test/results/test_TrackFile/";
+
+    // csv written by Track::saveTrack
+    std::ofstream output(folder + "test_function_2.csv");
+    output << "TrackID,FrameID,WorldX,WorldY,WorldZ,Error,Ncam";
+    for (int i = 0; i < n_cam_all; i ++)
+    {
+        output << ",cam" << i << "_x(col),cam" << i << "_y(row)";
+    }
+    output << "\n";
+    for (size_t i = 0; i < track_list.size(); i ++)
+    {
+        track_list[i].saveTrack(output, track_list[i]._track_id, fps, n_cam_all);
+    }
+    output.close();
+
+    // binary written by Track::saveTrack
+    TrackFileWriter writer;
+    writer.open(folder + "test_function_2.lpt", fps, n_cam_all);
+    for (size_t i = 0; i < track_list.size(); i ++)
+    {
+        track_list[i].saveTrack(writer, track_list[i]._track_id);
+    }
+    writer.close();
+
+    // binary -> csv
+    convertTrackBinToCSV(folder + "test_function_2.lpt", folder + "test_function_2_bin.csv");
+    IS_TRUE(readFile(folder + "test_function_2_bin.csv") == readFile(folder + "test_function_2.csv"));
+
+    // csv -> binary -> csv
+    convertTrackCSVToBin(folder + "test_function_2.csv", folder + "test_function_2_csv.lpt", fps);
+    convertTrackBinToCSV(folder + "test_function_2_csv.lpt", folder + "test_function_2_csv.csv");
+    IS_TRUE(readFile(folder + "test_function_2_csv.csv") == readFile(folder + "test_function_2.csv"));
+
+    TrackFileReader reader(folder + "test_function_2_csv.lpt");
+    IS_TRUE(reader.getNumOfTrack() == int64_t(track_list.size()));
+    IS_TRUE(reader.getChunk(0).frame[0] == track_list[0]._t_list[0]);
+
+    // not a track file
+    bool is_throw = false;
+    try
+    {
+        TrackFileReader reader_csv(folder + "test_function_2.csv");
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+
+    return true;
+}
+
+// test a file that was not closed and a corrupt chunk
+bool test_function_3 ()
+{
+    int n_cam_all = 3;
+    std::deque<Track<Tracer3D>> track_list;
+    makeTracks(track_list, 40, n_cam_all);
+
+    std::string folder = "../test/results/test_TrackFile/";
+
+    // copy the file while the writer is still open, as after a crash
+    TrackFileWriter writer;
+    writer.open(folder + "test_function_3.lpt", 2, n_cam_all, 32);
+    for (int i = 0; i < 20; i ++)
+    {
+        track_list[i].saveTrack(writer, track_list[i]._track_id);
+    }
+    writer.flush();
+    std::string data_open = readFile(folder + "test_function_3.lpt");
+
+    for (size_t i = 20; i < track_list.size(); i ++)
+    {
+        track_list[i].saveTrack(writer, track_list[i]._track_id);
+    }
+    writer.flush();
+    std::string data_next = readFile(folder + "test_function_3.lpt");
+    writer.close();
+
+    // the last chunk is partly written
+    std::ofstream output(folder + "test_function_3_open.lpt", std::ios::out | std::ios::binary);
+    output << data_next.substr(0, data_open.size() + 100);
+    output.close();
+
+    int n_chunk = 0;
+    {
+        TrackFileReader reader(folder + "test_function_3_open.lpt");
+        IS_TRUE(reader.getNumOfTrack() == 20);
+        IS_TRUE(reader.getNumOfCam() == n_cam_all);
+        IS_TRUE(reader.getNumOfChunk() > 1);
+        n_chunk = reader.getNumOfChunk();
+
+        int track_id = 0;
+        for (int c = 0; c < reader.getNumOfChunk(); c ++)
+        {
+            TrackChunk chunk = reader.getChunk(c);
+            for (int i = 0; i < chunk.n_track; i ++, track_id ++)
+            {
+                IS_TRUE(chunk.track_id[i] == track_list[track_id]._track_id);
+                IS_TRUE(chunk.x[chunk.track_start[i]] == track_list[track_id]._pt_list[0]);
+            }
+        }
+        IS_TRUE(track_id == 20);
+    }
+
+    // all chunks of the closed file agree with the recovered ones
+    TrackChunkInfo info;
+    {
+        TrackFileReader reader(folder + "test_function_3.lpt");
+        IS_TRUE(reader.getNumOfTrack() == int64_t(track_list.size()));
+        IS_TRUE(reader.getNumOfChunk() > n_chunk);
+        info = reader.getChunkInfo(0);
+    }
+
+    // camera ID out of range in the first chunk
+    uint64_t offset_cam = info.offset 
+                        + (info.n_track * 8 + 7) / 8 * 8 
+                        + ((info.n_track+1) * 8 + 7) / 8 * 8 
+                        + (info.n_pt * 4 + 7) / 8 * 8 
+                        + 4 * info.n_pt * 8 
+                        + ((info.n_pt+1) * 4 + 7) / 8 * 8;
+    std::fstream file(folder + "test_function_3.lpt", std::ios::in | std::ios::out | std::ios::binary);
+    int32_t cam_id = n_cam_all;
+    file.seekp(offset_cam);
+    file.write(reinterpret_cast<char const*>(&cam_id), sizeof(int32_t));
+    file.close();
+
+    TrackFileReader reader(folder + "test_function_3.lpt");
+    bool is_throw = false;
+    try
+    {
+        reader.getChunk(0);
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+    reader.getChunk(1);
+
+    is_throw = false;
+    try
+    {
+        convertTrackBinToCSV(folder + "test_function_3.lpt", folder + "test_function_3.csv");
+    }
+    catch (ErrorTypeID)
+    {
+        is_throw = true;
+    }
+    IS_TRUE(is_throw);
+
+    return true;
+}
+
+int main ()
+{
+    fs::create_directories("../test/results/test_TrackFile/");
+
+    IS_TRUE(test_function_1());
+    IS_TRUE(test_function_2());
+    IS_TRUE(test_function_3());
+
+    return 0;
+}